@@ -0,0 +1,139 @@
+#ifndef WFC_BENCHMARKS_HISTOGRAM_HPP
+#define WFC_BENCHMARKS_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace bench
+{
+	/**
+	 * Returns a timestamp in nanoseconds from a monotonic clock.
+	 */
+	inline std::uint64_t now_ns() noexcept
+	{
+		return static_cast<std::uint64_t>(
+		    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+		        .count());
+	}
+
+	/**
+	 * Histogram of latencies with a bounded relative error, in the spirit of HdrHistogram.
+	 *
+	 * @details Values below 2 * sub_buckets are recorded exactly. Above, each power of two is split into sub_buckets
+	 * linear buckets, so that a recorded value is off by less than 1 / sub_buckets (about 1.6%).
+	 * Recording is a single increment, histograms are meant to be owned by one thread and merged afterwards.
+	 */
+	class latency_histogram
+	{
+	public:
+		static constexpr std::size_t sub_bucket_bits = 6;
+		static constexpr std::size_t sub_buckets = std::size_t{1} << sub_bucket_bits;
+
+		void record(std::uint64_t value) noexcept;
+
+		void merge(const latency_histogram& other) noexcept;
+
+		std::uint64_t count() const noexcept;
+
+		std::uint64_t max() const noexcept;
+
+		/**
+		 * Returns the smallest recorded value such that a fraction q of the values are lower or equivalent to it.
+		 * @param q in [0, 1]
+		 */
+		std::uint64_t percentile(double q) const noexcept;
+
+	private:
+		static constexpr std::size_t nbr_buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+		static std::size_t index_of(std::uint64_t value) noexcept;
+
+		// Returns the highest value recorded in the given bucket.
+		static std::uint64_t value_at(std::size_t index) noexcept;
+
+		std::array<std::uint64_t, nbr_buckets> m_counts{};
+		std::uint64_t m_count = 0;
+		std::uint64_t m_max = 0;
+	};
+
+	inline void latency_histogram::record(std::uint64_t value) noexcept
+	{
+		++m_counts[index_of(value)];
+		++m_count;
+		m_max = std::max(m_max, value);
+	}
+
+	inline void latency_histogram::merge(const latency_histogram& other) noexcept
+	{
+		for (std::size_t i = 0; i < nbr_buckets; ++i)
+		{
+			m_counts[i] += other.m_counts[i];
+		}
+		m_count += other.m_count;
+		m_max = std::max(m_max, other.m_max);
+	}
+
+	inline std::uint64_t latency_histogram::count() const noexcept
+	{
+		return m_count;
+	}
+
+	inline std::uint64_t latency_histogram::max() const noexcept
+	{
+		return m_max;
+	}
+
+	inline std::uint64_t latency_histogram::percentile(double q) const noexcept
+	{
+		if (m_count == 0)
+		{
+			return 0;
+		}
+
+		auto rank = static_cast<std::uint64_t>(q * static_cast<double>(m_count) + 0.5);
+		rank = std::clamp<std::uint64_t>(rank, 1, m_count);
+
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < nbr_buckets; ++i)
+		{
+			seen += m_counts[i];
+			if (seen >= rank)
+			{
+				return std::min(value_at(i), m_max);
+			}
+		}
+
+		return m_max;
+	}
+
+	inline std::size_t latency_histogram::index_of(std::uint64_t value) noexcept
+	{
+		if (value < 2 * sub_buckets)
+		{
+			return static_cast<std::size_t>(value);
+		}
+
+		std::size_t msb = 63 - static_cast<std::size_t>(__builtin_clzll(value));
+		std::size_t shift = msb - sub_bucket_bits;
+
+		return (shift + 1) * sub_buckets + static_cast<std::size_t>(value >> shift) - sub_buckets;
+	}
+
+	inline std::uint64_t latency_histogram::value_at(std::size_t index) noexcept
+	{
+		if (index < 2 * sub_buckets)
+		{
+			return index;
+		}
+
+		std::size_t shift = index / sub_buckets - 1;
+		std::uint64_t sub = index % sub_buckets + sub_buckets;
+
+		return (sub << shift) + ((std::uint64_t{1} << shift) - 1);
+	}
+} // namespace bench
+
+#endif // WFC_BENCHMARKS_HISTOGRAM_HPP
@@ -0,0 +1,83 @@
+#ifndef WFC_BENCHMARKS_OPTIONS_HPP
+#define WFC_BENCHMARKS_OPTIONS_HPP
+
+#include <cstddef>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	/**
+	 * Command line of a benchmark, made of --name=value arguments.
+	 * Lists are comma separated, such as --threads=1,2,4.
+	 */
+	class options
+	{
+	public:
+		/**
+		 * @throw std::runtime_error if an argument isn't of the form --name=value.
+		 */
+		options(int argc, const char* const* argv);
+
+		std::size_t get(const std::string& name, std::size_t default_value) const;
+
+		std::vector<std::size_t> get_list(const std::string& name, std::vector<std::size_t> default_value) const;
+
+		std::string get_string(const std::string& name, const std::string& default_value) const;
+
+	private:
+		std::map<std::string, std::string> m_values;
+	};
+
+	inline options::options(int argc, const char* const* argv) : m_values()
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg(argv[i]);
+			std::size_t equal = arg.find('=');
+			if (arg.compare(0, 2, "--") != 0 || equal == std::string::npos)
+			{
+				throw std::runtime_error("Expected --name=value, got " + arg);
+			}
+
+			m_values[arg.substr(2, equal - 2)] = arg.substr(equal + 1);
+		}
+	}
+
+	inline std::size_t options::get(const std::string& name, std::size_t default_value) const
+	{
+		auto it = m_values.find(name);
+		return it == m_values.end() ? default_value : std::stoul(it->second);
+	}
+
+	inline std::vector<std::size_t> options::get_list(const std::string& name,
+	                                                  std::vector<std::size_t> default_value) const
+	{
+		auto it = m_values.find(name);
+		if (it == m_values.end())
+		{
+			return default_value;
+		}
+
+		std::vector<std::size_t> values;
+		std::stringstream ss(it->second);
+		std::string value;
+		while (std::getline(ss, value, ','))
+		{
+			values.push_back(std::stoul(value));
+		}
+
+		return values;
+	}
+
+	inline std::string options::get_string(const std::string& name, const std::string& default_value) const
+	{
+		auto it = m_values.find(name);
+		return it == m_values.end() ? default_value : it->second;
+	}
+} // namespace bench
+
+#endif // WFC_BENCHMARKS_OPTIONS_HPP
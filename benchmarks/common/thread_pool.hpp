@@ -0,0 +1,136 @@
+#ifndef WFC_BENCHMARKS_THREAD_POOL_HPP
+#define WFC_BENCHMARKS_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+	/**
+	 * Fixed set of threads running the same job, for one run after another.
+	 *
+	 * @details Collections index their per-thread state with wfc::details::get_thread_id(), which grows with every
+	 * new thread. Keeping the same threads across runs keeps the ids, hence max_nbr_threads, small.
+	 */
+	class thread_pool
+	{
+	public:
+		explicit thread_pool(std::size_t nbr_threads);
+		thread_pool(const thread_pool&) = delete;
+		~thread_pool() noexcept;
+
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		std::size_t size() const noexcept;
+
+		/**
+		 * Runs job(index) on the first nbr_threads threads of the pool, then waits for all of them.
+		 * The threads are released together once they are all ready.
+		 */
+		void run(std::size_t nbr_threads, const std::function<void(std::size_t)>& job);
+
+	private:
+		void work(std::size_t index);
+
+		std::vector<std::thread> m_threads;
+		std::mutex m_mutex;
+		std::condition_variable m_start;
+		std::condition_variable m_done;
+		const std::function<void(std::size_t)>* m_job;
+		std::size_t m_generation;
+		std::size_t m_active;
+		std::size_t m_running;
+		std::atomic<std::size_t> m_ready;
+		bool m_stop;
+	};
+
+	inline thread_pool::thread_pool(std::size_t nbr_threads)
+	    : m_threads(), m_job(nullptr), m_generation(0), m_active(0), m_running(0), m_ready(0), m_stop(false)
+	{
+		for (std::size_t i = 0; i < nbr_threads; ++i)
+		{
+			m_threads.emplace_back([this, i]() { work(i); });
+		}
+	}
+
+	inline thread_pool::~thread_pool() noexcept
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_start.notify_all();
+
+		for (auto& t: m_threads)
+		{
+			t.join();
+		}
+	}
+
+	inline std::size_t thread_pool::size() const noexcept
+	{
+		return m_threads.size();
+	}
+
+	inline void thread_pool::run(std::size_t nbr_threads, const std::function<void(std::size_t)>& job)
+	{
+		std::unique_lock lock(m_mutex);
+		m_job = &job;
+		m_active = std::min(nbr_threads, m_threads.size());
+		m_running = m_active;
+		m_ready = 0;
+		++m_generation;
+		m_start.notify_all();
+
+		m_done.wait(lock, [this]() { return m_running == 0; });
+		m_job = nullptr;
+	}
+
+	inline void thread_pool::work(std::size_t index)
+	{
+		std::size_t generation = 0;
+		while (true)
+		{
+			const std::function<void(std::size_t)>* job;
+			std::size_t active;
+			{
+				std::unique_lock lock(m_mutex);
+				m_start.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+				if (m_stop)
+				{
+					return;
+				}
+
+				generation = m_generation;
+				if (index >= m_active)
+				{
+					continue;
+				}
+				job = m_job;
+				active = m_active;
+			}
+
+			++m_ready;
+			while (m_ready.load() < active)
+			{
+				std::this_thread::yield();
+			}
+
+			(*job)(index);
+
+			std::lock_guard lock(m_mutex);
+			if (--m_running == 0)
+			{
+				m_done.notify_one();
+			}
+		}
+	}
+} // namespace bench
+
+#endif // WFC_BENCHMARKS_THREAD_POOL_HPP
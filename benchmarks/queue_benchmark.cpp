@@ -0,0 +1,190 @@
+// Throughput and latency of wfc::queue against a std::deque guarded by a std::mutex.
+//
+// Half of the threads produce, the other half consume until every produced value is dequeued. Each enqueue and
+// each successful dequeue is timestamped and recorded into per-thread histograms; the throughput is the number of
+// transferred values per second.
+//
+// Options (lists are comma separated):
+//   --threads=...   thread counts, split between producers and consumers, defaults to 2, hardware concurrency,
+//                   2x and 4x that
+//   --ops=n         values enqueued by each producer, defaults to 200000
+//   --batch=n       values per enqueue_bulk, 1 for plain enqueues, defaults to 1
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/queue.hpp>
+
+#include "common/histogram.hpp"
+#include "common/options.hpp"
+#include "common/thread_pool.hpp"
+
+namespace
+{
+	class mutex_queue
+	{
+	public:
+		explicit mutex_queue(std::size_t /*max_nbr_threads*/) : m_mutex(), m_values()
+		{
+		}
+
+		template <typename InputIt>
+		std::size_t enqueue_bulk(InputIt first, InputIt last)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::size_t count = m_values.size();
+			m_values.insert(m_values.end(), first, last);
+			return m_values.size() - count;
+		}
+
+		std::optional<std::size_t> dequeue()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_values.empty())
+			{
+				return std::nullopt;
+			}
+
+			std::size_t value = m_values.front();
+			m_values.pop_front();
+			return value;
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::deque<std::size_t> m_values;
+	};
+
+	struct alignas(64) thread_result
+	{
+		bench::latency_histogram histogram;
+		std::size_t empty_dequeues;
+	};
+
+	struct run_parameters
+	{
+		std::size_t nbr_threads;
+		std::size_t ops;
+		std::size_t batch;
+	};
+
+	void print_header()
+	{
+		std::cout << std::setw(8) << "queue" << std::setw(8) << "threads" << std::setw(8) << "op" << std::setw(12)
+		          << "count" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+		          << std::setw(10) << "p99.99" << std::setw(12) << "max" << std::setw(12) << "empty" << std::setw(12)
+		          << "Mvalues/s" << '\n';
+	}
+
+	void print_line(const std::string& name,
+	                const run_parameters& p,
+	                const char* op,
+	                const bench::latency_histogram& h,
+	                std::size_t empty,
+	                double mvalues)
+	{
+		std::cout << std::setw(8) << name << std::setw(8) << p.nbr_threads << std::setw(8) << op << std::setw(12)
+		          << h.count() << std::setw(10) << h.percentile(0.5) << std::setw(10) << h.percentile(0.99)
+		          << std::setw(10) << h.percentile(0.999) << std::setw(10) << h.percentile(0.9999) << std::setw(12)
+		          << h.max() << std::setw(12) << empty << std::setw(12) << std::fixed << std::setprecision(2) << mvalues
+		          << '\n';
+	}
+
+	template <typename Queue>
+	void run(const std::string& name, bench::thread_pool& pool, const run_parameters& p)
+	{
+		Queue queue(pool.size() + 1);
+		std::size_t nbr_producers = std::max<std::size_t>(1, p.nbr_threads / 2);
+		std::size_t nbr_consumers = std::max<std::size_t>(1, p.nbr_threads - nbr_producers);
+		std::size_t total = nbr_producers * p.ops;
+		std::atomic<std::size_t> consumed{0};
+
+		std::vector<thread_result> results(nbr_producers + nbr_consumers);
+		std::uint64_t start = bench::now_ns();
+		pool.run(nbr_producers + nbr_consumers, [&](std::size_t index) {
+			thread_result& result = results[index];
+			if (index < nbr_producers)
+			{
+				std::vector<std::size_t> batch(p.batch);
+				for (std::size_t i = 0; i < p.ops; i += p.batch)
+				{
+					std::size_t count = std::min(p.batch, p.ops - i);
+					std::fill_n(batch.begin(), count, i);
+
+					std::uint64_t before = bench::now_ns();
+					queue.enqueue_bulk(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(count));
+					result.histogram.record(bench::now_ns() - before);
+				}
+				return;
+			}
+
+			while (consumed.load(std::memory_order_relaxed) < total)
+			{
+				std::uint64_t before = bench::now_ns();
+				std::optional<std::size_t> value = queue.dequeue();
+				std::uint64_t after = bench::now_ns();
+				if (value)
+				{
+					result.histogram.record(after - before);
+					consumed.fetch_add(1, std::memory_order_relaxed);
+				}
+				else
+				{
+					++result.empty_dequeues;
+				}
+			}
+		});
+		std::uint64_t elapsed = bench::now_ns() - start;
+
+		bench::latency_histogram enqueues;
+		bench::latency_histogram dequeues;
+		std::size_t empty = 0;
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			(i < nbr_producers ? enqueues : dequeues).merge(results[i].histogram);
+			empty += results[i].empty_dequeues;
+		}
+
+		double mvalues = static_cast<double>(total) * 1000.0 / static_cast<double>(elapsed);
+		print_line(name, p, "enqueue", enqueues, 0, mvalues);
+		print_line(name, p, "dequeue", dequeues, empty, mvalues);
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::options opts(argc, argv);
+
+	std::size_t hardware = std::max(1U, std::thread::hardware_concurrency());
+	std::vector<std::size_t> thread_counts = opts.get_list("threads", {2, hardware, 2 * hardware, 4 * hardware});
+	thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+	run_parameters p{};
+	p.ops = opts.get("ops", 200000);
+	p.batch = std::max<std::size_t>(1, opts.get("batch", 1));
+
+	// At least a producer and a consumer are needed.
+	std::size_t max_threads = std::max<std::size_t>(2, *std::max_element(thread_counts.begin(), thread_counts.end()));
+	bench::thread_pool pool(max_threads);
+
+	std::cout << "Latencies in ns, " << hardware << " hardware threads, batches of " << p.batch << '\n';
+	print_header();
+	for (std::size_t nbr_threads: thread_counts)
+	{
+		p.nbr_threads = std::max<std::size_t>(2, nbr_threads);
+		run<wfc::queue<std::size_t>>("wfc", pool, p);
+		run<mutex_queue>("mutex", pool, p);
+	}
+
+	return 0;
+}
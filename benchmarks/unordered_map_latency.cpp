@@ -0,0 +1,196 @@
+// Per-operation latency of wfc::unordered_map.
+//
+// Every insert, get, update and remove is timestamped and recorded into per-thread histograms, which are merged
+// once the run is over. Runs sweep the number of threads (up to oversubscription) and max_fail_count, to see
+// whether the wait-free fallback, which expands a contended slot after max_fail_count failures, bounds the tail.
+//
+// Options (lists are comma separated):
+//   --threads=...        thread counts, defaults to 1, hardware concurrency, 2x and 4x that
+//   --fail-counts=...    max_fail_count values, defaults to 1,8,64,1024
+//   --array-length=n     array length of the map, defaults to 4
+//   --keys=n             size of the key space, half of it is inserted before each run, defaults to 65536
+//   --hot-keys=n         number of keys receiving hot_percent of the operations, defaults to 16
+//   --hot-percent=n      defaults to 50
+//   --ops=n              operations per thread, defaults to 200000
+//   --backoff=policy     none, exponential or proportional, defaults to none
+//   --combining=0|1      merges concurrent updates of a key, defaults to 0
+//   --fences=mode        hazard fences, symmetric or asymmetric, defaults to symmetric
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+#include "common/histogram.hpp"
+#include "common/options.hpp"
+#include "common/thread_pool.hpp"
+
+namespace
+{
+	enum class operation : std::size_t
+	{
+		insert,
+		get,
+		update,
+		remove
+	};
+
+	constexpr std::size_t nbr_operations = 4;
+	constexpr std::array<const char*, nbr_operations> operation_names = {"insert", "get", "update", "remove"};
+
+	struct alignas(64) thread_result
+	{
+		std::array<bench::latency_histogram, nbr_operations> histograms;
+	};
+
+	struct run_parameters
+	{
+		std::size_t array_length;
+		std::size_t max_fail_count;
+		std::size_t nbr_threads;
+		std::size_t keys;
+		std::size_t hot_keys;
+		std::size_t hot_percent;
+		std::size_t ops;
+		wfc::contention_policy contention;
+		wfc::hazard_fence_mode fences;
+	};
+
+	std::uint64_t xorshift(std::uint64_t& state) noexcept
+	{
+		state ^= state << 13U;
+		state ^= state >> 7U;
+		state ^= state << 17U;
+		return state;
+	}
+
+	void print_header()
+	{
+		std::cout << std::setw(8) << "threads" << std::setw(10) << "max_fail" << std::setw(8) << "op" << std::setw(12)
+		          << "count" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+		          << std::setw(10) << "p99.99" << std::setw(12) << "max" << std::setw(12) << "Mops/s" << '\n';
+	}
+
+	void run(bench::thread_pool& pool, const run_parameters& p)
+	{
+		wfc::unordered_map<std::size_t, std::size_t> map(p.array_length, p.max_fail_count, pool.size() + 1);
+		map.set_contention_policy(p.contention);
+		map.set_hazard_fence_mode(p.fences);
+		for (std::size_t k = 0; k < p.keys; k += 2)
+		{
+			map.insert(k, k);
+		}
+
+		std::vector<thread_result> results(p.nbr_threads);
+		std::uint64_t start = bench::now_ns();
+		pool.run(p.nbr_threads, [&map, &results, &p](std::size_t index) {
+			std::uint64_t state = 0x9E3779B97F4A7C15ULL * (index + 1);
+			auto& histograms = results[index].histograms;
+
+			for (std::size_t i = 0; i < p.ops; ++i)
+			{
+				std::uint64_t r = xorshift(state);
+				std::size_t key = (r >> 8U) % 100 < p.hot_percent ? (r >> 16U) % p.hot_keys : (r >> 16U) % p.keys;
+				auto op = static_cast<operation>(r & 3U);
+
+				std::uint64_t before = bench::now_ns();
+				switch (op)
+				{
+					case operation::insert:
+						map.insert(key, i);
+						break;
+					case operation::get:
+						static_cast<void>(map.get(key));
+						break;
+					case operation::update:
+						map.update(key, i);
+						break;
+					case operation::remove:
+						map.remove(key);
+						break;
+				}
+				histograms[static_cast<std::size_t>(op)].record(bench::now_ns() - before);
+			}
+		});
+		std::uint64_t elapsed = bench::now_ns() - start;
+
+		std::array<bench::latency_histogram, nbr_operations> merged{};
+		for (const thread_result& result: results)
+		{
+			for (std::size_t op = 0; op < nbr_operations; ++op)
+			{
+				merged[op].merge(result.histograms[op]);
+			}
+		}
+
+		for (std::size_t op = 0; op < nbr_operations; ++op)
+		{
+			const bench::latency_histogram& h = merged[op];
+			double mops = static_cast<double>(h.count()) * 1000.0 / static_cast<double>(elapsed);
+			std::cout << std::setw(8) << p.nbr_threads << std::setw(10) << p.max_fail_count << std::setw(8)
+			          << operation_names[op] << std::setw(12) << h.count() << std::setw(10) << h.percentile(0.5)
+			          << std::setw(10) << h.percentile(0.99) << std::setw(10) << h.percentile(0.999) << std::setw(10)
+			          << h.percentile(0.9999) << std::setw(12) << h.max() << std::setw(12) << std::fixed
+			          << std::setprecision(2) << mops << '\n';
+		}
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::options opts(argc, argv);
+
+	std::size_t hardware = std::max(1U, std::thread::hardware_concurrency());
+	std::vector<std::size_t> thread_counts = opts.get_list("threads", {1, hardware, 2 * hardware, 4 * hardware});
+	thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+	run_parameters p{};
+	p.array_length = opts.get("array-length", 4);
+	p.keys = opts.get("keys", 65536);
+	p.hot_keys = std::max<std::size_t>(1, opts.get("hot-keys", 16));
+	p.hot_percent = opts.get("hot-percent", 50);
+	p.ops = opts.get("ops", 200000);
+
+	const std::string backoff = opts.get_string("backoff", "none");
+	if (backoff == "exponential")
+	{
+		p.contention.backoff = wfc::backoff_policy::exponential;
+	}
+	else if (backoff == "proportional")
+	{
+		p.contention.backoff = wfc::backoff_policy::proportional;
+	}
+	p.contention.combining = opts.get("combining", 0) != 0;
+
+	if (opts.get_string("fences", "symmetric") == "asymmetric")
+	{
+		if (!wfc::asymmetric_fence_supported())
+		{
+			std::cerr << "Asymmetric fences aren't supported\n";
+			return 1;
+		}
+		p.fences = wfc::hazard_fence_mode::asymmetric;
+	}
+
+	bench::thread_pool pool(*std::max_element(thread_counts.begin(), thread_counts.end()));
+
+	std::cout << "Latencies in ns, " << hardware << " hardware threads\n";
+	print_header();
+	for (std::size_t nbr_threads: thread_counts)
+	{
+		for (std::size_t max_fail_count: opts.get_list("fail-counts", {1, 8, 64, 1024}))
+		{
+			p.nbr_threads = nbr_threads;
+			p.max_fail_count = max_fail_count;
+			run(pool, p);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,264 @@
+// Memory footprint of wfc::unordered_map.
+//
+// Inserts the same number of keys under several array lengths, hash functions and key distributions, and reports
+// the bytes used per entry, counted by replacing the global allocation functions and cross-checked with the
+// resident set size, along with the shape of the trie given by structure_stats and the bytes per entry of the
+// frozen_map built from it.
+//
+// Options (lists are comma separated):
+//   --entries=n          number of inserted keys, defaults to 1000000
+//   --array-lengths=...  defaults to 2,4,8,16
+//   --schedule=...       fanout schedule measured in addition to the array lengths, such as 16,6,6,3
+//   --levels=0|1         also prints the datanodes and the occupancy of the arraynodes of each level, defaults to 0
+//   --compact=0|1        enables the compact arraynodes of the maps, defaults to 0
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <wfc/frozen_map.hpp>
+#include <wfc/unordered_map.hpp>
+
+#include "common/options.hpp"
+
+namespace
+{
+	std::atomic<std::size_t> allocated_bytes{0};
+	std::atomic<std::size_t> allocation_count{0};
+
+	// Blocks are accounted with their usable size, which includes the rounding done by malloc.
+	void* counted_allocation(std::size_t size, std::size_t alignment)
+	{
+		void* p = alignment <= alignof(std::max_align_t)
+		              ? std::malloc(size)
+		              : std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+		if (p == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+
+		allocated_bytes.fetch_add(::malloc_usable_size(p), std::memory_order_relaxed);
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+		return p;
+	}
+
+	void counted_deallocation(void* p) noexcept
+	{
+		if (p != nullptr)
+		{
+			allocated_bytes.fetch_sub(::malloc_usable_size(p), std::memory_order_relaxed);
+			std::free(p);
+		}
+	}
+} // namespace
+
+void* operator new(std::size_t size)
+{
+	return counted_allocation(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+	counted_deallocation(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	counted_deallocation(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	counted_deallocation(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	counted_deallocation(p);
+}
+
+namespace
+{
+	struct mixing_hash
+	{
+		std::size_t operator()(std::size_t key) const noexcept
+		{
+			// Finalizer of splitmix64.
+			key = (key ^ (key >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+			key = (key ^ (key >> 27U)) * 0x94D049BB133111EBULL;
+			return key ^ (key >> 31U);
+		}
+	};
+
+	std::size_t resident_bytes()
+	{
+		std::ifstream statm("/proc/self/statm");
+		std::size_t size = 0;
+		std::size_t resident = 0;
+		statm >> size >> resident;
+
+		return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+	}
+
+	std::vector<std::size_t> make_keys(const std::string& distribution, std::size_t n)
+	{
+		std::vector<std::size_t> keys(n);
+		std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			if (distribution == "sequential")
+			{
+				keys[i] = i;
+			}
+			else if (distribution == "strided")
+			{
+				// Low bits are all equal, the worst case for the identity hash.
+				keys[i] = i << 20U;
+			}
+			else
+			{
+				state ^= state << 13U;
+				state ^= state >> 7U;
+				state ^= state << 17U;
+				keys[i] = state;
+			}
+		}
+
+		return keys;
+	}
+
+	void print_levels(const wfc::structure_report& report)
+	{
+		for (std::size_t depth = 0; depth < report.levels.size(); ++depth)
+		{
+			const wfc::level_report& level = report.levels[depth];
+			std::cout << std::setw(24) << "depth " << depth << ": " << level.datanodes << " datanodes, "
+			          << level.arraynodes << " arraynodes, occupancy by tenths";
+			for (std::size_t count: level.occupancy)
+			{
+				std::cout << ' ' << count;
+			}
+			std::cout << '\n';
+		}
+	}
+
+	template <typename Hash>
+	void measure(const std::string& configuration,
+	             const std::string& hash_name,
+	             const std::string& distribution,
+	             const std::vector<std::size_t>& keys,
+	             const wfc::fanout_schedule& schedule,
+	             bool levels,
+	             bool compact)
+	{
+		// Gives the memory of the previous map back to the system, for the resident set size to grow again.
+		::malloc_trim(0);
+		std::size_t rss_before = resident_bytes();
+		std::size_t bytes_before = allocated_bytes.load();
+		std::size_t count_before = allocation_count.load();
+
+		wfc::unordered_map<std::size_t, std::size_t, Hash> map(schedule, 1, 2);
+		if (compact)
+		{
+			map.enable_compact_arraynodes();
+		}
+		for (std::size_t key: keys)
+		{
+			map.insert(key, key);
+		}
+
+		std::size_t bytes = allocated_bytes.load() - bytes_before;
+		std::size_t allocations = allocation_count.load() - count_before;
+		// Freed pages may be reused or given back, so this is only a cross-check of the counted bytes.
+		double rss = static_cast<double>(resident_bytes()) - static_cast<double>(rss_before);
+		wfc::structure_report report = map.structure_stats();
+		wfc::frozen_map<std::size_t, std::size_t, Hash> frozen(map);
+
+		double entries = static_cast<double>(map.size());
+		std::cout << std::setw(18) << configuration << std::setw(10) << hash_name << std::setw(12) << distribution
+		          << std::fixed << std::setprecision(1) << std::setw(10) << static_cast<double>(bytes) / entries
+		          << std::setw(10) << rss / entries << std::setw(12) << allocations
+		          << std::setw(12) << report.arraynodes << std::setprecision(2) << std::setw(10)
+		          << static_cast<double>(report.total_depth) / entries << std::setw(8) << report.max_depth
+		          << std::setprecision(1) << std::setw(10)
+		          << 100.0 * static_cast<double>(report.empty_slots) / static_cast<double>(report.slots)
+		          << std::setw(10)
+		          << static_cast<double>(report.empty_slots * sizeof(std::uintptr_t)) / entries << std::setw(10)
+		          << static_cast<double>(frozen.memory_bytes()) / entries << '\n';
+
+		if (levels)
+		{
+			print_levels(report);
+		}
+	}
+
+	void measure_all(const std::string& configuration,
+	                 const std::vector<std::vector<std::size_t>>& keys,
+	                 const std::vector<std::string>& distributions,
+	                 const wfc::fanout_schedule& schedule,
+	                 bool levels,
+	                 bool compact)
+	{
+		for (std::size_t i = 0; i < distributions.size(); ++i)
+		{
+			measure<wfc::identity_hash<std::size_t>>(
+			    configuration, "identity", distributions[i], keys[i], schedule, levels, compact);
+			measure<mixing_hash>(configuration, "mixing", distributions[i], keys[i], schedule, levels, compact);
+		}
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::options opts(argc, argv);
+	std::size_t entries = opts.get("entries", 1000000);
+	bool levels = opts.get("levels", 0) != 0;
+	bool compact = opts.get("compact", 0) != 0;
+
+	const std::vector<std::string> distributions = {"sequential", "strided", "random"};
+	std::vector<std::vector<std::size_t>> keys;
+	for (const std::string& distribution: distributions)
+	{
+		keys.push_back(make_keys(distribution, entries));
+	}
+
+	using node_t = wfc::details::node_t<std::size_t, std::size_t, std::size_t>;
+	std::cout << entries << " entries, node_t is " << sizeof(node_t) << " bytes"
+	          << (compact ? ", compact arraynodes" : "") << '\n';
+	std::cout << std::setw(18) << "configuration" << std::setw(10) << "hash" << std::setw(12) << "keys"
+	          << std::setw(10) << "B/entry" << std::setw(10) << "RSS/entry" << std::setw(12) << "allocs"
+	          << std::setw(12) << "arraynodes" << std::setw(10) << "avg_depth" << std::setw(8) << "max"
+	          << std::setw(10) << "empty%" << std::setw(10) << "waste/e" << std::setw(10) << "frozen/e" << '\n';
+
+	for (std::size_t array_length: opts.get_list("array-lengths", {2, 4, 8, 16}))
+	{
+		measure_all("array_length=" + std::to_string(array_length),
+		            keys,
+		            distributions,
+		            wfc::fanout_schedule{array_length, wfc::log2_of_power_of_two(array_length)},
+		            levels,
+		            compact);
+	}
+
+	std::vector<std::size_t> schedule = opts.get_list("schedule", {});
+	if (!schedule.empty())
+	{
+		measure_all("schedule", keys, distributions, wfc::fanout_schedule(schedule), levels, compact);
+	}
+
+	return 0;
+}
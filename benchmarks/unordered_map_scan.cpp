@@ -0,0 +1,104 @@
+// Full scans of wfc::unordered_map: visit, visit_bucket over every bucket and structure_stats.
+//
+// Maps of several densities are built with the same schedule, from a few keys per arraynode to full ones, and each
+// scan is timed over every slot of the trie. The benchmark is built twice: UnorderedMapScanBenchmark skips empty
+// slots by blocks with AVX2 or SSE2 when the target has them, UnorderedMapScanScalarBenchmark defines
+// WFC_SCALAR_SLOT_SCAN and tests the slots one by one.
+//
+// Options (lists are comma separated):
+//   --entries=...        numbers of inserted keys, defaults to 1000,10000,100000,1000000
+//   --schedule=...       fanout schedule, defaults to 16,6
+//   --repeats=n          scans of each kind, the best one is reported, defaults to 5
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+#include "common/histogram.hpp"
+#include "common/options.hpp"
+
+namespace
+{
+	// Keys spread over the whole head by the finalizer of splitmix64.
+	std::size_t spread(std::size_t i) noexcept
+	{
+		i = (i ^ (i >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+		i = (i ^ (i >> 27U)) * 0x94D049BB133111EBULL;
+		return i ^ (i >> 31U);
+	}
+
+	template <typename Scan>
+	double best_ns(std::size_t repeats, Scan&& scan)
+	{
+		std::uint64_t best = std::numeric_limits<std::uint64_t>::max();
+		for (std::size_t r = 0; r < repeats; ++r)
+		{
+			std::uint64_t start = bench::now_ns();
+			scan();
+			best = std::min(best, bench::now_ns() - start);
+		}
+
+		return static_cast<double>(best);
+	}
+
+	void run(std::size_t entries, const wfc::fanout_schedule& schedule, std::size_t repeats)
+	{
+		wfc::unordered_map<std::size_t, std::size_t> map(schedule, 1, 2);
+		for (std::size_t i = 0; i < entries; ++i)
+		{
+			map.insert(spread(i), i);
+		}
+
+		wfc::structure_report report = map.structure_stats();
+		double slots = static_cast<double>(report.slots);
+
+		std::size_t checksum = 0;
+		double visit = best_ns(repeats, [&map, &checksum]() {
+			map.visit([&checksum](std::pair<std::size_t, std::size_t> p) { checksum += p.second; });
+		});
+		double buckets = best_ns(repeats, [&map, &checksum]() {
+			for (std::size_t bucket = 0; bucket < map.head_size(); ++bucket)
+			{
+				map.visit_bucket(bucket, [&checksum](const std::size_t&, const std::size_t& value) { checksum += value; });
+			}
+		});
+		double stats = best_ns(repeats, [&map, &checksum]() { checksum += map.structure_stats().datanodes; });
+
+		std::cout << std::setw(10) << entries << std::setw(12) << report.slots << std::fixed << std::setprecision(1)
+		          << std::setw(10) << 100.0 * static_cast<double>(report.empty_slots) / slots << std::setprecision(2)
+		          << std::setw(12) << visit / slots << std::setw(12) << buckets / slots << std::setw(12)
+		          << stats / slots << std::setw(12) << visit / 1e6 << std::setw(20) << checksum << '\n';
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::options opts(argc, argv);
+	std::vector<std::size_t> schedule = opts.get_list("schedule", {16, 6});
+	std::size_t repeats = std::max<std::size_t>(1, opts.get("repeats", 5));
+
+#if WFC_SLOT_SCAN_AVX2
+	std::cout << "AVX2 slot scans, ";
+#elif WFC_SLOT_SCAN_SSE2
+	std::cout << "SSE2 slot scans, ";
+#else
+	std::cout << "scalar slot scans, ";
+#endif
+	std::cout << "times in ns per slot, best of " << repeats << '\n';
+	std::cout << std::setw(10) << "entries" << std::setw(12) << "slots" << std::setw(10) << "empty%" << std::setw(12)
+	          << "visit" << std::setw(12) << "buckets" << std::setw(12) << "stats" << std::setw(12) << "visit ms"
+	          << std::setw(20) << "checksum" << '\n';
+
+	for (std::size_t entries: opts.get_list("entries", {1000, 10000, 100000, 1000000}))
+	{
+		run(entries, wfc::fanout_schedule(schedule), repeats);
+	}
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+// Throughput and latency of wfc::vector against a std::vector guarded by a std::mutex.
+//
+// Every thread first appends values, then reads values at random positions. Each push_back is timestamped and
+// recorded into per-thread histograms, reads are only counted.
+//
+// Options (lists are comma separated):
+//   --threads=...             thread counts, defaults to 1, hardware concurrency, 2x and 4x that
+//   --ops=n                   push_back and reads per thread, defaults to 200000
+//   --first-bucket-size=n     first bucket size of wfc::vector, defaults to 8
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/vector.hpp>
+
+#include "common/histogram.hpp"
+#include "common/options.hpp"
+#include "common/thread_pool.hpp"
+
+namespace
+{
+	class mutex_vector
+	{
+	public:
+		explicit mutex_vector(std::size_t /*first_bucket_size*/) : m_mutex(), m_values()
+		{
+		}
+
+		std::size_t push_back(std::size_t value)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_values.push_back(value);
+			return m_values.size() - 1;
+		}
+
+		// Reallocations move the elements, so readers lock as well.
+		std::size_t operator[](std::size_t index)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_values[index];
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::vector<std::size_t> m_values;
+	};
+
+	struct alignas(64) thread_result
+	{
+		bench::latency_histogram histogram;
+		std::size_t checksum;
+	};
+
+	struct run_parameters
+	{
+		std::size_t nbr_threads;
+		std::size_t ops;
+		std::size_t first_bucket_size;
+	};
+
+	std::uint64_t xorshift(std::uint64_t& state) noexcept
+	{
+		state ^= state << 13U;
+		state ^= state >> 7U;
+		state ^= state << 17U;
+		return state;
+	}
+
+	void print_header()
+	{
+		std::cout << std::setw(8) << "vector" << std::setw(8) << "threads" << std::setw(10) << "p50" << std::setw(10)
+		          << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "p99.99" << std::setw(12) << "max"
+		          << std::setw(14) << "push Mops/s" << std::setw(14) << "read Mops/s" << '\n';
+	}
+
+	template <typename Vector>
+	void run(const std::string& name, bench::thread_pool& pool, const run_parameters& p)
+	{
+		Vector vector(p.first_bucket_size);
+		std::vector<thread_result> results(p.nbr_threads);
+
+		std::uint64_t start = bench::now_ns();
+		pool.run(p.nbr_threads, [&vector, &results, &p](std::size_t index) {
+			for (std::size_t i = 0; i < p.ops; ++i)
+			{
+				std::uint64_t before = bench::now_ns();
+				vector.push_back(i);
+				results[index].histogram.record(bench::now_ns() - before);
+			}
+		});
+		std::uint64_t push_elapsed = bench::now_ns() - start;
+
+		std::size_t total = p.nbr_threads * p.ops;
+		start = bench::now_ns();
+		pool.run(p.nbr_threads, [&vector, &results, &p, total](std::size_t index) {
+			std::uint64_t state = 0x9E3779B97F4A7C15ULL * (index + 1);
+			std::size_t checksum = 0;
+			for (std::size_t i = 0; i < p.ops; ++i)
+			{
+				checksum += vector[xorshift(state) % total];
+			}
+			results[index].checksum = checksum;
+		});
+		std::uint64_t read_elapsed = bench::now_ns() - start;
+
+		bench::latency_histogram h;
+		for (const thread_result& result: results)
+		{
+			h.merge(result.histogram);
+		}
+
+		auto mops = [total](std::uint64_t elapsed) {
+			return static_cast<double>(total) * 1000.0 / static_cast<double>(elapsed);
+		};
+		std::cout << std::setw(8) << name << std::setw(8) << p.nbr_threads << std::setw(10) << h.percentile(0.5)
+		          << std::setw(10) << h.percentile(0.99) << std::setw(10) << h.percentile(0.999) << std::setw(10)
+		          << h.percentile(0.9999) << std::setw(12) << h.max() << std::setw(14) << std::fixed
+		          << std::setprecision(2) << mops(push_elapsed) << std::setw(14) << mops(read_elapsed) << '\n';
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::options opts(argc, argv);
+
+	std::size_t hardware = std::max(1U, std::thread::hardware_concurrency());
+	std::vector<std::size_t> thread_counts = opts.get_list("threads", {1, hardware, 2 * hardware, 4 * hardware});
+	thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+	run_parameters p{};
+	p.ops = opts.get("ops", 200000);
+	p.first_bucket_size = opts.get("first-bucket-size", 8);
+
+	bench::thread_pool pool(*std::max_element(thread_counts.begin(), thread_counts.end()));
+
+	std::cout << "push_back latencies in ns, " << hardware << " hardware threads\n";
+	print_header();
+	for (std::size_t nbr_threads: thread_counts)
+	{
+		p.nbr_threads = nbr_threads;
+		run<wfc::vector<std::size_t>>("wfc", pool, p);
+		run<mutex_vector>("mutex", pool, p);
+	}
+
+	return 0;
+}
@@ -0,0 +1,235 @@
+#ifndef WFC_CONCURRENT_CACHE_HPP
+#define WFC_CONCURRENT_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "details/cache/entry.hpp"
+#include "unordered_map.hpp"
+
+namespace wfc
+{
+	/**
+	 * A concurrent cache holding about capacity elements
+	 *
+	 * @details The cache is an unordered_map whose datanodes hold a CLOCK reference bit next to the value.
+	 * Reading an element only sets its bit. Writers which make the cache exceed its capacity advance a shared clock
+	 * hand over the head buckets of the map: the bits of a bucket are cleared and the elements whose bit was already
+	 * clear are evicted, so an element survives as long as it is read between two sweeps of its bucket.
+	 * Each writer sweeps at most max_sweep_steps buckets, later writers going on from where the hand stopped, hence
+	 * the size may exceed the capacity for a while, until the hand reaches buckets holding unread elements.
+	 *
+	 * @tparam Key type of the key in the cache
+	 * @tparam Value type of the value in the cache, it has to be copy constructible
+	 * @tparam HashFunction @see unordered_map
+	 */
+	template <typename Key, typename Value, typename HashFunction = identity_hash<Key>>
+	class concurrent_cache
+	{
+	public:
+		using key_t = Key;
+		using value_t = Value;
+
+		/**
+		 * @param capacity number of elements above which writers evict elements
+		 * @see unordered_map::unordered_map(const fanout_schedule&, std::size_t, std::size_t, memory_placement)
+		 */
+		concurrent_cache(std::size_t capacity,
+		                 const fanout_schedule& schedule,
+		                 std::size_t max_fail_count = 8,
+		                 std::size_t max_nbr_threads = 8);
+
+		/**
+		 * @param capacity number of elements above which writers evict elements
+		 * @see unordered_map::unordered_map(std::size_t, std::size_t, std::size_t, memory_placement)
+		 */
+		explicit concurrent_cache(std::size_t capacity,
+		                          std::size_t array_length = 16,
+		                          std::size_t max_fail_count = 8,
+		                          std::size_t max_nbr_threads = 8);
+		concurrent_cache(const concurrent_cache&) = delete;
+
+		concurrent_cache& operator=(const concurrent_cache&) = delete;
+
+		/**
+		 * Retrieves the value associated to the key and marks it as recently used.
+		 *
+		 * @return an empty optional if the key is not in the cache. The associated value otherwise.
+		 */
+		std::optional<Value> get(const Key& key);
+
+		/**
+		 * Associates the value to the key, then evicts elements if the cache exceeds its capacity.
+		 *
+		 * @return Returns operation_result::already_present if the key was already in the cache, in which case its
+		 * value is replaced. Otherwise it returns operation_result::success
+		 */
+		operation_result put(const Key& key, const Value& value);
+
+		/**
+		 * Removes the element associated to the key.
+		 *
+		 * @return @see operation_result
+		 */
+		operation_result erase(const Key& key);
+
+		/**
+		 * Advances the clock hand over one head bucket, clearing reference bits and evicting, while the cache exceeds
+		 * its capacity, the elements which weren't read since the previous sweep of that bucket.
+		 *
+		 * @return the number of evicted elements
+		 */
+		std::size_t sweep_step();
+
+		std::size_t capacity() const noexcept;
+
+		/**
+		 * Returns the number of elements into the cache
+		 */
+		std::size_t size() const noexcept;
+
+		/**
+		 * Returns true if the cache is empty, false otherwise.
+		 */
+		bool is_empty() const noexcept;
+
+	private:
+		using entry_t = details::cache_entry<Value>;
+
+		// Buckets swept by a single writer, so that a put never walks more than a few subtrees.
+		static constexpr std::size_t max_sweep_steps = 4;
+
+		/**
+		 * Sweeps buckets until the size is back under the capacity, max_sweep_steps buckets at most.
+		 */
+		void evict();
+
+		unordered_map<Key, entry_t, HashFunction> m_map;
+		std::size_t m_capacity;
+		std::atomic<std::size_t> m_hand;
+	};
+
+	template <typename Key, typename Value, typename HashFunction>
+	concurrent_cache<Key, Value, HashFunction>::concurrent_cache(std::size_t capacity,
+	                                                            const fanout_schedule& schedule,
+	                                                            std::size_t max_fail_count,
+	                                                            std::size_t max_nbr_threads)
+	    : m_map(schedule, max_fail_count, max_nbr_threads), m_capacity(capacity), m_hand(0)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	concurrent_cache<Key, Value, HashFunction>::concurrent_cache(std::size_t capacity,
+	                                                            std::size_t array_length,
+	                                                            std::size_t max_fail_count,
+	                                                            std::size_t max_nbr_threads)
+	    : m_map(array_length, max_fail_count, max_nbr_threads), m_capacity(capacity), m_hand(0)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::optional<Value> concurrent_cache<Key, Value, HashFunction>::get(const Key& key)
+	{
+		std::optional<Value> result;
+		m_map.visit_value(key, [&result](const entry_t& entry) {
+			// Testing the bit first avoids writing to the cache line of entries read often.
+			if (!entry.referenced.load(std::memory_order_relaxed))
+			{
+				entry.referenced.store(true, std::memory_order_relaxed);
+			}
+			result.emplace(entry.value);
+		});
+
+		return result;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	operation_result concurrent_cache<Key, Value, HashFunction>::put(const Key& key, const Value& value)
+	{
+		operation_result result = m_map.insert(key, entry_t(value));
+		if (result == operation_result::already_present)
+		{
+			// The key may have been evicted meanwhile, in which case it is inserted again.
+			if (failed(m_map.update(key, entry_t(value))))
+			{
+				result = m_map.insert(key, entry_t(value));
+			}
+		}
+
+		if (m_map.size() > m_capacity)
+		{
+			evict();
+		}
+
+		return result;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	operation_result concurrent_cache<Key, Value, HashFunction>::erase(const Key& key)
+	{
+		return m_map.remove(key);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t concurrent_cache<Key, Value, HashFunction>::sweep_step()
+	{
+		std::size_t bucket = m_hand.fetch_add(1, std::memory_order_relaxed) % m_map.head_size();
+
+		// Victims are collected first, removing them while visiting would free nodes under the visitor.
+		std::vector<key_t> victims;
+		m_map.visit_bucket(bucket, [&victims](const key_t& key, const entry_t& entry) {
+			if (!entry.referenced.exchange(false, std::memory_order_relaxed))
+			{
+				victims.push_back(key);
+			}
+		});
+
+		std::size_t evicted = 0;
+		for (const key_t& key: victims)
+		{
+			if (m_map.size() <= m_capacity)
+			{
+				break;
+			}
+
+			if (succeeded(m_map.remove(key)))
+			{
+				++evicted;
+			}
+		}
+
+		return evicted;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t concurrent_cache<Key, Value, HashFunction>::capacity() const noexcept
+	{
+		return m_capacity;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t concurrent_cache<Key, Value, HashFunction>::size() const noexcept
+	{
+		return m_map.size();
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool concurrent_cache<Key, Value, HashFunction>::is_empty() const noexcept
+	{
+		return m_map.is_empty();
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void concurrent_cache<Key, Value, HashFunction>::evict()
+	{
+		for (std::size_t steps = max_sweep_steps; steps != 0 && m_map.size() > m_capacity; --steps)
+		{
+			sweep_step();
+		}
+	}
+} // namespace wfc
+
+#endif // WFC_CONCURRENT_CACHE_HPP
@@ -0,0 +1,51 @@
+#ifndef WFC_CACHE_ENTRY_HPP
+#define WFC_CACHE_ENTRY_HPP
+
+#include <atomic>
+
+namespace wfc
+{
+	namespace details
+	{
+		/**
+		 * Value stored in the datanodes of a concurrent_cache, along with its CLOCK reference bit.
+		 * Readers set the bit in place, the eviction sweep clears it, giving the entry a second chance.
+		 */
+		template <typename Value>
+		struct cache_entry
+		{
+			cache_entry() : value(), referenced(true)
+			{
+			}
+
+			explicit cache_entry(const Value& v) : value(v), referenced(true)
+			{
+			}
+
+			cache_entry(const cache_entry& other) : value(other.value), referenced(other.referenced.load())
+			{
+			}
+
+			cache_entry& operator=(const cache_entry& other)
+			{
+				value = other.value;
+				referenced = other.referenced.load();
+				return *this;
+			}
+
+			Value value;
+			mutable std::atomic<bool> referenced;
+		};
+
+		/**
+		 * Entries are compared on their values only.
+		 */
+		template <typename Value>
+		bool operator==(const cache_entry<Value>& lhs, const cache_entry<Value>& rhs)
+		{
+			return lhs.value == rhs.value;
+		}
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_CACHE_ENTRY_HPP
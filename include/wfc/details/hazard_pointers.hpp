@@ -0,0 +1,350 @@
+#ifndef WFC_HAZARD_POINTERS_HPP
+#define WFC_HAZARD_POINTERS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../utility/asymmetric_fence.hpp"
+#include "../utility/sanitizer.hpp"
+#include "../utility/thread_manipulation.hpp"
+
+namespace wfc
+{
+	namespace details
+	{
+		/**
+		 * Sequentially consistent fence between the publication of a hazard and the check that the node is still
+		 * reachable, or between the unlinking of a node and the scan of the hazards.
+		 */
+		inline void hazard_fence() noexcept
+		{
+#if WFC_THREAD_SANITIZER
+			// ThreadSanitizer doesn't model fences, a read-modify-write of a shared variable orders the same way.
+			static std::atomic<std::size_t> fence{0};
+			fence.fetch_add(0, std::memory_order_seq_cst);
+#else
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+		}
+
+		/**
+		 * Hazard pointers shared by the collections of the library.
+		 *
+		 * @details Each thread, identified by get_thread_id(), owns slots_per_thread slots in which it publishes the
+		 * nodes it is about to read. A node may only be freed once no other thread publishes it.
+		 * Nodes can either be freed by their remover as soon as possible, @see is_protected_by_others,
+		 * or be handed to retire, which frees them by batches from a per-thread list.
+		 *
+		 * Publishing a node is followed by a sequentially consistent fence, and so is the unlinking of a node
+		 * before the hazards are scanned. Either the reader then sees the node unlinked when it checks that it's
+		 * still there, or the scan sees the hazard. These are the only fences: hazards are stored with release
+		 * ordering, so that the reads of the node a hazard was protecting happen before the scan which no longer
+		 * sees it, and are loaded with acquire ordering.
+		 * In hazard_fence_mode::asymmetric, the fence of the readers is only a compiler barrier and the scans start
+		 * with a membarrier system call instead, which is worth it when reads outnumber reclamations.
+		 */
+		class hazard_pointers
+		{
+		public:
+			using deleter_t = void (*)(void*);
+
+			hazard_pointers(std::size_t max_nbr_threads, std::size_t slots_per_thread);
+			hazard_pointers(const hazard_pointers&) = delete;
+
+			/**
+			 * Frees every retired node. No thread may use the protected structure anymore.
+			 */
+			~hazard_pointers() noexcept;
+
+			hazard_pointers& operator=(const hazard_pointers&) = delete;
+
+			/**
+			 * Publishes the value, the caller has to check afterwards that it is still reachable.
+			 */
+			void protect(std::size_t slot, std::uintptr_t value) noexcept;
+
+			/**
+			 * Publishes the pointer read from source and returns it once it is known to be still there.
+			 */
+			template <typename T>
+			T* protect(std::size_t slot, const std::atomic<T*>& source) noexcept;
+
+			void clear(std::size_t slot) noexcept;
+
+			void clear_all() noexcept;
+
+			/**
+			 * Returns true if a thread other than the calling one publishes the value.
+			 * The value should be unreachable from the structure already.
+			 */
+			bool is_protected_by_others(std::uintptr_t value) const noexcept;
+
+			/**
+			 * Spins until no thread other than the calling one publishes the value, with a single fence.
+			 * The value should be unreachable from the structure already.
+			 */
+			void wait_until_unprotected(std::uintptr_t value) const noexcept;
+
+			/**
+			 * Returns the values published by threads other than the calling one, sorted, with a single fence.
+			 * Values unreachable from the structure before the call and missing from the result can be freed.
+			 */
+			std::vector<std::uintptr_t> protected_by_others() const;
+
+			/**
+			 * Chooses the fences ordering the hazards, no other thread may use the hazard pointers meanwhile.
+			 *
+			 * @return false if the system doesn't support the mode, which is then left unchanged
+			 */
+			bool set_fence_mode(hazard_fence_mode mode) noexcept;
+
+			hazard_fence_mode fence_mode() const noexcept;
+
+			/**
+			 * Hands a node, already unreachable from the structure, over to the reclamation.
+			 * It is freed with deleter once no thread protects it.
+			 */
+			void retire(void* p, deleter_t deleter);
+
+			std::size_t max_nbr_threads() const noexcept;
+
+		private:
+			struct retired_node
+			{
+				void* ptr;
+				deleter_t deleter;
+			};
+
+			std::atomic<std::uintptr_t>& slot_of(std::size_t thread_id, std::size_t slot) const noexcept;
+
+			bool is_published_by_others(std::uintptr_t value) const noexcept;
+
+			void reader_fence() const noexcept;
+
+			void reclaimer_fence() const noexcept;
+
+			void scan(std::vector<retired_node>& retired);
+
+			std::size_t m_max_nbr_threads;
+			std::size_t m_slots_per_thread;
+			std::size_t m_scan_threshold;
+			std::unique_ptr<std::atomic<std::uintptr_t>[]> m_slots;
+			std::unique_ptr<std::vector<retired_node>[]> m_retired;
+			hazard_fence_mode m_fence_mode;
+		};
+
+		inline hazard_pointers::hazard_pointers(std::size_t max_nbr_threads, std::size_t slots_per_thread)
+		    : m_max_nbr_threads(max_nbr_threads)
+		    , m_slots_per_thread(slots_per_thread)
+		    , m_scan_threshold(std::max<std::size_t>(64, 2 * max_nbr_threads * slots_per_thread))
+		    , m_slots(new std::atomic<std::uintptr_t>[max_nbr_threads * slots_per_thread])
+		    , m_retired(new std::vector<retired_node>[max_nbr_threads])
+		    , m_fence_mode(hazard_fence_mode::symmetric)
+		{
+			for (std::size_t i = 0; i < max_nbr_threads * slots_per_thread; ++i)
+			{
+				m_slots[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		inline hazard_pointers::~hazard_pointers() noexcept
+		{
+			for (std::size_t t = 0; t < m_max_nbr_threads; ++t)
+			{
+				for (const retired_node& node: m_retired[t])
+				{
+					node.deleter(node.ptr);
+				}
+			}
+		}
+
+		inline void hazard_pointers::protect(std::size_t slot, std::uintptr_t value) noexcept
+		{
+			slot_of(get_thread_id(), slot).store(value, std::memory_order_release);
+			reader_fence();
+		}
+
+		template <typename T>
+		T* hazard_pointers::protect(std::size_t slot, const std::atomic<T*>& source) noexcept
+		{
+			std::atomic<std::uintptr_t>& hazard = slot_of(get_thread_id(), slot);
+			T* ptr = source.load(std::memory_order_acquire);
+			while (true)
+			{
+				hazard.store(reinterpret_cast<std::uintptr_t>(ptr), std::memory_order_release);
+				reader_fence();
+				T* current = source.load(std::memory_order_acquire);
+				if (current == ptr)
+				{
+					return ptr;
+				}
+				ptr = current;
+			}
+		}
+
+		inline void hazard_pointers::clear(std::size_t slot) noexcept
+		{
+			slot_of(get_thread_id(), slot).store(0, std::memory_order_release);
+		}
+
+		inline void hazard_pointers::clear_all() noexcept
+		{
+			for (std::size_t slot = 0; slot < m_slots_per_thread; ++slot)
+			{
+				clear(slot);
+			}
+		}
+
+		inline bool hazard_pointers::is_protected_by_others(std::uintptr_t value) const noexcept
+		{
+			reclaimer_fence();
+			return is_published_by_others(value);
+		}
+
+		inline void hazard_pointers::wait_until_unprotected(std::uintptr_t value) const noexcept
+		{
+			// Threads which didn't publish the value before the fence can't find it anymore.
+			reclaimer_fence();
+			while (is_published_by_others(value))
+			{
+			}
+		}
+
+		inline std::vector<std::uintptr_t> hazard_pointers::protected_by_others() const
+		{
+			reclaimer_fence();
+
+			const std::size_t self = get_thread_id();
+			std::vector<std::uintptr_t> hazards;
+			for (std::size_t i = 0; i < m_max_nbr_threads * m_slots_per_thread; ++i)
+			{
+				std::uintptr_t value = m_slots[i].load(std::memory_order_acquire);
+				if (value != 0 && i / m_slots_per_thread != self)
+				{
+					hazards.push_back(value);
+				}
+			}
+			std::sort(hazards.begin(), hazards.end());
+
+			return hazards;
+		}
+
+		inline bool hazard_pointers::set_fence_mode(hazard_fence_mode mode) noexcept
+		{
+			if (mode == hazard_fence_mode::asymmetric && !asymmetric_fence_supported())
+			{
+				return false;
+			}
+
+			m_fence_mode = mode;
+			return true;
+		}
+
+		inline hazard_fence_mode hazard_pointers::fence_mode() const noexcept
+		{
+			return m_fence_mode;
+		}
+
+		inline bool hazard_pointers::is_published_by_others(std::uintptr_t value) const noexcept
+		{
+			const std::size_t self = get_thread_id();
+			for (std::size_t t = 0; t < m_max_nbr_threads; ++t)
+			{
+				if (t == self)
+				{
+					continue;
+				}
+
+				for (std::size_t slot = 0; slot < m_slots_per_thread; ++slot)
+				{
+					if (slot_of(t, slot).load(std::memory_order_acquire) == value)
+					{
+						return true;
+					}
+				}
+			}
+
+			return false;
+		}
+
+		inline void hazard_pointers::retire(void* p, deleter_t deleter)
+		{
+			std::vector<retired_node>& retired = m_retired[get_thread_id()];
+			retired.push_back({p, deleter});
+
+			if (retired.size() >= m_scan_threshold)
+			{
+				scan(retired);
+			}
+		}
+
+		inline std::size_t hazard_pointers::max_nbr_threads() const noexcept
+		{
+			return m_max_nbr_threads;
+		}
+
+		inline std::atomic<std::uintptr_t>& hazard_pointers::slot_of(std::size_t thread_id, std::size_t slot) const
+		    noexcept
+		{
+			return m_slots[thread_id * m_slots_per_thread + slot];
+		}
+
+		inline void hazard_pointers::reader_fence() const noexcept
+		{
+			if (m_fence_mode == hazard_fence_mode::asymmetric)
+			{
+				details::light_fence();
+			}
+			else
+			{
+				hazard_fence();
+			}
+		}
+
+		inline void hazard_pointers::reclaimer_fence() const noexcept
+		{
+			if (m_fence_mode == hazard_fence_mode::asymmetric)
+			{
+				details::heavy_fence();
+			}
+			else
+			{
+				hazard_fence();
+			}
+		}
+
+		inline void hazard_pointers::scan(std::vector<retired_node>& retired)
+		{
+			reclaimer_fence();
+
+			std::vector<std::uintptr_t> hazards;
+			hazards.reserve(m_max_nbr_threads * m_slots_per_thread);
+			for (std::size_t i = 0; i < m_max_nbr_threads * m_slots_per_thread; ++i)
+			{
+				std::uintptr_t value = m_slots[i].load(std::memory_order_acquire);
+				if (value != 0)
+				{
+					hazards.push_back(value);
+				}
+			}
+			std::sort(hazards.begin(), hazards.end());
+
+			auto still_protected = [&hazards](const retired_node& node) {
+				return std::binary_search(hazards.begin(), hazards.end(), reinterpret_cast<std::uintptr_t>(node.ptr));
+			};
+
+			auto freed = std::partition(retired.begin(), retired.end(), still_protected);
+			for (auto it = freed; it != retired.end(); ++it)
+			{
+				it->deleter(it->ptr);
+			}
+			retired.erase(freed, retired.end());
+		}
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_HAZARD_POINTERS_HPP
@@ -0,0 +1,48 @@
+#ifndef WFC_QUEUE_NODES_HPP
+#define WFC_QUEUE_NODES_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace wfc
+{
+	namespace details
+	{
+		constexpr std::size_t no_thread = std::numeric_limits<std::size_t>::max();
+
+		/**
+		 * Node of the linked list of a queue. The first node of the list is a sentinel whose value was dequeued.
+		 */
+		template <typename T>
+		struct queue_node_t
+		{
+			std::optional<T> value;
+			std::atomic<queue_node_t*> next;
+			std::size_t enqueuer; /**< thread which enqueued the node */
+			std::atomic<std::size_t> dequeuer; /**< thread whose dequeue removes the node from the head */
+		};
+
+		/**
+		 * Operation announced by a thread, which other threads help to complete.
+		 * Descriptors are immutable, a thread's state is changed by replacing its descriptor.
+		 */
+		template <typename T>
+		struct operation_desc_t
+		{
+			std::uint64_t phase;
+			bool pending;
+			bool enqueue;
+			/**
+			 * Enqueue: the node to link.
+			 * Dequeue: the sentinel preceding the dequeued node, nullptr if the queue was empty.
+			 */
+			queue_node_t<T>* node;
+			std::optional<T> value; /**< dequeued value, set once a dequeue completes */
+		};
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_QUEUE_NODES_HPP
@@ -0,0 +1,130 @@
+#ifndef WFC_CHANGE_LOG_HPP
+#define WFC_CHANGE_LOG_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "../../utility/spsc_ring.hpp"
+
+namespace wfc
+{
+	/**
+	 * @brief kind of modification recorded in the change log.
+	 */
+	enum class change_type : std::uint8_t
+	{
+		insert, /**< the key was inserted with the given value */
+		update, /**< the value associated to the key was replaced by the given value */
+		remove /**< the key was removed, the given value is the removed one */
+	};
+
+	/**
+	 * A successful modification of an unordered_map.
+	 */
+	template <typename Key, typename Value>
+	struct change_record
+	{
+		change_type type;
+		Key key;
+		Value value;
+	};
+
+	namespace details
+	{
+		/**
+		 * Set of per-thread change rings.
+		 * Each thread only pushes into its own ring, so that recording a change is a wait-free ring push.
+		 * Rings are allocated up front, one per thread id lower than max_nbr_threads.
+		 * Rings are drained by a single consumer at a time.
+		 */
+		template <typename Key, typename Value>
+		class change_log
+		{
+		public:
+			using record_t = change_record<Key, Value>;
+
+			change_log(std::size_t max_nbr_threads, std::size_t capacity_per_thread);
+			change_log(const change_log&) = delete;
+			~change_log() noexcept = default;
+
+			change_log& operator=(const change_log&) = delete;
+
+			/**
+			 * Records a change made by the thread thread_id.
+			 * If the ring of this thread is full, or if thread_id isn't lower than max_nbr_threads, the change is
+			 * dropped and the log is flagged as overflowed.
+			 */
+			void push(std::size_t thread_id, change_type type, const Key& key, const Value& value);
+
+			/**
+			 * Pops every recorded change and applies fun on it.
+			 * @return the number of drained changes
+			 */
+			template <typename Fun>
+			std::size_t drain(Fun&& fun);
+
+			/**
+			 * Returns true if changes were dropped since the last call, and resets the flag.
+			 */
+			bool reset_overflow() noexcept;
+
+		private:
+			std::unique_ptr<std::unique_ptr<spsc_ring<record_t>>[]> m_rings;
+			std::size_t m_nbr_rings;
+			std::atomic<bool> m_overflowed;
+		};
+
+		template <typename Key, typename Value>
+		change_log<Key, Value>::change_log(std::size_t max_nbr_threads, std::size_t capacity_per_thread)
+		    : m_rings{new std::unique_ptr<spsc_ring<record_t>>[max_nbr_threads]}
+		    , m_nbr_rings{max_nbr_threads}
+		    , m_overflowed{false}
+		{
+			for (std::size_t i = 0; i < m_nbr_rings; ++i)
+			{
+				m_rings[i] = std::make_unique<spsc_ring<record_t>>(capacity_per_thread);
+			}
+		}
+
+		template <typename Key, typename Value>
+		void change_log<Key, Value>::push(std::size_t thread_id,
+		                                  change_type type,
+		                                  const Key& key,
+		                                  const Value& value)
+		{
+			if (thread_id >= m_nbr_rings || !m_rings[thread_id]->push(record_t{type, key, value}))
+			{
+				m_overflowed.store(true, std::memory_order_relaxed);
+			}
+		}
+
+		template <typename Key, typename Value>
+		template <typename Fun>
+		std::size_t change_log<Key, Value>::drain(Fun&& fun)
+		{
+			std::size_t count = 0;
+			record_t record;
+			for (std::size_t i = 0; i < m_nbr_rings; ++i)
+			{
+				while (m_rings[i]->pop(record))
+				{
+					std::invoke(fun, std::as_const(record));
+					++count;
+				}
+			}
+
+			return count;
+		}
+
+		template <typename Key, typename Value>
+		bool change_log<Key, Value>::reset_overflow() noexcept
+		{
+			return m_overflowed.exchange(false);
+		}
+	} // namespace details
+} // namespace wfc
+#endif // WFC_CHANGE_LOG_HPP
@@ -0,0 +1,54 @@
+#ifndef WFC_EXPIRY_HPP
+#define WFC_EXPIRY_HPP
+
+#include <chrono>
+
+namespace wfc
+{
+	namespace details
+	{
+		using expiry_clock = std::chrono::steady_clock;
+
+		/**
+		 * Tells whether the values of a map carry an expiry timestamp.
+		 * Maps whose values don't never check for expired datanodes.
+		 */
+		template <typename Value>
+		struct expiry_traits
+		{
+			static constexpr bool enabled = false;
+		};
+
+		/**
+		 * Value stored in the datanodes of an expiring_map.
+		 */
+		template <typename Value>
+		struct timed_value
+		{
+			Value value;
+			expiry_clock::time_point expiry;
+		};
+
+		/**
+		 * Used by threads completing a multi-key operation to check the datanodes it replaces.
+		 */
+		template <typename Value>
+		bool operator==(const timed_value<Value>& lhs, const timed_value<Value>& rhs)
+		{
+			return lhs.value == rhs.value && lhs.expiry == rhs.expiry;
+		}
+
+		template <typename Value>
+		struct expiry_traits<timed_value<Value>>
+		{
+			static constexpr bool enabled = true;
+
+			static bool is_expired(const timed_value<Value>& v) noexcept
+			{
+				return v.expiry <= expiry_clock::now();
+			}
+		};
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_EXPIRY_HPP
@@ -0,0 +1,69 @@
+#ifndef WFC_MCAS_HPP
+#define WFC_MCAS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "nodes.hpp"
+
+namespace wfc
+{
+	namespace details
+	{
+		enum class mcas_status
+		{
+			undecided, /**< the descriptor is being installed in its slots */
+			succeeded, /**< every slot was installed, they receive their desired datanodes */
+			failed /**< a slot didn't hold its expected datanode, they get it back */
+		};
+
+		/**
+		 * Multi-word compare-and-swap over slots of a map, as described in
+		 * T. Harris, K. Fraser et I. Pratt, « A Practical Multi-Word Compare-and-Swap Operation ».
+		 *
+		 * @details The descriptor is installed in its slots in address order, in place of their expected datanodes.
+		 * Once every slot holds it, or one of them can't, its status is decided and each slot is released with its
+		 * desired or its expected datanode. Any thread reading a slot holding a descriptor helps it complete,
+		 * installing its remaining slots, and first helps the descriptor holding one of them if any. A slot
+		 * installed after the status was decided is released by the thread which installed it, instead of the
+		 * conditional install of the original algorithm.
+		 */
+		template <typename Hash, typename Key, typename Value>
+		struct mcas_descriptor
+		{
+			using node_type = node_t<Hash, Key, Value>;
+
+			struct entry
+			{
+				std::atomic<node_union<node_type>>* slot;
+				node_union<node_type> expected;
+				node_union<node_type> desired;
+				Hash hash; /**< hash of the expected datanode */
+				Value value; /**< value read from the expected datanode */
+			};
+
+			std::atomic<mcas_status> status;
+			std::vector<entry> entries; /**< sorted by slot address */
+		};
+
+		/**
+		 * Returns the slot value standing for the descriptor.
+		 */
+		template <typename Hash, typename Key, typename Value>
+		node_union<node_t<Hash, Key, Value>> tag_descriptor(mcas_descriptor<Hash, Key, Value>* desc) noexcept
+		{
+			node_union<node_t<Hash, Key, Value>> node;
+			node.ptr_int = reinterpret_cast<std::uintptr_t>(desc) | 0b100UL;
+			return node;
+		}
+
+		template <typename Hash, typename Key, typename Value>
+		mcas_descriptor<Hash, Key, Value>* untag_descriptor(node_union<node_t<Hash, Key, Value>> node) noexcept
+		{
+			return reinterpret_cast<mcas_descriptor<Hash, Key, Value>*>(node.ptr_int & ~0b100UL);
+		}
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_MCAS_HPP
@@ -2,7 +2,13 @@
 #define WFC_NODES_HPP
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <new>
+#include <utility>
+
+#include "../../utility/math.hpp"
+#include "../../utility/memory_resource.hpp"
 
 namespace wfc
 {
@@ -19,6 +25,37 @@ namespace wfc
 			Value value;
 		};
 
+		/**
+		 * Value type of the collections storing keys only.
+		 */
+		struct no_value
+		{
+		};
+
+		constexpr bool operator==(no_value, no_value) noexcept
+		{
+			return true;
+		}
+
+		/**
+		 * Datanode of the collections storing keys only, which doesn't pay for a value field.
+		 */
+		template <typename Hash, typename Key>
+		struct node_t<Hash, Key, no_value>
+		{
+			node_t(Hash h, Key k, no_value) : hash(std::move(h)), key(std::move(k))
+			{
+			}
+
+			Hash hash;
+			Key key;
+			static constexpr no_value value{};
+		};
+
+		/**
+		 * Array of slots. Its slots are allocated from the given memory resource.
+		 * Children are owned by the collection, which is responsible for freeing them.
+		 */
 		template <typename NodeT>
 		struct arraynode_t
 		{
@@ -26,7 +63,7 @@ namespace wfc
 			using reference_t = value_t&;
 			using const_reference_t = const value_t&;
 
-			explicit arraynode_t(std::size_t size);
+			arraynode_t(std::size_t size, memory_resource* resource);
 
 			arraynode_t(const arraynode_t&) noexcept = delete;
 			~arraynode_t() noexcept;
@@ -37,9 +74,76 @@ namespace wfc
 
 			const_reference_t operator[](std::size_t i) const noexcept;
 
+			std::size_t size() const noexcept;
+
+			memory_resource* resource() const noexcept;
+
 		private:
 			value_t* m_ptr;
 			std::size_t m_size;
+			memory_resource* m_resource;
+		};
+
+		/**
+		 * Arraynode of a sparse level holding datanodes only, as in a hash array mapped trie.
+		 * Bit i of the bitmap is set if position i holds a datanode, and the datanodes follow the node in the order of
+		 * their positions: the one at position i has the index popcount(bitmap & ((1 << i) - 1)).
+		 * It is never modified once reachable, but replaced by an updated copy.
+		 */
+		template <typename NodeT>
+		class compact_node_t
+		{
+		public:
+			static constexpr std::size_t max_positions = 64;
+
+			/**
+			 * Allocates a node from the resource, with a null datanode for each bit of the bitmap.
+			 */
+			static compact_node_t* create(std::uint64_t bitmap, memory_resource* resource);
+
+			static void destroy(compact_node_t* node) noexcept;
+
+			compact_node_t(const compact_node_t&) = delete;
+
+			compact_node_t& operator=(const compact_node_t&) = delete;
+
+			std::uint64_t bitmap() const noexcept;
+
+			/**
+			 * Returns the number of datanodes.
+			 */
+			std::size_t size() const noexcept;
+
+			bool contains(std::size_t position) const noexcept;
+
+			/**
+			 * Returns the index of the datanode at the position, or the index it would be inserted at.
+			 */
+			std::size_t index_of(std::size_t position) const noexcept;
+
+			NodeT*& operator[](std::size_t index) noexcept;
+
+			NodeT* operator[](std::size_t index) const noexcept;
+
+			memory_resource* resource() const noexcept;
+
+			/**
+			 * Calls fun with the position and the datanode of each index, by increasing position.
+			 */
+			template <typename Fun>
+			void for_each(Fun&& fun) const;
+
+		private:
+			compact_node_t(std::uint64_t bitmap, memory_resource* resource) noexcept;
+
+			static std::size_t bytes(std::size_t size) noexcept;
+
+			NodeT** children() noexcept;
+
+			NodeT* const* children() const noexcept;
+
+			std::uint64_t m_bitmap;
+			memory_resource* m_resource;
 		};
 
 		template <typename NodeT>
@@ -57,6 +161,25 @@ namespace wfc
 		template <typename NodeT>
 		bool is_array_node(node_union<NodeT> node) noexcept;
 
+		/**
+		 * Returns true if the slot value is a multi-key operation descriptor, @see mcas_descriptor
+		 */
+		template <typename NodeT>
+		bool is_descriptor(node_union<NodeT> node) noexcept;
+
+		/**
+		 * Returns true if the slot value is a compact arraynode, @see compact_node_t
+		 * Marking it, as a datanode, freezes it until it is replaced by a full arraynode.
+		 */
+		template <typename NodeT>
+		bool is_compact_node(node_union<NodeT> node) noexcept;
+
+		template <typename NodeT>
+		node_union<NodeT> tag_compact_node(compact_node_t<NodeT>* node) noexcept;
+
+		template <typename NodeT>
+		compact_node_t<NodeT>* untag_compact_node(node_union<NodeT> node) noexcept;
+
 		template <typename NodeT>
 		node_union<NodeT> mark_datanode(node_union<NodeT> arraynode, std::size_t position) noexcept;
 
@@ -84,17 +207,51 @@ namespace wfc
 		template <typename NodeT>
 		bool is_array_node(node_union<NodeT> node) noexcept
 		{
-			return static_cast<bool>(node.ptr_int & 0b10UL);
+			return (node.ptr_int & 0b110UL) == 0b010UL;
+		}
+
+		template <typename NodeT>
+		bool is_descriptor(node_union<NodeT> node) noexcept
+		{
+			return (node.ptr_int & 0b110UL) == 0b100UL;
+		}
+
+		template <typename NodeT>
+		bool is_compact_node(node_union<NodeT> node) noexcept
+		{
+			return (node.ptr_int & 0b110UL) == 0b110UL;
+		}
+
+		template <typename NodeT>
+		auto tag_compact_node(compact_node_t<NodeT>* node) noexcept -> node_union<NodeT>
+		{
+			node_union<NodeT> tagged;
+			tagged.ptr_int = reinterpret_cast<std::uintptr_t>(node) | 0b110UL;
+			return tagged;
+		}
+
+		template <typename NodeT>
+		compact_node_t<NodeT>* untag_compact_node(node_union<NodeT> node) noexcept
+		{
+			return reinterpret_cast<compact_node_t<NodeT>*>(node.ptr_int & ~0b111UL);
 		}
 
 		template <typename NodeT>
 		auto mark_datanode(node_union<NodeT> arraynode, std::size_t position) noexcept -> node_union<NodeT>
 		{
 			node_union oldValue = get_node(arraynode, position);
+			// A slot holding a descriptor is released by the descriptor, it can't be expanded meanwhile.
+			if (is_descriptor(oldValue))
+			{
+				return oldValue;
+			}
+
 			node_union value = oldValue;
 			mark_datanode(value);
 
-			(*sanitize_ptr(arraynode).arraynode_ptr)[position].compare_exchange_weak(oldValue, value);
+			// The mark publishes nothing, the slot is read again with acquire ordering.
+			(*sanitize_ptr(arraynode).arraynode_ptr)[position].compare_exchange_weak(
+			    oldValue, value, std::memory_order_relaxed);
 
 			return get_node(arraynode, position);
 		}
@@ -136,7 +293,7 @@ namespace wfc
 
 			node_union accessor = sanitize_ptr(arraynode);
 
-			return (*accessor.arraynode_ptr)[pos].load();
+			return (*accessor.arraynode_ptr)[pos].load(std::memory_order_acquire);
 		}
 
 		template <typename NodeT>
@@ -162,7 +319,10 @@ namespace wfc
 		}
 
 		template <typename NodeT>
-		arraynode_t<NodeT>::arraynode_t(std::size_t size) : m_ptr{new value_t[size]}, m_size(size)
+		arraynode_t<NodeT>::arraynode_t(std::size_t size, memory_resource* resource)
+		    : m_ptr{static_cast<value_t*>(resource->allocate(size * sizeof(value_t), alignof(value_t)))}
+		    , m_size(size)
+		    , m_resource(resource)
 		{
 			for (std::size_t i = 0; i < size; ++i)
 			{
@@ -175,22 +335,10 @@ namespace wfc
 		{
 			for (std::size_t i = 0; i < m_size; ++i)
 			{
-				node_union child = m_ptr[i].load();
-				if (child.arraynode_ptr != nullptr)
-				{
-					if (is_array_node(child))
-					{
-						delete sanitize_ptr(child).arraynode_ptr;
-					}
-					else
-					{
-						delete child.datanode_ptr;
-					}
-				}
-				m_ptr[i].store({});
+				m_ptr[i].~value_t();
 			}
 
-			delete[] m_ptr;
+			m_resource->deallocate(m_ptr, m_size * sizeof(value_t), alignof(value_t));
 		}
 
 		template <typename NodeT>
@@ -204,6 +352,119 @@ namespace wfc
 		{
 			return m_ptr[i];
 		}
+
+		template <typename NodeT>
+		std::size_t arraynode_t<NodeT>::size() const noexcept
+		{
+			return m_size;
+		}
+
+		template <typename NodeT>
+		memory_resource* arraynode_t<NodeT>::resource() const noexcept
+		{
+			return m_resource;
+		}
+
+		template <typename NodeT>
+		compact_node_t<NodeT>* compact_node_t<NodeT>::create(std::uint64_t bitmap, memory_resource* resource)
+		{
+			std::size_t size = popcount(static_cast<unsigned long long>(bitmap));
+			void* memory = resource->allocate(bytes(size), alignof(compact_node_t));
+			auto* node = new (memory) compact_node_t(bitmap, resource);
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				new (&node->children()[i]) NodeT*(nullptr);
+			}
+
+			return node;
+		}
+
+		template <typename NodeT>
+		void compact_node_t<NodeT>::destroy(compact_node_t* node) noexcept
+		{
+			memory_resource* resource = node->m_resource;
+			std::size_t size = node->size();
+			node->~compact_node_t();
+			resource->deallocate(node, bytes(size), alignof(compact_node_t));
+		}
+
+		template <typename NodeT>
+		compact_node_t<NodeT>::compact_node_t(std::uint64_t bitmap, memory_resource* resource) noexcept
+		    : m_bitmap(bitmap), m_resource(resource)
+		{
+		}
+
+		template <typename NodeT>
+		std::uint64_t compact_node_t<NodeT>::bitmap() const noexcept
+		{
+			return m_bitmap;
+		}
+
+		template <typename NodeT>
+		std::size_t compact_node_t<NodeT>::size() const noexcept
+		{
+			return popcount(static_cast<unsigned long long>(m_bitmap));
+		}
+
+		template <typename NodeT>
+		bool compact_node_t<NodeT>::contains(std::size_t position) const noexcept
+		{
+			return (m_bitmap >> position & 1U) != 0;
+		}
+
+		template <typename NodeT>
+		std::size_t compact_node_t<NodeT>::index_of(std::size_t position) const noexcept
+		{
+			return popcount(static_cast<unsigned long long>(m_bitmap & ((std::uint64_t{1} << position) - 1)));
+		}
+
+		template <typename NodeT>
+		NodeT*& compact_node_t<NodeT>::operator[](std::size_t index) noexcept
+		{
+			return children()[index];
+		}
+
+		template <typename NodeT>
+		NodeT* compact_node_t<NodeT>::operator[](std::size_t index) const noexcept
+		{
+			return children()[index];
+		}
+
+		template <typename NodeT>
+		memory_resource* compact_node_t<NodeT>::resource() const noexcept
+		{
+			return m_resource;
+		}
+
+		template <typename NodeT>
+		template <typename Fun>
+		void compact_node_t<NodeT>::for_each(Fun&& fun) const
+		{
+			std::size_t index = 0;
+			for (std::uint64_t bits = m_bitmap; bits != 0; bits &= bits - 1)
+			{
+				fun(static_cast<std::size_t>(ctz(static_cast<unsigned long long>(bits))), children()[index++]);
+			}
+		}
+
+		template <typename NodeT>
+		std::size_t compact_node_t<NodeT>::bytes(std::size_t size) noexcept
+		{
+			return sizeof(compact_node_t) + size * sizeof(NodeT*);
+		}
+
+		template <typename NodeT>
+		NodeT** compact_node_t<NodeT>::children() noexcept
+		{
+			// The datanodes are allocated right after the node, whose size is a multiple of their alignment.
+			return reinterpret_cast<NodeT**>(this + 1);
+		}
+
+		template <typename NodeT>
+		NodeT* const* compact_node_t<NodeT>::children() const noexcept
+		{
+			return reinterpret_cast<NodeT* const*>(this + 1);
+		}
 	} // namespace details
 } // namespace wfc
 #endif // WFC_NODES_HPP
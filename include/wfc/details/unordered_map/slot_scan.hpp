@@ -0,0 +1,117 @@
+#ifndef WFC_SLOT_SCAN_HPP
+#define WFC_SLOT_SCAN_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "../../utility/math.hpp"
+#include "../../utility/sanitizer.hpp"
+#include "nodes.hpp"
+
+// Define WFC_SCALAR_SLOT_SCAN to scan the slots one by one, for instance to compare with the vectorized scans.
+#if defined(WFC_SCALAR_SLOT_SCAN) || WFC_THREAD_SANITIZER
+#	define WFC_SLOT_SCAN_AVX2 0
+#	define WFC_SLOT_SCAN_SSE2 0
+#elif defined(__AVX2__)
+#	define WFC_SLOT_SCAN_AVX2 1
+#	define WFC_SLOT_SCAN_SSE2 0
+#elif defined(__SSE2__) || defined(_M_X64)
+#	define WFC_SLOT_SCAN_AVX2 0
+#	define WFC_SLOT_SCAN_SSE2 1
+#else
+#	define WFC_SLOT_SCAN_AVX2 0
+#	define WFC_SLOT_SCAN_SSE2 0
+#endif
+
+#if WFC_SLOT_SCAN_AVX2 || WFC_SLOT_SCAN_SSE2
+#	include <immintrin.h>
+#endif
+
+namespace wfc
+{
+	namespace details
+	{
+		/**
+		 * Number of slots whose occupancy is given by a single call to occupied_slots.
+		 */
+		constexpr std::size_t slot_scan_block = 64;
+
+		/**
+		 * Returns a mask whose bit i is set if the slot first + i holds a node, for the count slots from first,
+		 * count being at most slot_scan_block.
+		 *
+		 * @details With AVX2 or SSE2, the slots are compared to null by vectors of four or two slots. These loads
+		 * aren't atomic: a set bit only tells which slots are worth loading, the nodes must still be read from
+		 * their slot with an atomic load.
+		 */
+		template <typename NodeT>
+		std::uint64_t occupied_slots(const arraynode_t<NodeT>& array, std::size_t first, std::size_t count) noexcept;
+
+		/**
+		 * Calls fun with the position of every slot in [first, last) which holds a node, in increasing order.
+		 */
+		template <typename NodeT, typename Fun>
+		void for_each_occupied_slot(const arraynode_t<NodeT>& array, std::size_t first, std::size_t last, Fun&& fun);
+
+		template <typename NodeT>
+		std::uint64_t occupied_slots(const arraynode_t<NodeT>& array, std::size_t first, std::size_t count) noexcept
+		{
+			static_assert(sizeof(typename arraynode_t<NodeT>::value_t) == sizeof(std::uint64_t),
+			              "Slots should be 64 bits wide to be scanned by vectors");
+			assert(count <= slot_scan_block);
+
+			std::uint64_t mask = 0;
+			std::size_t i = 0;
+#if WFC_SLOT_SCAN_AVX2 || WFC_SLOT_SCAN_SSE2
+			const auto* slots = reinterpret_cast<const char*>(&array[first]);
+#endif
+#if WFC_SLOT_SCAN_AVX2
+			const __m256i zero = _mm256_setzero_si256();
+			for (; i + 4 <= count; i += 4)
+			{
+				__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i * sizeof(std::uint64_t)));
+				__m256d empty = _mm256_castsi256_pd(_mm256_cmpeq_epi64(block, zero));
+				mask |= (~static_cast<std::uint64_t>(_mm256_movemask_pd(empty)) & 0b1111U) << i;
+			}
+#elif WFC_SLOT_SCAN_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 2 <= count; i += 2)
+			{
+				__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(slots + i * sizeof(std::uint64_t)));
+				// Without a 64 bits comparison, the halves of each slot are merged before comparing them to zero.
+				block = _mm_or_si128(block, _mm_shuffle_epi32(block, _MM_SHUFFLE(2, 3, 0, 1)));
+				__m128d empty = _mm_castsi128_pd(_mm_cmpeq_epi32(block, zero));
+				mask |= (~static_cast<std::uint64_t>(_mm_movemask_pd(empty)) & 0b11U) << i;
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				if (array[first + i].load(std::memory_order_relaxed).ptr_int != 0)
+				{
+					mask |= std::uint64_t{1} << i;
+				}
+			}
+
+			return mask;
+		}
+
+		template <typename NodeT, typename Fun>
+		void for_each_occupied_slot(const arraynode_t<NodeT>& array, std::size_t first, std::size_t last, Fun&& fun)
+		{
+			for (std::size_t block = first; block < last; block += slot_scan_block)
+			{
+				std::uint64_t mask = occupied_slots(array, block, std::min(slot_scan_block, last - block));
+				while (mask != 0)
+				{
+					fun(block + static_cast<std::size_t>(ctz(static_cast<unsigned long long>(mask))));
+					mask &= mask - 1;
+				}
+			}
+		}
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_SLOT_SCAN_HPP
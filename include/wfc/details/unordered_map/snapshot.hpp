@@ -0,0 +1,216 @@
+#ifndef WFC_SNAPSHOT_HPP
+#define WFC_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace wfc
+{
+	namespace details
+	{
+		/**
+		 * Binary snapshot format of an unordered_map.
+		 *
+		 * @details A snapshot is a header followed by a sequence of chunks. Each chunk holds the elements of one
+		 * head bucket: a chunk_header then `count` records made of the raw bytes of the key followed by the raw
+		 * bytes of the value. Chunks are written by increasing bucket index and each bucket appears at most once,
+		 * so that a loader can build the buckets independently. The sequence is terminated by a chunk_header whose
+		 * bucket is end_of_chunks and whose count is the total number of records.
+		 * Integers are stored in the native byte order, which is checked with the byte_order field.
+		 * The header also records the bit order and a digest of the level widths of the map, a loader only building
+		 * buckets in parallel when they match its own.
+		 *
+		 * A delta (incremental checkpoint) starts with the same header, tagged with delta_magic, and the number of
+		 * records. Each record is made of a presence byte, the raw bytes of the key and the raw bytes of the value.
+		 * A record whose presence byte is 0 means that the key was removed.
+		 */
+		namespace snapshot
+		{
+			constexpr char magic[8] = {'W', 'F', 'C', 'S', 'N', 'A', 'P', '\0'};
+			constexpr char delta_magic[8] = {'W', 'F', 'C', 'D', 'E', 'L', 'T', 'A'};
+			constexpr std::uint32_t version = 2;
+			constexpr std::uint32_t byte_order = 0x01020304;
+			constexpr std::uint64_t end_of_chunks = std::numeric_limits<std::uint64_t>::max();
+
+			struct header
+			{
+				char magic[8];
+				std::uint32_t version;
+				std::uint32_t byte_order;
+				std::uint64_t key_size;
+				std::uint64_t value_size;
+				std::uint64_t head_size;
+				std::uint32_t bit_order;
+				std::uint32_t nbr_levels;
+				std::uint64_t levels_digest;
+			};
+
+			struct chunk_header
+			{
+				std::uint64_t bucket;
+				std::uint64_t count;
+			};
+
+			/**
+			 * Position of a chunk's records inside a memory mapped snapshot.
+			 */
+			struct chunk_view
+			{
+				std::uint64_t bucket;
+				std::uint64_t count;
+				const char* records;
+			};
+
+			template <typename T>
+			void write(std::ostream& os, const T& t)
+			{
+				os.write(reinterpret_cast<const char*>(&t), sizeof(T));
+			}
+
+			template <typename T>
+			void read(std::istream& is, T& t)
+			{
+				if (!is.read(reinterpret_cast<char*>(&t), sizeof(T)))
+				{
+					throw std::runtime_error("Truncated snapshot");
+				}
+			}
+
+			template <typename T>
+			const char* read(const char* it, const char* end, T& t)
+			{
+				if (static_cast<std::size_t>(end - it) < sizeof(T))
+				{
+					throw std::runtime_error("Truncated snapshot");
+				}
+				std::memcpy(&t, it, sizeof(T));
+
+				return it + sizeof(T);
+			}
+
+			/**
+			 * Returns the FNV-1a hash of the level widths.
+			 */
+			inline std::uint64_t digest(const std::vector<std::size_t>& levels) noexcept
+			{
+				std::uint64_t result = 0xcbf29ce484222325ULL;
+				for (std::size_t level: levels)
+				{
+					result = (result ^ level) * 0x100000001b3ULL;
+				}
+
+				return result;
+			}
+
+			inline header make_header(std::uint64_t key_size,
+			                          std::uint64_t value_size,
+			                          std::uint64_t head_size,
+			                          std::uint32_t bit_order,
+			                          const std::vector<std::size_t>& levels,
+			                          const char (&tag)[8] = magic)
+			{
+				header h{};
+				std::memcpy(h.magic, tag, sizeof(tag));
+				h.version = version;
+				h.byte_order = byte_order;
+				h.key_size = key_size;
+				h.value_size = value_size;
+				h.head_size = head_size;
+				h.bit_order = bit_order;
+				h.nbr_levels = static_cast<std::uint32_t>(levels.size());
+				h.levels_digest = digest(levels);
+
+				return h;
+			}
+
+			/**
+			 * Returns true if the snapshot was taken from a map laid out as described, so that each of its chunks
+			 * belongs to the head bucket of the same index.
+			 */
+			inline bool same_layout(const header& h, std::uint32_t bit_order, const std::vector<std::size_t>& levels)
+			{
+				return h.bit_order == bit_order && h.nbr_levels == levels.size() && h.levels_digest == digest(levels);
+			}
+
+			inline void check_header(const header& h,
+			                         std::uint64_t key_size,
+			                         std::uint64_t value_size,
+			                         const char (&tag)[8] = magic)
+			{
+				if (std::memcmp(h.magic, tag, sizeof(tag)) != 0)
+				{
+					throw std::runtime_error("Not a snapshot");
+				}
+				if (h.version != version)
+				{
+					throw std::runtime_error("Unsupported snapshot version");
+				}
+				if (h.byte_order != byte_order)
+				{
+					throw std::runtime_error("Snapshot byte order mismatch");
+				}
+				if (h.key_size != key_size || h.value_size != value_size)
+				{
+					throw std::runtime_error("Snapshot key or value size mismatch");
+				}
+			}
+
+			/**
+			 * Splits a memory mapped snapshot into its chunks.
+			 * @return the header of the snapshot
+			 */
+			inline header parse(const char* data,
+			                    std::size_t size,
+			                    std::uint64_t key_size,
+			                    std::uint64_t value_size,
+			                    std::vector<chunk_view>& chunks)
+			{
+				const char* it = data;
+				const char* end = data + size;
+				const std::uint64_t record_size = key_size + value_size;
+
+				header h;
+				it = read(it, end, h);
+				check_header(h, key_size, value_size);
+
+				std::uint64_t total = 0;
+				while (true)
+				{
+					chunk_header ch;
+					it = read(it, end, ch);
+
+					if (ch.bucket == end_of_chunks)
+					{
+						if (ch.count != total)
+						{
+							throw std::runtime_error("Corrupted snapshot");
+						}
+						break;
+					}
+
+					if (!chunks.empty() && chunks.back().bucket >= ch.bucket)
+					{
+						throw std::runtime_error("Corrupted snapshot");
+					}
+
+					if (static_cast<std::uint64_t>(end - it) / record_size < ch.count)
+					{
+						throw std::runtime_error("Truncated snapshot");
+					}
+
+					chunks.push_back(chunk_view{ch.bucket, ch.count, it});
+					it += ch.count * record_size;
+					total += ch.count;
+				}
+
+				return h;
+			}
+		} // namespace snapshot
+	} // namespace details
+} // namespace wfc
+#endif // WFC_SNAPSHOT_HPP
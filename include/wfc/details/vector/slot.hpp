@@ -0,0 +1,34 @@
+#ifndef WFC_VECTOR_SLOT_HPP
+#define WFC_VECTOR_SLOT_HPP
+
+#include <atomic>
+#include <new>
+
+namespace wfc
+{
+	namespace details
+	{
+		/**
+		 * Storage of an element of a vector. The element is constructed in place by the push_back which reserved the
+		 * slot, ready is set once it is done.
+		 */
+		template <typename T>
+		struct vector_slot_t
+		{
+			std::atomic<bool> ready;
+			alignas(T) unsigned char storage[sizeof(T)];
+
+			T* element() noexcept
+			{
+				return std::launder(reinterpret_cast<T*>(storage));
+			}
+
+			const T* element() const noexcept
+			{
+				return std::launder(reinterpret_cast<const T*>(storage));
+			}
+		};
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_VECTOR_SLOT_HPP
@@ -0,0 +1,199 @@
+#ifndef WFC_EXPIRING_MAP_HPP
+#define WFC_EXPIRING_MAP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+#include "details/unordered_map/expiry.hpp"
+#include "unordered_map.hpp"
+
+namespace wfc
+{
+	/**
+	 * A wait free hash map whose elements expire after a time to live
+	 *
+	 * @details The map is an unordered_map whose datanodes hold an expiry timestamp next to the value.
+	 * Expired elements are absent for every operation. They are reclaimed lazily: insert replaces an expired datanode
+	 * it runs into instead of expanding its slot, update and remove empty the slot of the expired element they look
+	 * for, and sweep_step purges a head bucket in a single traversal, removing each expired element from the slot
+	 * it is found in.
+	 *
+	 * @tparam Key type of the key in the map
+	 * @tparam Value type of the value in the map
+	 * @tparam HashFunction @see unordered_map
+	 */
+	template <typename Key, typename Value, typename HashFunction = identity_hash<Key>>
+	class expiring_map
+	{
+	public:
+		using key_t = Key;
+		using value_t = Value;
+		using clock = details::expiry_clock;
+		using duration = clock::duration;
+
+		/**
+		 * @see unordered_map::unordered_map(const fanout_schedule&, std::size_t, std::size_t, memory_placement)
+		 */
+		explicit expiring_map(const fanout_schedule& schedule,
+		                      std::size_t max_fail_count = 8,
+		                      std::size_t max_nbr_threads = 8,
+		                      memory_placement placement = memory_placement::heap);
+
+		/**
+		 * @see unordered_map::unordered_map(std::size_t, std::size_t, std::size_t, memory_placement)
+		 */
+		explicit expiring_map(std::size_t array_length,
+		                      std::size_t max_fail_count = 8,
+		                      std::size_t max_nbr_threads = 8,
+		                      memory_placement placement = memory_placement::heap);
+		expiring_map(const expiring_map&) = delete;
+
+		expiring_map& operator=(const expiring_map&) = delete;
+
+		/**
+		 * Inserts the key and the value, which expire after time_to_live.
+		 *
+		 * @return Returns operation_result::already_present if the key is in the map and not expired.
+		 * Otherwise it returns operation_result::success
+		 */
+		operation_result insert(const Key& key, const Value& value, duration time_to_live);
+
+		/**
+		 * Tries to retrieve the value associated to the key.
+		 *
+		 * @return an empty optional if the key is not in the map or expired. The associated value otherwise.
+		 */
+		std::optional<Value> get(const Key& key);
+
+		/**
+		 * Replaces the value associated to the key, which expires after time_to_live from now on.
+		 *
+		 * @return operation_result::element_not_found if the key is not in the map or expired.
+		 * Otherwise it returns operation_result::success
+		 */
+		operation_result update(const Key& key, const Value& value, duration time_to_live);
+
+		/**
+		 * Removes the element associated to the key.
+		 *
+		 * @return operation_result::element_not_found if the key is not in the map or expired.
+		 * Otherwise it returns operation_result::success
+		 */
+		operation_result remove(const Key& key);
+
+		/**
+		 * Purges the expired elements of the next head bucket. A background thread calling it in a loop reclaims
+		 * every expired element once per head_size() calls.
+		 * This function can be called while other threads modify the map.
+		 *
+		 * @return the number of reclaimed elements
+		 */
+		std::size_t sweep_step();
+
+		/**
+		 * Purges the expired elements of every head bucket.
+		 *
+		 * @return the number of reclaimed elements
+		 */
+		std::size_t sweep();
+
+		/**
+		 * Returns the number of elements into the collection, expired elements which are not reclaimed yet included.
+		 */
+		std::size_t size() const noexcept;
+
+		/**
+		 * Returns true if the map holds no element, expired or not.
+		 */
+		bool is_empty() const noexcept;
+
+	private:
+		using entry_t = details::timed_value<Value>;
+
+		unordered_map<Key, entry_t, HashFunction> m_map;
+		std::atomic<std::size_t> m_hand;
+	};
+
+	template <typename Key, typename Value, typename HashFunction>
+	expiring_map<Key, Value, HashFunction>::expiring_map(const fanout_schedule& schedule,
+	                                                    std::size_t max_fail_count,
+	                                                    std::size_t max_nbr_threads,
+	                                                    memory_placement placement)
+	    : m_map(schedule, max_fail_count, max_nbr_threads, placement), m_hand(0)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	expiring_map<Key, Value, HashFunction>::expiring_map(std::size_t array_length,
+	                                                    std::size_t max_fail_count,
+	                                                    std::size_t max_nbr_threads,
+	                                                    memory_placement placement)
+	    : m_map(array_length, max_fail_count, max_nbr_threads, placement), m_hand(0)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	operation_result expiring_map<Key, Value, HashFunction>::insert(const Key& key,
+	                                                                const Value& value,
+	                                                                duration time_to_live)
+	{
+		return m_map.insert(key, entry_t{value, clock::now() + time_to_live});
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::optional<Value> expiring_map<Key, Value, HashFunction>::get(const Key& key)
+	{
+		std::optional<Value> result;
+		m_map.visit_value(key, [&result](const entry_t& entry) { result.emplace(entry.value); });
+
+		return result;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	operation_result expiring_map<Key, Value, HashFunction>::update(const Key& key,
+	                                                                const Value& value,
+	                                                                duration time_to_live)
+	{
+		return m_map.update(key, entry_t{value, clock::now() + time_to_live});
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	operation_result expiring_map<Key, Value, HashFunction>::remove(const Key& key)
+	{
+		return m_map.remove(key);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t expiring_map<Key, Value, HashFunction>::sweep_step()
+	{
+		return m_map.purge_expired(m_hand.fetch_add(1, std::memory_order_relaxed) % m_map.head_size());
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t expiring_map<Key, Value, HashFunction>::sweep()
+	{
+		std::size_t purged = 0;
+		for (std::size_t bucket = 0; bucket < m_map.head_size(); ++bucket)
+		{
+			purged += m_map.purge_expired(bucket);
+		}
+
+		return purged;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t expiring_map<Key, Value, HashFunction>::size() const noexcept
+	{
+		return m_map.size();
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool expiring_map<Key, Value, HashFunction>::is_empty() const noexcept
+	{
+		return m_map.is_empty();
+	}
+} // namespace wfc
+
+#endif // WFC_EXPIRING_MAP_HPP
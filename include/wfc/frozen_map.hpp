@@ -0,0 +1,257 @@
+#ifndef WFC_FROZEN_MAP_HPP
+#define WFC_FROZEN_MAP_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "unordered_map.hpp"
+
+namespace wfc
+{
+	/**
+	 * An immutable copy of an unordered_map laid out for lookups
+	 *
+	 * @details The trie of the map is flattened into two arrays: the slots of every arraynode in breadth-first order,
+	 * so that the top levels, which every lookup goes through, share a few cache lines, and the elements in the same
+	 * order. A slot holds either nothing, the index of an element or the offset of the slots of a child array.
+	 * Lookups follow the positions of the map with plain loads: there are no atomic operations nor hazard pointers,
+	 * and any number of threads may read a frozen map.
+	 *
+	 * @tparam Key @see unordered_map
+	 * @tparam Value @see unordered_map
+	 * @tparam HashFunction @see unordered_map
+	 */
+	template <typename Key, typename Value, typename HashFunction = identity_hash<Key>>
+	class frozen_map
+	{
+	public:
+		using key_t = Key;
+		using hash_t = std::invoke_result_t<HashFunction, Key>;
+		using value_t = Value;
+		using map_t = unordered_map<Key, Value, HashFunction>;
+
+		/**
+		 * Copies the elements of a map, keeping the fanout of its levels.
+		 * The map should not be modified meanwhile.
+		 */
+		explicit frozen_map(const map_t& map);
+
+		/**
+		 * @return a pointer to the value of the key, or nullptr if the key isn't in the map.
+		 * The pointer stays valid as long as the frozen map.
+		 */
+		const Value* find(const Key& key) const;
+
+		/**
+		 * @return the value of the key if it's in the map.
+		 */
+		std::optional<Value> get(const Key& key) const;
+
+		bool contains(const Key& key) const;
+
+		/**
+		 * Calls the function with every element of the map, in breadth-first order of their slots.
+		 */
+		template <typename VisitorFun>
+		void visit(VisitorFun&& fun) const;
+
+		/**
+		 * Inserts the elements into a mutable map, which shouldn't be used by other threads meanwhile.
+		 *
+		 * @return the number of elements which were not already in the map
+		 */
+		std::size_t thaw(map_t& map) const;
+
+		std::size_t size() const noexcept;
+
+		bool is_empty() const noexcept;
+
+		/**
+		 * @return the number of bytes taken by the slots and the elements
+		 */
+		std::size_t memory_bytes() const noexcept;
+
+	private:
+		struct entry
+		{
+			hash_t hash;
+			key_t key;
+			value_t value;
+		};
+
+		using map_node_t = typename map_t::node_t;
+		using map_node_union = typename map_t::node_union;
+		using map_arraynode_t = typename map_t::arraynode_t;
+
+		std::size_t position_of(hash_t fullhash, std::size_t depth) const;
+
+		// The lowest bit of a slot tells whether it holds an element index or the offset of a child array.
+		static constexpr std::size_t empty_slot = 0;
+		static constexpr std::size_t entry_tag = 0b1;
+
+		std::vector<std::size_t> m_levels;
+		std::vector<std::size_t> m_shifts;
+		std::vector<std::size_t> m_slots;
+		std::vector<entry> m_entries;
+	};
+
+	template <typename Key, typename Value, typename HashFunction>
+	frozen_map<Key, Value, HashFunction>::frozen_map(const map_t& map)
+	    : m_levels(map.m_levels), m_shifts(map.m_shifts), m_slots(map.m_head_size, empty_slot), m_entries()
+	{
+		m_entries.reserve(map.size());
+
+		// Arrays are copied in the order their slots are appended, hence breadth first.
+		struct pending_array
+		{
+			const map_arraynode_t* array;
+			std::size_t depth;
+			std::size_t offset;
+		};
+		std::vector<pending_array> pending{{&map.m_head, 0, 0}};
+
+		auto append_entry = [this](std::size_t slot, const map_node_t& datanode) {
+			m_slots[slot] = m_entries.size() << 1U | entry_tag;
+			m_entries.push_back({datanode.hash, datanode.key, datanode.value});
+		};
+
+		for (std::size_t next = 0; next < pending.size(); ++next)
+		{
+			pending_array current = pending[next];
+			for (std::size_t i = 0, n = current.array->size(); i < n; ++i)
+			{
+				map_node_union node = (*current.array)[i].load(std::memory_order_acquire);
+				assert(!details::is_descriptor(node));
+
+				if (details::is_array_node(node))
+				{
+					std::size_t offset = m_slots.size();
+					const map_arraynode_t* child = details::sanitize_ptr(node).arraynode_ptr;
+					m_slots.resize(offset + child->size(), empty_slot);
+					m_slots[current.offset + i] = offset << 1U;
+					pending.push_back({child, current.depth + 1, offset});
+				}
+				else if (details::is_compact_node(node))
+				{
+					// Frozen maps have no compact arraynodes, the datanodes get the slots of a full one.
+					std::size_t offset = m_slots.size();
+					m_slots.resize(offset + (std::size_t{1} << m_levels[current.depth + 1]), empty_slot);
+					m_slots[current.offset + i] = offset << 1U;
+					details::untag_compact_node(node)->for_each(
+					    [offset, &append_entry](std::size_t position, const map_node_t* datanode) {
+						    append_entry(offset + position, *datanode);
+					    });
+				}
+				else if (node.datanode_ptr != nullptr)
+				{
+					details::unmark_datanode(node);
+					append_entry(current.offset + i, *node.datanode_ptr);
+				}
+			}
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	const Value* frozen_map<Key, Value, HashFunction>::find(const Key& key) const
+	{
+		hash_t fullhash = HashFunction{}(key);
+
+		std::size_t offset = 0;
+		for (std::size_t depth = 0; depth < m_levels.size(); ++depth)
+		{
+			std::size_t slot = m_slots[offset + position_of(fullhash, depth)];
+			if ((slot & entry_tag) != 0)
+			{
+				const entry& e = m_entries[slot >> 1U];
+				return e.hash == fullhash ? &e.value : nullptr;
+			}
+
+			if (slot == empty_slot)
+			{
+				return nullptr;
+			}
+
+			offset = slot >> 1U;
+		}
+
+		return nullptr;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::optional<Value> frozen_map<Key, Value, HashFunction>::get(const Key& key) const
+	{
+		const Value* value = find(key);
+		if (value == nullptr)
+		{
+			return std::nullopt;
+		}
+
+		return *value;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool frozen_map<Key, Value, HashFunction>::contains(const Key& key) const
+	{
+		return find(key) != nullptr;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename VisitorFun>
+	void frozen_map<Key, Value, HashFunction>::visit(VisitorFun&& fun) const
+	{
+		static_assert(std::is_invocable_v<VisitorFun, std::pair<key_t, value_t>>,
+		              "Functor doesn't respect the concept");
+
+		for (const entry& e: m_entries)
+		{
+			std::invoke(fun, std::pair<key_t, value_t>(e.key, e.value));
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t frozen_map<Key, Value, HashFunction>::thaw(map_t& map) const
+	{
+		std::size_t inserted = 0;
+		for (const entry& e: m_entries)
+		{
+			if (map.build_insert(e.hash, e.key, e.value))
+			{
+				++inserted;
+			}
+		}
+
+		map.m_size.fetch_add(inserted, std::memory_order_relaxed);
+		return inserted;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t frozen_map<Key, Value, HashFunction>::size() const noexcept
+	{
+		return m_entries.size();
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool frozen_map<Key, Value, HashFunction>::is_empty() const noexcept
+	{
+		return m_entries.empty();
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t frozen_map<Key, Value, HashFunction>::memory_bytes() const noexcept
+	{
+		return m_slots.capacity() * sizeof(std::size_t) + m_entries.capacity() * sizeof(entry);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t frozen_map<Key, Value, HashFunction>::position_of(hash_t fullhash, std::size_t depth) const
+	{
+		return fullhash >> m_shifts[depth] & ((std::size_t{1} << m_levels[depth]) - 1);
+	}
+} // namespace wfc
+
+#endif // WFC_FROZEN_MAP_HPP
@@ -0,0 +1,478 @@
+#ifndef WFC_QUEUE_HPP
+#define WFC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "details/hazard_pointers.hpp"
+#include "details/queue/nodes.hpp"
+#include "utility/thread_manipulation.hpp"
+
+namespace wfc
+{
+	/**
+	 * A wait free multi-producer multi-consumer FIFO queue
+	 *
+	 * @details The queue is the one of Kogan and Petrank, "Wait-free queues with multiple enqueuers and dequeuers".
+	 * Every operation is announced in a per-thread descriptor stamped with a phase taken from a shared counter. Before
+	 * completing its own operation, a thread helps every pending operation whose phase is not greater than its own, so
+	 * each operation completes after a bounded number of steps of any thread, whatever the scheduling.
+	 * Nodes and descriptors are reclaimed with hazard pointers, like the datanodes of unordered_map.
+	 *
+	 * @tparam T type of the elements, it has to be copy constructible
+	 */
+	template <typename T>
+	class queue
+	{
+	public:
+		using value_t = T;
+
+		/**
+		 * @param max_nbr_threads the number of threads which may use the queue, the ids given by
+		 * details::get_thread_id() have to be lower than it.
+		 * @throw std::runtime_error if max_nbr_threads is 0.
+		 */
+		explicit queue(std::size_t max_nbr_threads = 8);
+		queue(const queue&) = delete;
+
+		/**
+		 * Frees the remaining elements. No thread may use the queue anymore.
+		 */
+		~queue() noexcept;
+
+		queue& operator=(const queue&) = delete;
+
+		/**
+		 * Appends the value at the end of the queue.
+		 */
+		void enqueue(const T& value);
+
+		/**
+		 * Appends every value of the range at the end of the queue, without values of other threads in between.
+		 *
+		 * @return the number of enqueued values
+		 */
+		template <typename InputIt>
+		std::size_t enqueue_bulk(InputIt first, InputIt last);
+
+		/**
+		 * Removes the first value of the queue.
+		 *
+		 * @return the value, std::nullopt if the queue was empty.
+		 */
+		std::optional<T> dequeue();
+
+		/**
+		 * Removes up to max_count values from the queue and writes them to out, in order.
+		 * Values are dequeued one by one, so values of other consumers may be interleaved.
+		 *
+		 * @return the number of dequeued values, lower than max_count only if the queue became empty.
+		 */
+		template <typename OutputIt>
+		std::size_t dequeue_bulk(OutputIt out, std::size_t max_count);
+
+		/**
+		 * Returns true if the queue is empty, false otherwise.
+		 */
+		bool is_empty();
+
+	private:
+		using node_t = details::queue_node_t<T>;
+		using desc_t = details::operation_desc_t<T>;
+
+		/**
+		 * Hazard slots of a thread.
+		 */
+		enum hazard_slot : std::size_t
+		{
+			first_slot,
+			last_slot,
+			next_slot,
+			desc_slot,
+			check_slot,
+			nbr_slots
+		};
+
+		static node_t* make_node(const T& value, std::size_t enqueuer);
+
+		/**
+		 * Announces the operation of the calling thread and completes it.
+		 */
+		void perform(desc_t* desc);
+
+		/**
+		 * Helps every pending operation whose phase is lower or equal to phase.
+		 */
+		void help(std::uint64_t phase);
+
+		bool is_still_pending(std::size_t thread_id, std::uint64_t phase);
+
+		void help_enqueue(std::size_t thread_id, std::uint64_t phase);
+
+		/**
+		 * Completes the enqueue of the node following the tail, then moves the tail to it.
+		 */
+		void help_finish_enqueue();
+
+		void help_dequeue(std::size_t thread_id, std::uint64_t phase);
+
+		/**
+		 * Completes the dequeue which claimed the head, then moves the head to the next node.
+		 */
+		void help_finish_dequeue();
+
+		/**
+		 * Replaces the descriptor of a thread, which the calling thread protects.
+		 * The expected descriptor is retired on success, the desired one is freed otherwise.
+		 */
+		bool replace_desc(std::size_t thread_id, desc_t* expected, desc_t* desired);
+
+		static void delete_node(void* node);
+
+		static void delete_desc(void* desc);
+
+		std::size_t m_max_nbr_threads;
+		std::atomic<node_t*> m_head;
+		std::atomic<node_t*> m_tail;
+		std::unique_ptr<std::atomic<desc_t*>[]> m_state;
+		std::atomic<std::uint64_t> m_phase;
+		details::hazard_pointers m_hazards;
+	};
+
+	template <typename T>
+	queue<T>::queue(std::size_t max_nbr_threads)
+	    : m_max_nbr_threads(max_nbr_threads)
+	    , m_head(nullptr)
+	    , m_tail(nullptr)
+	    , m_state(new std::atomic<desc_t*>[max_nbr_threads])
+	    , m_phase(0)
+	    , m_hazards(max_nbr_threads, nbr_slots)
+	{
+		if (max_nbr_threads == 0)
+		{
+			throw std::runtime_error("A queue needs at least one thread");
+		}
+
+		auto* sentinel = new node_t{std::nullopt, {nullptr}, details::no_thread, {details::no_thread}};
+		m_head = sentinel;
+		m_tail = sentinel;
+		for (std::size_t i = 0; i < max_nbr_threads; ++i)
+		{
+			m_state[i] = nullptr;
+		}
+	}
+
+	template <typename T>
+	queue<T>::~queue() noexcept
+	{
+		node_t* node = m_head.load();
+		while (node != nullptr)
+		{
+			node_t* next = node->next.load();
+			delete node;
+			node = next;
+		}
+
+		for (std::size_t i = 0; i < m_max_nbr_threads; ++i)
+		{
+			delete m_state[i].load();
+		}
+	}
+
+	template <typename T>
+	void queue<T>::enqueue(const T& value)
+	{
+		std::size_t thread_id = details::get_thread_id();
+		perform(new desc_t{0, true, true, make_node(value, thread_id), std::nullopt});
+	}
+
+	template <typename T>
+	template <typename InputIt>
+	std::size_t queue<T>::enqueue_bulk(InputIt first, InputIt last)
+	{
+		if (first == last)
+		{
+			return 0;
+		}
+
+		// The values are chained beforehand and the chain is linked like a single node: helpers move the tail
+		// through it one node at a time.
+		std::size_t thread_id = details::get_thread_id();
+		node_t* chain = make_node(*first, thread_id);
+		node_t* end = chain;
+		std::size_t count = 1;
+		for (++first; first != last; ++first, ++count)
+		{
+			node_t* node = make_node(*first, thread_id);
+			end->next.store(node, std::memory_order_relaxed);
+			end = node;
+		}
+
+		perform(new desc_t{0, true, true, chain, std::nullopt});
+		return count;
+	}
+
+	template <typename T>
+	std::optional<T> queue<T>::dequeue()
+	{
+		perform(new desc_t{0, true, false, nullptr, std::nullopt});
+
+		// The completed descriptor is only replaced by the next operation of this thread.
+		return std::move(m_state[details::get_thread_id()].load()->value);
+	}
+
+	template <typename T>
+	template <typename OutputIt>
+	std::size_t queue<T>::dequeue_bulk(OutputIt out, std::size_t max_count)
+	{
+		std::size_t count = 0;
+		for (; count < max_count; ++count)
+		{
+			std::optional<T> value = dequeue();
+			if (!value)
+			{
+				break;
+			}
+			*out++ = std::move(*value);
+		}
+
+		return count;
+	}
+
+	template <typename T>
+	bool queue<T>::is_empty()
+	{
+		node_t* first = m_hazards.protect(first_slot, m_head);
+		bool empty = first->next.load() == nullptr;
+		m_hazards.clear(first_slot);
+
+		return empty;
+	}
+
+	template <typename T>
+	auto queue<T>::make_node(const T& value, std::size_t enqueuer) -> node_t*
+	{
+		return new node_t{value, {nullptr}, enqueuer, {details::no_thread}};
+	}
+
+	template <typename T>
+	void queue<T>::perform(desc_t* desc)
+	{
+		std::size_t thread_id = details::get_thread_id();
+		std::uint64_t phase = m_phase.fetch_add(1) + 1;
+		bool enqueue = desc->enqueue;
+		desc->phase = phase;
+		// Once announced, the descriptor may be replaced and freed by helpers.
+		desc_t* previous = m_state[thread_id].exchange(desc);
+		if (previous != nullptr)
+		{
+			m_hazards.retire(previous, &delete_desc);
+		}
+
+		help(phase);
+		if (enqueue)
+		{
+			help_finish_enqueue();
+		}
+		else
+		{
+			help_finish_dequeue();
+		}
+		m_hazards.clear_all();
+	}
+
+	template <typename T>
+	void queue<T>::help(std::uint64_t phase)
+	{
+		for (std::size_t i = 0; i < m_max_nbr_threads; ++i)
+		{
+			desc_t* desc = m_hazards.protect(check_slot, m_state[i]);
+			if (desc != nullptr && desc->pending && desc->phase <= phase)
+			{
+				if (desc->enqueue)
+				{
+					help_enqueue(i, phase);
+				}
+				else
+				{
+					help_dequeue(i, phase);
+				}
+			}
+		}
+	}
+
+	template <typename T>
+	bool queue<T>::is_still_pending(std::size_t thread_id, std::uint64_t phase)
+	{
+		desc_t* desc = m_hazards.protect(check_slot, m_state[thread_id]);
+		return desc->pending && desc->phase <= phase;
+	}
+
+	template <typename T>
+	void queue<T>::help_enqueue(std::size_t thread_id, std::uint64_t phase)
+	{
+		while (is_still_pending(thread_id, phase))
+		{
+			node_t* last = m_hazards.protect(last_slot, m_tail);
+			node_t* next = last->next.load();
+			if (last != m_tail.load())
+			{
+				continue;
+			}
+
+			if (next != nullptr)
+			{
+				// Another enqueue is in progress, it is completed first.
+				help_finish_enqueue();
+				continue;
+			}
+
+			// While the descriptor is pending, the tail can't have moved past its node, so the node isn't linked yet.
+			desc_t* desc = m_hazards.protect(desc_slot, m_state[thread_id]);
+			if (desc->pending && desc->phase <= phase && last->next.compare_exchange_strong(next, desc->node))
+			{
+				help_finish_enqueue();
+				return;
+			}
+		}
+	}
+
+	template <typename T>
+	void queue<T>::help_finish_enqueue()
+	{
+		node_t* last = m_hazards.protect(last_slot, m_tail);
+		node_t* next = m_hazards.protect(next_slot, last->next);
+		// The node following the tail can't be dequeued, as long as the tail didn't move.
+		if (next == nullptr || last != m_tail.load())
+		{
+			return;
+		}
+
+		std::size_t thread_id = next->enqueuer;
+		desc_t* desc = m_hazards.protect(desc_slot, m_state[thread_id]);
+		if (last == m_tail.load() && desc->node == next && desc->pending)
+		{
+			replace_desc(thread_id, desc, new desc_t{desc->phase, false, true, next, std::nullopt});
+		}
+		m_tail.compare_exchange_strong(last, next);
+	}
+
+	template <typename T>
+	void queue<T>::help_dequeue(std::size_t thread_id, std::uint64_t phase)
+	{
+		while (is_still_pending(thread_id, phase))
+		{
+			node_t* first = m_hazards.protect(first_slot, m_head);
+			node_t* last = m_hazards.protect(last_slot, m_tail);
+			node_t* next = first->next.load();
+			if (first != m_head.load())
+			{
+				continue;
+			}
+
+			if (first == last)
+			{
+				if (next != nullptr)
+				{
+					help_finish_enqueue();
+					continue;
+				}
+
+				// The queue is empty, the dequeue completes without value.
+				desc_t* desc = m_hazards.protect(desc_slot, m_state[thread_id]);
+				if (last == m_tail.load() && desc->pending && desc->phase <= phase)
+				{
+					replace_desc(thread_id, desc, new desc_t{desc->phase, false, false, nullptr, std::nullopt});
+				}
+				continue;
+			}
+
+			desc_t* desc = m_hazards.protect(desc_slot, m_state[thread_id]);
+			if (!desc->pending || desc->phase > phase)
+			{
+				return;
+			}
+
+			// The dequeue first records the head it is about to claim, then claims it.
+			if (first == m_head.load() && desc->node != first)
+			{
+				if (!replace_desc(thread_id, desc, new desc_t{desc->phase, true, false, first, std::nullopt}))
+				{
+					continue;
+				}
+			}
+
+			std::size_t no_thread = details::no_thread;
+			first->dequeuer.compare_exchange_strong(no_thread, thread_id);
+			help_finish_dequeue();
+		}
+	}
+
+	template <typename T>
+	void queue<T>::help_finish_dequeue()
+	{
+		node_t* first = m_hazards.protect(first_slot, m_head);
+		node_t* next = m_hazards.protect(next_slot, first->next);
+		// The node following the head can't be freed, as long as the head didn't move.
+		if (next == nullptr || first != m_head.load())
+		{
+			return;
+		}
+
+		std::size_t thread_id = first->dequeuer.load();
+		if (thread_id == details::no_thread)
+		{
+			return;
+		}
+
+		// The descriptor is read before checking the head: a new operation of the dequeuer is only announced once the
+		// head moved past first, so it can't be completed by mistake.
+		desc_t* desc = m_hazards.protect(desc_slot, m_state[thread_id]);
+		if (first != m_head.load())
+		{
+			return;
+		}
+
+		if (desc->pending)
+		{
+			replace_desc(thread_id, desc, new desc_t{desc->phase, false, false, first, next->value});
+		}
+		if (m_head.compare_exchange_strong(first, next))
+		{
+			m_hazards.retire(first, &delete_node);
+		}
+	}
+
+	template <typename T>
+	bool queue<T>::replace_desc(std::size_t thread_id, desc_t* expected, desc_t* desired)
+	{
+		if (m_state[thread_id].compare_exchange_strong(expected, desired))
+		{
+			m_hazards.retire(expected, &delete_desc);
+			return true;
+		}
+
+		delete desired;
+		return false;
+	}
+
+	template <typename T>
+	void queue<T>::delete_node(void* node)
+	{
+		delete static_cast<node_t*>(node);
+	}
+
+	template <typename T>
+	void queue<T>::delete_desc(void* desc)
+	{
+		delete static_cast<desc_t*>(desc);
+	}
+} // namespace wfc
+
+#endif // WFC_QUEUE_HPP
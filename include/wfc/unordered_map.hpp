@@ -1,18 +1,38 @@
 #ifndef WFC_UNORDERED_MAP_HPP
 #define WFC_UNORDERED_MAP_HPP
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstring>
+#include <fstream>
 #include <functional>
+#include <initializer_list>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <optional>
+#include <string>
 #include <type_traits>
+#include <vector>
 #include <wfc/utility/thread_manipulation.hpp>
 
+#include "utility/backoff.hpp"
+#include "utility/huge_page_arena.hpp"
 #include "utility/math.hpp"
+#include "utility/mapped_file.hpp"
+#include "utility/memory_resource.hpp"
+#include "utility/numa.hpp"
+#include "utility/uint128.hpp"
+#include "details/hazard_pointers.hpp"
+#include "details/unordered_map/change_log.hpp"
+#include "details/unordered_map/expiry.hpp"
+#include "details/unordered_map/mcas.hpp"
 #include "details/unordered_map/nodes.hpp"
+#include "details/unordered_map/slot_scan.hpp"
+#include "details/unordered_map/snapshot.hpp"
 
 namespace wfc
 {
@@ -43,26 +63,170 @@ namespace wfc
 		return !succeeded(e);
 	}
 
+	/**
+	 * @brief where the nodes of a collection are allocated.
+	 */
+	enum class memory_placement
+	{
+		heap, /**< nodes are allocated with the global operator new */
+		huge_pages, /**< nodes are carved out of 2 MiB regions backed by huge pages when possible */
+		numa /**< like huge_pages, but head buckets are spread over NUMA nodes and subtrees use their node's memory */
+	};
+
+	/**
+	 * @brief memory reserved by a collection, @see memory_placement
+	 */
+	struct placement_report
+	{
+		std::size_t reserved_bytes; /**< bytes reserved from the system for the nodes */
+		std::size_t huge_page_bytes; /**< reserved bytes actually backed by huge pages */
+	};
+
+	/**
+	 * @brief how a map deals with threads modifying the same slots, @see unordered_map::set_contention_policy
+	 */
+	struct contention_policy
+	{
+		backoff_policy backoff = backoff_policy::none; /**< wait after a failed attempt on a slot */
+		std::size_t max_backoff_spins = 1024; /**< longest single wait, in pause instructions */
+		bool combining = false; /**< concurrent updates of a key are merged into the one which succeeds */
+	};
+
+	/**
+	 * @brief shape of one level of the trie of a collection
+	 */
+	struct level_report
+	{
+		static constexpr std::size_t occupancy_buckets = 11;
+
+		std::size_t arraynodes; /**< arraynodes at this depth */
+		std::size_t slots; /**< slots of these arraynodes */
+		std::size_t empty_slots; /**< slots holding nothing */
+		std::size_t datanodes; /**< datanodes at this depth, the histogram of the depths of the datanodes */
+		/**
+		 * occupancy[i] is the number of arraynodes whose proportion of non-empty slots is between i and i + 1 tenths,
+		 * the last bucket counting full arraynodes
+		 */
+		std::array<std::size_t, occupancy_buckets> occupancy;
+	};
+
+	/**
+	 * @brief shape of the trie of a collection
+	 */
+	struct structure_report
+	{
+		std::size_t arraynodes; /**< arraynodes, the head included */
+		std::size_t datanodes; /**< datanodes, marked ones included */
+		std::size_t slots; /**< slots of every arraynode, the datanodes of compact arraynodes */
+		std::size_t empty_slots; /**< slots holding nothing */
+		std::size_t total_depth; /**< sum of the depths of the datanodes, the head being at depth 0 */
+		std::size_t max_depth; /**< depth of the deepest datanode */
+		std::size_t bytes; /**< bytes used by the arraynodes, their slots and the datanodes */
+		std::size_t marked_slots; /**< slots holding a datanode marked to be expanded */
+		std::size_t empty_arraynodes; /**< arraynodes other than the head whose slots are all empty */
+		/**
+		 * arraynodes storing their datanodes only, @see unordered_map::enable_compact_arraynodes
+		 */
+		std::size_t compact_arraynodes;
+		std::vector<level_report> levels; /**< levels[d] describes the arraynodes and datanodes at depth d */
+	};
+
+	/**
+	 * @brief order in which the levels of a map consume the bits of the hash.
+	 */
+	enum class bit_order
+	{
+		lsb_first, /**< the head uses the least significant bits, spreading sequential keys over the head */
+		msb_first /**< the head uses the most significant bits, keeping the trie sorted by hash */
+	};
+
+	/**
+	 * Number of hash bits consumed by each level of a map, starting with the head.
+	 * A level consuming n bits is made of arrays of 2^n slots.
+	 * The last value is repeated until every bit of the hash is consumed.
+	 */
+	class fanout_schedule
+	{
+	public:
+		/**
+		 * @throw std::runtime_error if bits_per_level is empty or if a level consumes 0 or more than max_bits bits.
+		 */
+		fanout_schedule(std::initializer_list<std::size_t> bits_per_level, bit_order order = bit_order::lsb_first);
+
+		/**
+		 * @see fanout_schedule(std::initializer_list<std::size_t>, bit_order)
+		 */
+		explicit fanout_schedule(std::vector<std::size_t> bits_per_level, bit_order order = bit_order::lsb_first);
+
+		/**
+		 * Returns the number of bits consumed at the given depth, the head being at depth 0.
+		 */
+		std::size_t bits_at(std::size_t depth) const noexcept;
+
+		bit_order order() const noexcept;
+
+		static constexpr std::size_t max_bits = 32;
+
+	private:
+		std::vector<std::size_t> m_bits;
+		bit_order m_order;
+	};
+
+	inline fanout_schedule::fanout_schedule(std::initializer_list<std::size_t> bits_per_level, bit_order order)
+	    : fanout_schedule(std::vector<std::size_t>(bits_per_level), order)
+	{
+	}
+
+	inline fanout_schedule::fanout_schedule(std::vector<std::size_t> bits_per_level, bit_order order)
+	    : m_bits(std::move(bits_per_level)), m_order(order)
+	{
+		if (m_bits.empty())
+		{
+			throw std::runtime_error("Fanout schedule should have at least one level");
+		}
+
+		for (std::size_t bits: m_bits)
+		{
+			if (bits == 0 || bits > max_bits)
+			{
+				throw std::runtime_error("Each level should consume between 1 and 32 bits");
+			}
+		}
+	}
+
+	inline std::size_t fanout_schedule::bits_at(std::size_t depth) const noexcept
+	{
+		return m_bits[std::min(depth, m_bits.size() - 1)];
+	}
+
+	inline bit_order fanout_schedule::order() const noexcept
+	{
+		return m_order;
+	}
+
 	/**
 	 * Default hash function. This function is the identity.
-	 * @tparam Key - Type of the key
+	 * @tparam Key - Type of the key, a fundamental type or uint128
 	 */
 	template <typename Key>
 	class identity_hash
 	{
 	public:
-		static_assert(std::is_fundamental_v<Key>, "Key should be a fundamental type to use the default hash");
+		static_assert(std::is_fundamental_v<Key> || std::is_same_v<Key, uint128>,
+		              "Key should be a fundamental type or uint128 to use the default hash");
 		Key operator()(const Key& k) const noexcept
 		{
 			return k;
 		}
 	};
 
+	template <typename Key, typename Value, typename HashFunction>
+	class frozen_map;
+
 	/**
 	 * A wait free hash map
 	 *
-	 * @details This map could be seen as a n-ary tree, (except that the head has 2^n children)
-	 * In the case of this map, n is array_length.
+	 * @details This map could be seen as a tree whose fanout at each level is given by a fanout_schedule.
 	 * Each node of this map could be an array or a datanode. If two datanodes should go in the same place
 	 * the existing datanode is transformed into an arraynode to allow the insertion of the two datanodes.
 	 * It is noteworthy that this expending of the map will be repeated until the hash of the two nodes differ.
@@ -71,7 +235,8 @@ namespace wfc
 	 * @tparam Value type of the value in the map
 	 * @tparam HashFunction Functor that holds the hash function to be used on keys.
 	 * The hash function has to be collision-free.
-	 * Consequently, output size should be at least as large as input size.
+	 * Consequently, output size should be at least as large as input size: 16 bytes keys can use uint128 hashes,
+	 * which make the trie deep enough to consume their 128 bits.
 	 */
 	template <typename Key, typename Value, typename HashFunction = identity_hash<Key>>
 	class unordered_map
@@ -81,18 +246,56 @@ namespace wfc
 		using hash_t = std::invoke_result_t<HashFunction, Key>;
 		using value_t = Value;
 
+		/**
+		 * Constructs a wait free hash map whose arrays at depth d have 2^schedule.bits_at(d) slots.
+		 *
+		 * @param schedule number of hash bits consumed by each level
+		 * @param max_fail_count this value should match to the number of threads using this map
+		 * @param max_nbr_threads maximal number of thread using the hashmap.
+		 * @param placement where the head and the nodes are allocated.
+		 */
+		explicit unordered_map(const fanout_schedule& schedule,
+		                       std::size_t max_fail_count = 8,
+		                       std::size_t max_nbr_threads = 8,
+		                       memory_placement placement = memory_placement::heap);
+
 		/**
 		 * Constructs a wait free hash map.
+		 * This is the same as using the schedule {array_length, log2(array_length)}.
 		 *
-		 * @param array_length size of the array containing the elements (head size is 2^array_length)
+		 * @param array_length size of the array containing the elements (head size is 2^array_length).
+		 * It should be a power of two.
 		 * @param max_fail_count this value should match to the number of threads using this map
 		 * @param max_nbr_threads maximal number of thread using the hashmap.
+		 * @param placement where the head and the nodes are allocated.
 		 */
 		explicit unordered_map(std::size_t array_length,
 		                       std::size_t max_fail_count = 8,
-		                       std::size_t max_nbr_threads = 8);
+		                       std::size_t max_nbr_threads = 8,
+		                       memory_placement placement = memory_placement::heap);
+
+		/**
+		 * Constructs a wait free hash map whose head, arraynodes and datanodes are allocated from the resource,
+		 * such as an arena for a map built once and then only read, or a shared memory segment.
+		 * Reclaimed nodes are given back to the resource, possibly by another thread than the allocating one.
+		 * The resource has to outlive the map.
+		 * @see unordered_map(const fanout_schedule&, std::size_t, std::size_t, memory_placement)
+		 * @throw std::runtime_error if resource is null
+		 */
+		unordered_map(const fanout_schedule& schedule,
+		              std::size_t max_fail_count,
+		              std::size_t max_nbr_threads,
+		              memory_resource* resource);
+
+		/**
+		 * @see unordered_map(const fanout_schedule&, std::size_t, std::size_t, memory_resource*)
+		 */
+		unordered_map(std::size_t array_length,
+		              std::size_t max_fail_count,
+		              std::size_t max_nbr_threads,
+		              memory_resource* resource);
 		unordered_map(const unordered_map&) = delete;
-		~unordered_map() noexcept = default;
+		~unordered_map() noexcept;
 
 		unordered_map& operator=(const unordered_map&) = delete;
 
@@ -111,6 +314,34 @@ namespace wfc
 		 */
 		std::optional<Value> get(const Key& key);
 
+		/**
+		 * Applies functor on the value associated to the key, in place, while it is protected from reclamation.
+		 * The value is shared with other readers, functor may only modify its atomic members.
+		 * @tparam Fun The type should be compatible with this prototype
+		 * 	void(const value_t&);
+		 * @return false if the key is not in the map.
+		 */
+		template <typename Fun>
+		bool visit_value(const Key& key, Fun&& fun);
+
+		/**
+		 * Atomically replaces the values of several keys by values computed from their current ones,
+		 * such as moving an amount from one key to another.
+		 * The keys are switched to their new values with a multi-word compare-and-swap over their slots.
+		 * Single key operations running into it complete it on its behalf, so they never wait for it.
+		 * If another thread modifies one of the keys meanwhile, the values are read again and functor is called again.
+		 * Value should be equality comparable.
+		 * @tparam Fun The type should be compatible with this prototype
+		 * 	bool(std::vector<value_t>& values);
+		 * where values are given in the order of keys and replaced in place, returning false cancels the update.
+		 * @return operation_result::element_not_found if a key is not in the map,
+		 * operation_result::expected_value_mismatch if functor cancelled the update,
+		 * operation_result::success otherwise
+		 * @throw std::runtime_error if two keys have the same hash, which is the case of a key given twice
+		 */
+		template <typename Fun>
+		operation_result atomic_update(const std::vector<Key>& keys, Fun&& fun);
+
 		/**
 		 * Update the value associated with the given key if the current
 		 * value matches expected_value.
@@ -159,6 +390,244 @@ namespace wfc
 		void visit(VisitorFun&& fun) noexcept(
 		    noexcept(std::is_nothrow_invocable_v<VisitorFun, std::pair<key_t, value_t>>));
 
+		/**
+		 * Writes every element of the map into the stream using a versioned binary format,
+		 * where elements are grouped by head bucket.
+		 * This function can be called while other threads keep modifying the map. In that case the snapshot is fuzzy:
+		 * each element is read consistently but modifications made during the save may or may not be part of it.
+		 * Key and Value should be trivially copyable.
+		 *
+		 * @return the number of saved elements
+		 * @throw std::runtime_error if the stream fails
+		 */
+		std::size_t save(std::ostream& os);
+
+		/**
+		 * Writes a snapshot of the map into the file at the given path.
+		 * @see save(std::ostream&)
+		 */
+		std::size_t save(const std::string& path);
+
+		/**
+		 * Inserts every element of a snapshot read from the stream.
+		 * Elements whose key is already present are skipped.
+		 * This function is NOT thread safe.
+		 *
+		 * @return the number of inserted elements
+		 * @throw std::runtime_error if the snapshot is malformed or doesn't match Key and Value
+		 */
+		std::size_t load(std::istream& is);
+
+		/**
+		 * Inserts every element of the snapshot file at the given path.
+		 * The file is memory mapped and, if the snapshot was taken from a map with the same fanout schedule and bit
+		 * order, head buckets are built in parallel by nbr_threads threads, the calling one and threads joined before
+		 * returning, whose thread ids should be lower than max_nbr_threads. Otherwise the calling thread builds them.
+		 * This function is NOT thread safe.
+		 * @see load(std::istream&)
+		 * @throw std::runtime_error if a building thread has a thread id too high for the map, or if a record of the
+		 * snapshot doesn't belong to the head bucket of its chunk
+		 */
+		std::size_t load(const std::string& path, std::size_t nbr_threads = 1);
+
+		/**
+		 * Moves the elements of other into this map, the keys present in both keeping their value in this map.
+		 * Nodes aren't copied: a subtree of other whose slot is empty in this map is moved as a whole with a single
+		 * compare-and-swap, the tries being walked down together only where both hold something, and the remaining
+		 * datanodes are inserted as they are.
+		 * Other threads may use this map meanwhile, but not other, which is left empty.
+		 * If the maps don't have the same fanout schedule or don't allocate from the same memory resource, the
+		 * elements are copied instead.
+		 *
+		 * @param nbr_threads number of threads merging ranges of head buckets, the calling one and threads joined
+		 * before returning, whose thread ids should be lower than max_nbr_threads
+		 * @return the number of elements added to this map
+		 * @throw std::runtime_error if a merging thread has a thread id too high for the map
+		 */
+		std::size_t merge(unordered_map&& other, std::size_t nbr_threads = 1);
+
+		/**
+		 * Starts recording every successful insertion, update and removal.
+		 * Each thread records its changes into its own ring able to hold capacity_per_thread changes, the rings of
+		 * every thread id being allocated here so that writers only pay for a ring push.
+		 * The ring belongs to the thread id, an exiting thread hands it over to the next thread taking its id.
+		 * Changes of threads whose id isn't lower than max_nbr_threads are dropped, like those of a full ring.
+		 * This function is NOT thread safe.
+		 */
+		void enable_change_log(std::size_t capacity_per_thread);
+
+		/**
+		 * Sets how threads modifying the same slots behave.
+		 * With a backoff, a thread waits after each failed attempt on a slot before reading it again.
+		 * With combining, an update(key, value) losing against a concurrent update(key, value) of the same key
+		 * succeeds along with it, as if it had been overwritten right away, instead of failing.
+		 * The updates of a hot key are thereby applied with a single compare-and-swap.
+		 * This function is NOT thread safe.
+		 */
+		void set_contention_policy(const contention_policy& policy);
+
+		/**
+		 * Sets the fences ordering the hazard pointers which protect the datanodes being read.
+		 * With hazard_fence_mode::asymmetric, reads no longer pay for a store-load fence, but every update or removal
+		 * makes a membarrier system call before freeing the datanode it replaced: this suits maps mostly read.
+		 * This function is NOT thread safe.
+		 *
+		 * @return false if the system doesn't support the mode, which is then left unchanged
+		 */
+		bool set_hazard_fence_mode(hazard_fence_mode mode);
+
+		/**
+		 * Makes the levels created by later expansions start as compact arraynodes, which store a bitmap of their
+		 * occupied positions followed by their datanodes, instead of a slot for every position.
+		 * Expansions typically leave two datanodes in an arraynode, so this saves most of the memory of the deep
+		 * levels, at the cost of copying a compact arraynode on each insertion, update or removal of its elements.
+		 * A compact arraynode is promoted to a full one once half of its positions are used, when two keys need the
+		 * same position, when a thread keeps failing to replace it, or when a multi-key operation reaches it.
+		 * Only levels of 4 to 64 slots are compacted. Maps with expiring values don't support compact arraynodes.
+		 * This function is NOT thread safe.
+		 */
+		void enable_compact_arraynodes();
+
+		/**
+		 * Pops every change recorded since the previous drain and applies functor on it.
+		 * Changes made by one thread are drained in order, changes made by different threads are not ordered.
+		 * Only one thread may drain changes at a time.
+		 * @tparam Fun The type should be compatible with this prototype
+		 * 	void(const change_record<key_t, value_t>&);
+		 * @return the number of drained changes
+		 */
+		template <typename Fun>
+		std::size_t drain_changes(Fun&& fun);
+
+		/**
+		 * Writes an incremental checkpoint holding the current state of every key changed
+		 * since the previous checkpoint, to be applied on top of a snapshot with load_delta.
+		 * Only one thread may write checkpoints at a time, other threads may keep modifying the map.
+		 *
+		 * @return the number of written records
+		 * @throw std::runtime_error if the change log is not enabled, or if changes were dropped because a ring was
+		 * full. In the latter case a full snapshot should be saved instead.
+		 */
+		std::size_t save_delta(std::ostream& os);
+
+		/**
+		 * Applies an incremental checkpoint written by save_delta.
+		 *
+		 * @return the number of applied records
+		 * @throw std::runtime_error if the checkpoint is malformed or doesn't match Key and Value
+		 */
+		std::size_t load_delta(std::istream& is);
+
+		/**
+		 * Returns how many bytes were reserved for the nodes and how many of them ended up on huge pages.
+		 * Both are 0 unless the map uses memory_placement::huge_pages or memory_placement::numa.
+		 */
+		placement_report memory_placement_report() const;
+
+		/**
+		 * Returns the NUMA node owning the head bucket of the key, always 0 unless the map uses
+		 * memory_placement::numa. Operations on that key are best performed by a thread pinned on that node,
+		 * @see pin_current_thread_to_numa_node
+		 */
+		std::size_t numa_node_of(const Key& key) const;
+
+		/**
+		 * Sequential access to the elements of an ordered map, by increasing hash, @see lower_bound
+		 */
+		class range_cursor
+		{
+		public:
+			/**
+			 * Returns the next element, or an empty optional once every element has been returned.
+			 * Each call descends from the head, skipping the subtrees holding smaller hashes, so elements
+			 * inserted or removed meanwhile may or may not be returned.
+			 */
+			std::optional<std::pair<key_t, value_t>> next();
+
+		private:
+			friend class unordered_map;
+
+			range_cursor(unordered_map& map, hash_t from) noexcept;
+
+			unordered_map* m_map;
+			hash_t m_from;
+			bool m_done;
+		};
+
+		/**
+		 * Applies functor on every element whose hash is between the hashes of lo and hi, both included,
+		 * by increasing hash. Subtrees out of the range are never walked.
+		 * With identity_hash, or any increasing hash, this is every key between lo and hi in order.
+		 * This function can be called while other threads modify the map.
+		 * @tparam VisitorFun The type should be compatible with this prototype
+		 * 	void(std::pair<key_t, value_t>);
+		 * @throw std::runtime_error if the map isn't ordered, @see bit_order::msb_first
+		 */
+		template <typename VisitorFun>
+		void visit_range(const Key& lo, const Key& hi, VisitorFun&& fun);
+
+		/**
+		 * Returns a cursor over the elements whose hash is not lower than the hash of the key, by increasing hash.
+		 * @throw std::runtime_error if the map isn't ordered, @see bit_order::msb_first
+		 */
+		range_cursor lower_bound(const Key& key);
+
+		/**
+		 * Applies functor on every element stored below the given head bucket.
+		 * This function can be called while other threads modify the map, elements inserted or removed meanwhile
+		 * may or may not be visited. The elements may not be removed from functor.
+		 * @tparam VisitorFun The type should be compatible with this prototype
+		 * 	void(const key_t&, const value_t&);
+		 * @param bucket position in the head, lower than head_size()
+		 */
+		template <typename VisitorFun>
+		void visit_bucket(std::size_t bucket, VisitorFun&& fun);
+
+		/**
+		 * Returns the number of slots of the head.
+		 */
+		std::size_t head_size() const noexcept;
+
+		/**
+		 * Removes the expired elements stored below the given head bucket, each one right from the slot where the
+		 * traversal finds it. Only maps whose values carry an expiry timestamp have expired elements,
+		 * @see expiring_map
+		 * This function can be called while other threads modify the map.
+		 *
+		 * @param bucket position in the head, lower than head_size()
+		 * @return the number of removed elements
+		 */
+		std::size_t purge_expired(std::size_t bucket);
+
+		/**
+		 * Removes the elements for which the predicate returns true, each one right from the slot where the traversal
+		 * finds it, instead of walking down from the head for each key.
+		 * This function can be called while other threads modify the map, elements inserted, updated or removed
+		 * meanwhile may or may not be tested. The map may not be modified from the predicate.
+		 * Removed datanodes are freed by batches, each batch being checked against a single scan of the hazard
+		 * pointers.
+		 * @tparam Predicate The type should be compatible with this prototype, and callable from several threads at
+		 * once when nbr_threads is greater than 1
+		 * 	bool(const key_t&, const value_t&);
+		 * @param nbr_threads number of threads walking the head buckets, each one taking a contiguous range of them:
+		 * the calling one and threads joined before returning, whose thread ids should be lower than max_nbr_threads
+		 * @return the number of removed elements
+		 * @throw std::runtime_error if a walking thread has a thread id too high for the map
+		 */
+		template <typename Predicate>
+		std::size_t erase_if(Predicate&& pred, std::size_t nbr_threads = 1);
+
+		/**
+		 * Walks the whole trie and describes its shape.
+		 * Datanodes are counted but never read, so this can be called while other threads modify the map,
+		 * in which case the result is approximate.
+		 *
+		 * @param nbr_threads number of threads walking the head buckets, each one taking a contiguous range of them:
+		 * the calling one and threads joined before returning, whose thread ids should be lower than max_nbr_threads
+		 * @throw std::runtime_error if a walking thread has a thread id too high for the map
+		 */
+		structure_report structure_stats(std::size_t nbr_threads = 1);
+
 		/**
 		 * Returns the number of elements into the collection
 		 */
@@ -170,122 +639,561 @@ namespace wfc
 		bool is_empty() const noexcept;
 
 	private:
+		template <typename, typename, typename>
+		friend class frozen_map;
+
 		using node_t = details::node_t<hash_t, key_t, value_t>;
 		using node_union = details::node_union<node_t>;
 		using arraynode_t = details::arraynode_t<node_t>;
+		using compact_node_t = details::compact_node_t<node_t>;
+		using mcas_t = details::mcas_descriptor<hash_t, key_t, value_t>;
 
-		node_union allocate_node(hash_t hash, key_t key, value_t value) const;
+		struct alignas(64) publication_slot
+		{
+			std::atomic<node_union> node;
+		};
 
-		node_union expand_node(node_union arraynode, std::size_t position, std::size_t level) noexcept;
+		node_union allocate_node(hash_t hash, key_t key, value_t value) const;
 
-		bool try_node_insertion(node_union arraynode, std::size_t position, node_union& datanode);
+		node_union allocate_arraynode(hash_t hash, std::size_t depth) const;
 
-		template <typename Fun>
-		operation_result update_impl(const Key& key, const Value& value, Fun&& compare_expected_value);
+		node_union allocate_arraynode(memory_resource* resource, std::size_t depth) const;
 
-		template <typename Fun>
-		operation_result remove_impl(const Key& key, Fun&& compare_expected_value);
+		unordered_map(const fanout_schedule& schedule,
+		              std::size_t max_fail_count,
+		              std::size_t max_nbr_threads,
+		              std::vector<std::unique_ptr<huge_page_arena>> arenas,
+		              memory_resource* resource);
 
-		template <typename CmpFun, typename AllocFun>
-		operation_result update_or_remove_impl(const Key& key,
-		                                       CmpFun&& compare_expected_value,
-		                                       AllocFun&& replacing_node);
+		memory_resource* resource_for(hash_t hash) const noexcept;
 
-		void ensure_not_replaced(node_union& local, size_t position, size_t r, node_union& node);
+		static fanout_schedule legacy_schedule(std::size_t array_length);
 
-		template <typename VisitorFun>
-		void visit_array_node(node_union node, VisitorFun&& fun) noexcept(
-		    noexcept(std::is_nothrow_invocable_v<VisitorFun, std::pair<key_t, value_t>>));
+		static std::vector<std::size_t> make_levels(const fanout_schedule& schedule);
 
-		std::tuple<std::size_t, hash_t> compute_pos_and_hash(size_t array_pow, hash_t lasthash, size_t level) const;
+		static std::vector<std::size_t> make_shifts(const std::vector<std::size_t>& levels, bit_order order);
 
-		void safe_delete(node_union node_to_free);
+		static std::vector<std::unique_ptr<huge_page_arena>> make_arenas(memory_placement placement,
+		                                                                 std::size_t max_nbr_threads);
 
-		void watch_node(node_union node) noexcept;
+		void deallocate_node(node_union datanode) const noexcept;
 
-		void clear_watched_node() noexcept;
+		void deallocate_arraynode(node_union arraynode) const noexcept;
 
-		arraynode_t m_head;
-		std::size_t m_head_size;
-		std::size_t m_arrayLength;
-		std::size_t m_max_fail_count;
-		std::size_t m_max_nbr_threads;
-		std::atomic<std::size_t> m_size;
-		std::shared_ptr<std::atomic<std::uintptr_t>[]> m_watched_nodes;
+		void destroy_subtree(node_union node) const noexcept;
 
-		static constexpr std::size_t hash_size_in_bits = sizeof(hash_t) * std::numeric_limits<unsigned char>::digits;
-	};
+		node_union expand_node(node_union arraynode, std::size_t position, std::size_t depth) noexcept;
 
-	template <typename Key, typename Value, typename HashFunction>
-	unordered_map<Key, Value, HashFunction>::unordered_map(std::size_t array_length,
-	                                                       std::size_t max_fail_count,
-	                                                       std::size_t max_nbr_threads)
-	    : m_head(1UL << array_length)
-	    , m_head_size(1UL << array_length)
-	    , m_arrayLength(array_length)
-	    , m_max_fail_count(max_fail_count)
-	    , m_max_nbr_threads(max_nbr_threads)
-	    , m_size(0UL)
-	    , m_watched_nodes(new std::atomic<std::uintptr_t>[max_nbr_threads])
-	{
-		static_assert(std::atomic<std::size_t>::is_always_lock_free, "Atomic implementation is not lock free");
-		static_assert(std::atomic<node_union>::is_always_lock_free, "Atomic implementation is not lock free");
+		/**
+		 * Inserts the datanode in the slot if it is empty, the datanode is left to the caller otherwise.
+		 */
+		bool try_node_insertion(node_union arraynode, std::size_t position, node_union datanode);
 
-		for (std::ptrdiff_t i = 0, n = static_cast<std::ptrdiff_t>(m_max_nbr_threads); i < n; ++i)
-		{
-			m_watched_nodes[i] = 0;
-		}
+		/**
+		 * Inserts the key, whose datanode is new_node or, if it is null, allocated on first need.
+		 * new_node is null once inserted, and left to the caller otherwise.
+		 */
+		operation_result insert_node(hash_t fullhash, const Key& key, const Value& value, node_union& new_node);
 
-		if (!is_power_of_two(array_length))
-		{
-			throw std::runtime_error("Array length should be a power of two");
-		}
-	}
+		/**
+		 * Returns how many datanodes a compact arraynode in a slot at the given depth holds before being promoted,
+		 * 0 if the next level isn't compacted.
+		 */
+		std::size_t compact_capacity(std::size_t depth) const noexcept;
 
-	template <typename Key, typename Value, typename HashFunction>
-	operation_result unordered_map<Key, Value, HashFunction>::insert(const Key& key, const Value& value)
-	{
-		std::size_t nbr_bits_to_shift = log2_of_power_of_two(m_arrayLength);
+		/**
+		 * Replaces the datanode of the slot, which the calling thread watches, by a compact arraynode holding it
+		 * along with new_node, which goes to another position of the next level. new_node is left to the caller on
+		 * failure.
+		 * @return false if the slot doesn't hold the datanode anymore
+		 */
+		bool try_compact_expansion(node_union arraynode,
+		                           std::size_t position,
+		                           std::size_t depth,
+		                           node_union datanode,
+		                           node_union new_node);
 
-		std::size_t position;
-		std::size_t fail_count;
-		node_union local{&m_head};
-		mark_arraynode(local);
+		/**
+		 * Returns a compact arraynode for a slot at the given depth, holding both datanodes.
+		 */
+		compact_node_t* make_compact_pair(std::size_t depth, node_union first, node_union second) const;
 
-		hash_t fullhash = HashFunction{}(key);
-		hash_t hash = fullhash;
+		/**
+		 * Returns a copy of the compact arraynode whose datanode at the position is replaced by the given one,
+		 * or removed if it is null.
+		 */
+		static compact_node_t* make_compact_copy(const compact_node_t& compact, std::size_t position, node_union datanode);
 
-		for (std::size_t r = 0; r < hash_size_in_bits - nbr_bits_to_shift; r += nbr_bits_to_shift)
-		{
-			fail_count = 0;
-			std::tie(position, hash) = compute_pos_and_hash(nbr_bits_to_shift, hash, r);
-			node_union node = get_node(local, position);
+		/**
+		 * Returns a full arraynode for a slot at the given depth, holding the datanodes of the compact arraynode.
+		 */
+		node_union make_promoted_arraynode(const compact_node_t& compact, std::size_t depth) const;
 
-			while (true)
-			{
-				if (fail_count > m_max_fail_count)
-				{
-					node = mark_datanode(local, position);
-				}
+		/**
+		 * Freezes the compact arraynode of the slot, so that no copy replaces it anymore, then replaces it by a full
+		 * arraynode holding the same datanodes, which stay reachable meanwhile.
+		 * @return the full arraynode
+		 */
+		node_union promote_compact_node(node_union arraynode, std::size_t position, std::size_t depth) noexcept;
+
+		/**
+		 * Protects the compact arraynode read from the slot from reclamation.
+		 * @return nullptr if the slot doesn't hold it anymore, node is then the new content of the slot
+		 */
+		const compact_node_t* protect_compact_node(node_union arraynode, std::size_t position, node_union& node) noexcept;
+
+		/**
+		 * Watches a datanode of the protected compact arraynode read from the slot, which holds it as long as the slot
+		 * holds the compact arraynode.
+		 * @return false if the slot doesn't hold the compact arraynode anymore, node is then the new content of the slot
+		 */
+		bool watch_compact_child(node_union arraynode, std::size_t position, node_union& node, node_union datanode) noexcept;
+
+		/**
+		 * Replaces the protected compact arraynode read from the slot by a copy whose datanode at child_position is
+		 * the given one, or removed if it is null. The compact arraynode is retired on success.
+		 * @return false if the slot doesn't hold the compact arraynode anymore
+		 */
+		bool replace_compact_node(node_union arraynode,
+		                          std::size_t position,
+		                          node_union node,
+		                          std::size_t child_position,
+		                          node_union datanode);
+
+		/**
+		 * Inserts the key in the compact arraynode read from the slot, or in copies of it if it is replaced meanwhile.
+		 * The datanode is new_node, allocated if null, @see insert_node
+		 * @return an empty optional if the compact arraynode was promoted instead, node is then the full arraynode
+		 */
+		std::optional<operation_result> insert_in_compact_node(const Key& key,
+		                                                       const Value& value,
+		                                                       hash_t fullhash,
+		                                                       node_union arraynode,
+		                                                       std::size_t position,
+		                                                       std::size_t depth,
+		                                                       node_union& node,
+		                                                       node_union& new_node);
+
+		/**
+		 * Updates or removes the key in the compact arraynode read from the slot, @see update_or_remove_impl
+		 * @return an empty optional if the compact arraynode was promoted instead, node is then the full arraynode
+		 */
+		template <typename CmpFun, typename AllocFun>
+		std::optional<operation_result> update_in_compact_node(const Key& key,
+		                                                       hash_t fullhash,
+		                                                       CmpFun& compare_expected_value,
+		                                                       AllocFun& replacing_node,
+		                                                       node_union arraynode,
+		                                                       std::size_t position,
+		                                                       std::size_t depth,
+		                                                       node_union& node);
+
+		/**
+		 * Returns the datanode at the position of fullhash in the compact arraynode read from the slot, watched, null
+		 * if there is none, or the full arraynode replacing the compact one if it was promoted meanwhile.
+		 */
+		node_union find_in_compact_node(hash_t fullhash,
+		                                node_union arraynode,
+		                                std::size_t position,
+		                                std::size_t depth,
+		                                node_union node);
+
+		/**
+		 * Applies fun on the datanodes of the compact arraynode read from the slot while they are watched, by
+		 * increasing position, until it returns false. If the slot is replaced meanwhile, the datanodes after the last
+		 * visited position are read from its new content, the full arraynode replacing the compact one and that
+		 * position being given to resume.
+		 * @return false if fun or resume did
+		 */
+		template <typename Fun, typename ResumeFun>
+		bool visit_compact_node(
+		    node_union arraynode, std::size_t position, std::size_t depth, node_union node, Fun&& fun, ResumeFun&& resume);
+
+		static void delete_compact_node(void* compact);
+
+		template <typename Fun>
+		operation_result update_impl(const Key& key,
+		                             const Value& value,
+		                             Fun&& compare_expected_value,
+		                             bool combinable = false);
+
+		template <typename Fun>
+		operation_result remove_impl(const Key& key, Fun&& compare_expected_value);
+
+		template <typename CmpFun, typename AllocFun>
+		operation_result update_or_remove_impl(const Key& key,
+		                                       CmpFun&& compare_expected_value,
+		                                       AllocFun&& replacing_node,
+		                                       bool combinable = false);
+
+		/**
+		 * Returns true if the datanode read in place of the one an update tried to replace was published by
+		 * another update of the same key, so that the update can be combined with it.
+		 */
+		bool is_combinable_with(node_union current, hash_t fullhash) noexcept;
+
+		/**
+		 * Returns the slot where updates which succeeded while combining is enabled publish their datanode.
+		 */
+		std::atomic<node_union>& publication_of(hash_t fullhash) const noexcept;
+
+		void ensure_not_replaced(node_union& local, size_t position, size_t depth, node_union& node);
+
+		/**
+		 * Walks down to the datanode of the key and applies fun on it and on its slot while it is watched.
+		 * The slot of a datanode in a compact arraynode is the one holding the compact arraynode, unless
+		 * promote_compact is set, the compact arraynode being then promoted.
+		 * @return false if the key is not in the map.
+		 */
+		template <typename Fun>
+		bool visit_datanode(const Key& key, Fun&& fun, bool promote_compact = false);
+
+		/**
+		 * Reads the slot, completing the multi-key operation installed in it if any.
+		 */
+		node_union load_slot(node_union arraynode, std::size_t position) noexcept;
+
+		/**
+		 * Completes the multi-key operation whose descriptor was read from the slot, installing its remaining slots.
+		 * If another operation holds one of them, that one is helped instead, the caller reading the slot again.
+		 */
+		void help_descriptor(std::atomic<node_union>& slot, node_union descriptor) noexcept;
+
+		/**
+		 * Installs the descriptor in its slots, helping the operations in the way, decides its status, then releases
+		 * its slots. Run by the owner of the descriptor.
+		 */
+		void run_descriptor(mcas_t* desc) noexcept;
+
+		/**
+		 * Installs the descriptor in its slots not holding it yet, in address order.
+		 * If a slot holds another descriptor, stops there and returns it in blocker along with its slot in blocked.
+		 * @return true if every slot holds the descriptor, false if one of them doesn't hold the expected datanode
+		 * anymore, if the status was decided meanwhile, or if an other operation is in the way
+		 */
+		bool install_descriptor(mcas_t* desc, std::atomic<node_union>*& blocked, node_union& blocker) noexcept;
+
+		/**
+		 * Decides the status of the descriptor if still undecided, then gives the slots holding it their desired
+		 * datanodes if it succeeded, their expected ones otherwise.
+		 */
+		static void release_descriptor(mcas_t* desc, bool installed) noexcept;
+
+		static void delete_descriptor(void* desc);
+
+		/**
+		 * Returns true if the datanode carries an expiry timestamp which is over. Always false for other values.
+		 */
+		static bool is_expired(node_union datanode) noexcept;
+
+		/**
+		 * Replaces the expired datanode, which the calling thread watches, by replacement in its slot.
+		 * The expired datanode is reclaimed on success, the replacement is left to the caller otherwise.
+		 *
+		 * @param replacement a datanode, or nullptr to empty the slot
+		 * @return false if the slot doesn't hold the expired datanode anymore
+		 */
+		bool replace_expired(node_union arraynode, std::size_t position, node_union expired, node_union replacement);
+
+		std::size_t purge_expired_slot(node_union arraynode, std::size_t position, std::size_t depth);
+
+		template <typename Predicate>
+		std::size_t erase_buckets_if(Predicate& pred, std::size_t first, std::size_t last);
+
+		/**
+		 * Removes the datanodes of the slot's subtree matching the predicate, appending them to removed, which is
+		 * reclaimed whenever it reaches erase_batch_size datanodes.
+		 * A compact arraynode holding a matching datanode is promoted first.
+		 */
+		template <typename Predicate>
+		std::size_t erase_slot_if(node_union arraynode,
+		                          std::size_t position,
+		                          std::size_t depth,
+		                          Predicate& pred,
+		                          std::vector<node_union>& removed);
+
+		/**
+		 * Frees removed datanodes like safe_delete, scanning the hazards once for all of them.
+		 * The datanodes still watched by another thread are then freed one by one.
+		 */
+		void reclaim_removed(std::vector<node_union>& removed);
+
+		void collect_structure(const arraynode_t& array, std::size_t depth, structure_report& report);
+
+		void collect_compact_structure(const compact_node_t& compact, std::size_t depth, structure_report& report) const;
+
+		std::size_t collect_slots(const arraynode_t& array,
+		                          std::size_t first,
+		                          std::size_t last,
+		                          std::size_t depth,
+		                          structure_report& report);
+
+		static level_report& level_of(structure_report& report, std::size_t depth);
+
+		static void merge_structure(structure_report& report, const structure_report& other);
+
+		template <typename VisitorFun>
+		void visit_array_node(node_union node, VisitorFun&& fun) noexcept(
+		    noexcept(std::is_nothrow_invocable_v<VisitorFun, std::pair<key_t, value_t>>));
+
+		template <typename VisitorFun>
+		void visit_slot_protected(node_union arraynode, std::size_t position, std::size_t depth, VisitorFun&& fun);
+
+		/**
+		 * Returns the content of the slot, expanding it if it is a marked datanode.
+		 * A returned datanode is watched, the caller has to clear it once done. A compact arraynode isn't protected,
+		 * @see visit_compact_node
+		 */
+		node_union read_slot_protected(node_union arraynode, std::size_t position, std::size_t depth);
+
+		// Visits the elements of the subtree whose hash is in [lo, hi] in order, until fun returns false.
+		template <typename Fun>
+		bool visit_ordered(node_union arraynode, std::size_t depth, hash_t first, hash_t lo, hash_t hi, Fun&& fun);
+
+		void ensure_ordered() const;
+
+		bool build_insert(hash_t fullhash, const key_t& key, const value_t& value);
+
+		/**
+		 * Inserts the records of the chunks with build_insert.
+		 * @param check_buckets whether the records should belong to the head bucket of their chunk
+		 * @throw std::runtime_error if check_buckets is true and a record belongs to another head bucket
+		 */
+		std::size_t build_chunks(const details::snapshot::chunk_view* first,
+		                         const details::snapshot::chunk_view* last,
+		                         bool check_buckets);
+
+		/**
+		 * Moves the subtrees of the head buckets [first, last) of other into this map, @see merge
+		 * @param splice false if the nodes of other have to be copied
+		 */
+		std::size_t merge_buckets(unordered_map& other, std::size_t first, std::size_t last, bool splice);
+
+		/**
+		 * Moves a subtree of other into the slot at the same place in this map.
+		 * @return the number of datanodes added to this map, the others are freed
+		 */
+		std::size_t merge_subtree(node_union arraynode, std::size_t position, std::size_t depth, node_union moved);
+
+		/**
+		 * Applies fun on every datanode of a subtree no other thread accesses.
+		 */
+		template <typename Fun>
+		static void for_each_datanode(node_union node, Fun&& fun);
+
+		std::tuple<std::size_t, hash_t> compute_pos_and_hash(hash_t lasthash, std::size_t depth) const;
+
+		std::size_t next_position(hash_t fullhash, std::size_t depth) const;
+
+		void record_change(change_type type, const key_t& key, const value_t& value);
+
+		void safe_delete(node_union node_to_free);
+
+		void watch_node(node_union node) noexcept;
+
+		/**
+		 * Throws std::runtime_error if the id of the calling thread isn't lower than max_nbr_threads.
+		 * Called by the threads a parallel operation starts, before they touch any per-thread state.
+		 */
+		void check_thread_id() const;
+
+		void clear_watched_node() noexcept;
+
+		std::vector<std::unique_ptr<huge_page_arena>> m_arenas;
+		memory_resource* m_resource;
+		fanout_schedule m_schedule;
+		// Number of bits consumed at each depth, truncated so that their sum is hash_size_in_bits.
+		std::vector<std::size_t> m_levels;
+		// Position in the hash of the bits consumed at each depth.
+		std::vector<std::size_t> m_shifts;
+		arraynode_t m_head;
+		std::size_t m_head_size;
+		std::size_t m_max_fail_count;
+		std::size_t m_max_nbr_threads;
+		std::atomic<std::size_t> m_size;
+		// Five hazards per thread: the datanode, the multi-key operation descriptor and the compact arraynode it is
+		// reading, the datanode a combinable update is publishing, and the expected datanode of a descriptor being
+		// installed.
+		details::hazard_pointers m_hazards;
+		std::unique_ptr<details::change_log<key_t, value_t>> m_change_log;
+		contention_policy m_contention;
+		bool m_compact_arraynodes;
+		// Datanodes published by the last successful update of the keys of each slot, when combining is enabled.
+		// A published datanode is unpublished before being freed.
+		std::unique_ptr<publication_slot[]> m_publications;
+
+		static constexpr std::size_t hash_size_in_bits = sizeof(hash_t) * std::numeric_limits<unsigned char>::digits;
+		static constexpr std::size_t nbr_publications = 64;
+		static constexpr std::size_t erase_batch_size = 64;
+		// The three lowest bits of node pointers are used as marks.
+		static constexpr std::size_t node_alignment = std::max<std::size_t>(alignof(node_t), 8);
+		static constexpr std::size_t arraynode_alignment = std::max<std::size_t>(alignof(arraynode_t), 8);
+	};
+
+	template <typename Key, typename Value, typename HashFunction>
+	unordered_map<Key, Value, HashFunction>::unordered_map(std::size_t array_length,
+	                                                       std::size_t max_fail_count,
+	                                                       std::size_t max_nbr_threads,
+	                                                       memory_placement placement)
+	    : unordered_map(legacy_schedule(array_length), max_fail_count, max_nbr_threads, placement)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	unordered_map<Key, Value, HashFunction>::unordered_map(const fanout_schedule& schedule,
+	                                                       std::size_t max_fail_count,
+	                                                       std::size_t max_nbr_threads,
+	                                                       memory_placement placement)
+	    : unordered_map(schedule, max_fail_count, max_nbr_threads, make_arenas(placement, max_nbr_threads), nullptr)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	unordered_map<Key, Value, HashFunction>::unordered_map(const fanout_schedule& schedule,
+	                                                       std::size_t max_fail_count,
+	                                                       std::size_t max_nbr_threads,
+	                                                       memory_resource* resource)
+	    : unordered_map(schedule,
+	                    max_fail_count,
+	                    max_nbr_threads,
+	                    {},
+	                    resource != nullptr ? resource : throw std::runtime_error("Memory resource should not be null"))
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	unordered_map<Key, Value, HashFunction>::unordered_map(std::size_t array_length,
+	                                                       std::size_t max_fail_count,
+	                                                       std::size_t max_nbr_threads,
+	                                                       memory_resource* resource)
+	    : unordered_map(legacy_schedule(array_length), max_fail_count, max_nbr_threads, resource)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	unordered_map<Key, Value, HashFunction>::unordered_map(const fanout_schedule& schedule,
+	                                                       std::size_t max_fail_count,
+	                                                       std::size_t max_nbr_threads,
+	                                                       std::vector<std::unique_ptr<huge_page_arena>> arenas,
+	                                                       memory_resource* resource)
+	    : m_arenas(std::move(arenas))
+	    , m_resource(resource != nullptr ? resource
+	                                     : m_arenas.empty() ? new_delete_resource() : m_arenas.front().get())
+	    , m_schedule(schedule)
+	    , m_levels(make_levels(schedule))
+	    , m_shifts(make_shifts(m_levels, schedule.order()))
+	    , m_head(1UL << m_levels[0], m_resource)
+	    , m_head_size(1UL << m_levels[0])
+	    , m_max_fail_count(max_fail_count)
+	    , m_max_nbr_threads(max_nbr_threads)
+	    , m_size(0UL)
+	    , m_hazards(max_nbr_threads, 5)
+	    , m_change_log()
+	    , m_contention()
+	    , m_compact_arraynodes(false)
+	    , m_publications()
+	{
+		static_assert(std::atomic<std::size_t>::is_always_lock_free, "Atomic implementation is not lock free");
+		static_assert(std::atomic<node_union>::is_always_lock_free, "Atomic implementation is not lock free");
+
+		if (schedule.order() == bit_order::msb_first
+		    && (!std::numeric_limits<hash_t>::is_integer || std::numeric_limits<hash_t>::is_signed))
+		{
+			throw std::runtime_error("An ordered map needs an unsigned integral hash");
+		}
+
+		// Spreads the slots of the head on the nodes owning their buckets. Only pages holding the slots of a single
+		// node are moved, the others stay with the arena of the first node, along with a head too small to fill a page.
+		for (std::size_t node = 1; node < m_arenas.size(); ++node)
+		{
+			std::size_t first = node * m_head_size / m_arenas.size();
+			std::size_t last = (node + 1) * m_head_size / m_arenas.size();
+			details::bind_to_numa_node(&m_head[first], (last - first) * sizeof(m_head[first]), node);
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	unordered_map<Key, Value, HashFunction>::~unordered_map() noexcept
+	{
+		for (std::size_t i = 0; i < m_head_size; ++i)
+		{
+			destroy_subtree(m_head[i].load(std::memory_order_relaxed));
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	operation_result unordered_map<Key, Value, HashFunction>::insert(const Key& key, const Value& value)
+	{
+		node_union new_node{static_cast<node_t*>(nullptr)};
+		operation_result result = insert_node(HashFunction{}(key), key, value, new_node);
+		if (new_node.datanode_ptr != nullptr)
+		{
+			deallocate_node(new_node);
+		}
+
+		return result;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	operation_result unordered_map<Key, Value, HashFunction>::insert_node(hash_t fullhash,
+	                                                                      const Key& key,
+	                                                                      const Value& value,
+	                                                                      node_union& new_node)
+	{
+		details::backoff backoff(m_contention.backoff, m_contention.max_backoff_spins);
+		std::size_t position;
+		std::size_t fail_count;
+		node_union local{&m_head};
+		mark_arraynode(local);
+
+		hash_t hash = fullhash;
+
+		// The datanode is allocated once, and kept for the next attempts if it couldn't be inserted.
+		auto datanode = [this, &new_node, fullhash, &key, &value]() {
+			if (new_node.datanode_ptr == nullptr)
+			{
+				new_node = allocate_node(fullhash, key, value);
+			}
+			return new_node;
+		};
+
+		for (std::size_t depth = 0; depth + 1 < m_levels.size(); ++depth)
+		{
+			fail_count = 0;
+			std::tie(position, hash) = compute_pos_and_hash(hash, depth);
+			node_union node = load_slot(local, position);
+
+			while (true)
+			{
+				if (fail_count > m_max_fail_count)
+				{
+					node = mark_datanode(local, position);
+					if (is_descriptor(node))
+					{
+						node = load_slot(local, position);
+					}
+				}
 
 				if (node.datanode_ptr == nullptr)
 				{
-					node_union new_node = allocate_node(fullhash, key, value);
-					if (try_node_insertion(local, position, new_node))
+					if (try_node_insertion(local, position, datanode()))
 					{
+						new_node = node_union{static_cast<node_t*>(nullptr)};
 						clear_watched_node();
+						record_change(change_type::insert, key, value);
 
 						return operation_result::success;
 					}
-					else
-					{
-						node = new_node;
-					}
+
+					++fail_count;
+					backoff.pause();
+					node = load_slot(local, position);
+					continue;
 				}
 
 				if (is_marked(node))
 				{
-					node = expand_node(local, position, r);
+					node = expand_node(local, position, depth);
 				}
 
 				if (is_array_node(node))
@@ -293,24 +1201,69 @@ namespace wfc
 					local = node;
 					break;
 				}
+				else if (is_compact_node(node))
+				{
+					std::optional<operation_result> result =
+					    insert_in_compact_node(key, value, fullhash, local, position, depth, node, new_node);
+					if (result.has_value())
+					{
+						clear_watched_node();
+						return *result;
+					}
+
+					local = node;
+					break;
+				}
 				else
 				{
 					watch_node(node);
-					node_union node2 = get_node(local, position);
+					node_union node2 = load_slot(local, position);
 					if (node.ptr_int != node2.ptr_int)
 					{
 						++fail_count;
+						backoff.pause();
 						node = node2;
 						continue;
 					}
+					else if (is_expired(node))
+					{
+						// The expired datanode is replaced, whatever its key, rather than expanded.
+						if (replace_expired(local, position, node, datanode()))
+						{
+							new_node = node_union{static_cast<node_t*>(nullptr)};
+							clear_watched_node();
+							record_change(change_type::insert, key, value);
+
+							return operation_result::success;
+						}
+
+						++fail_count;
+						node = load_slot(local, position);
+					}
 					else if (node.datanode_ptr->hash == fullhash)
 					{
 						clear_watched_node();
 						return operation_result::already_present;
 					}
+					else if (compact_capacity(depth) != 0
+					         && next_position(node.datanode_ptr->hash, depth) != next_position(fullhash, depth))
+					{
+						if (try_compact_expansion(local, position, depth, node, datanode()))
+						{
+							new_node = node_union{static_cast<node_t*>(nullptr)};
+							clear_watched_node();
+							record_change(change_type::insert, key, value);
+
+							return operation_result::success;
+						}
+
+						++fail_count;
+						backoff.pause();
+						node = load_slot(local, position);
+					}
 					else
 					{
-						node = expand_node(local, position, r);
+						node = expand_node(local, position, depth);
 						if (is_array_node(node))
 						{
 							local = node;
@@ -325,13 +1278,34 @@ namespace wfc
 			}
 		}
 
+		// Every bit of the hash is consumed at the last level, so an occupied slot holds the same key.
 		clear_watched_node();
-		std::tie(position, std::ignore) = compute_pos_and_hash(position, hash, hash_size_in_bits - nbr_bits_to_shift);
-		node_union node = get_node(local, position);
+		std::tie(position, std::ignore) = compute_pos_and_hash(hash, m_levels.size() - 1);
+		node_union node = load_slot(local, position);
+		if (node.datanode_ptr != nullptr)
+		{
+			if constexpr (details::expiry_traits<value_t>::enabled)
+			{
+				watch_node(node);
+				if (node.ptr_int == load_slot(local, position).ptr_int && is_expired(node)
+				    && replace_expired(local, position, node, datanode()))
+				{
+					new_node = node_union{static_cast<node_t*>(nullptr)};
+					clear_watched_node();
+					record_change(change_type::insert, key, value);
+
+					return operation_result::success;
+				}
+				clear_watched_node();
+			}
+
+			return operation_result::already_present;
+		}
 
-		node_union new_node = allocate_node(fullhash, key, value);
-		if (node.datanode_ptr == nullptr && try_node_insertion(local, position, new_node))
+		if (try_node_insertion(local, position, datanode()))
 		{
+			new_node = node_union{static_cast<node_t*>(nullptr)};
+			record_change(change_type::insert, key, value);
 			return operation_result::success;
 		}
 
@@ -341,66 +1315,231 @@ namespace wfc
 	template <typename Key, typename Value, typename HashFunction>
 	std::optional<Value> unordered_map<Key, Value, HashFunction>::get(const Key& key)
 	{
-		std::size_t array_pow = log2_of_power_of_two(m_arrayLength);
+		std::optional<Value> result;
+		visit_value(key, [&result](const value_t& value) { result = value; });
 
-		std::size_t position;
-		node_union local{&m_head};
-		mark_arraynode(local);
+		return result;
+	}
 
-		hash_t fullhash = HashFunction{}(key);
-		hash_t hash = fullhash;
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun>
+	bool unordered_map<Key, Value, HashFunction>::visit_value(const Key& key, Fun&& fun)
+	{
+		bool found = false;
+		visit_datanode(key, [&fun, &found](std::atomic<node_union>&, node_union node) {
+			// Expired elements are absent, even before being reclaimed.
+			if (!is_expired(node))
+			{
+				std::invoke(fun, std::as_const(node.datanode_ptr->value));
+				found = true;
+			}
+		});
 
-		for (std::size_t r = 0; r < hash_size_in_bits - array_pow; r += array_pow)
+		return found;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun>
+	operation_result unordered_map<Key, Value, HashFunction>::atomic_update(const std::vector<Key>& keys, Fun&& fun)
+	{
+		static_assert(std::is_invocable_r_v<bool, Fun, std::vector<value_t>&>, "Functor doesn't respect the concept");
+
+		if (keys.empty())
+		{
+			return operation_result::success;
+		}
+
+		// Keys are told apart by their hashes, two keys with the same hash would be read from the same datanode.
+		std::vector<hash_t> hashes;
+		hashes.reserve(keys.size());
+		for (const key_t& key: keys)
+		{
+			hashes.push_back(HashFunction{}(key));
+		}
+		std::sort(hashes.begin(), hashes.end());
+		if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end())
+		{
+			throw std::runtime_error("Keys of an atomic update should have distinct hashes");
+		}
+
+		while (true)
+		{
+			auto desc = std::make_unique<mcas_t>();
+			desc->status = details::mcas_status::undecided;
+			desc->entries.reserve(keys.size());
+
+			std::vector<value_t> values;
+			values.reserve(keys.size());
+			for (const key_t& key: keys)
+			{
+				bool found = false;
+				visit_datanode(
+				    key,
+				    [&desc, &values, &found](std::atomic<node_union>& slot, node_union node) {
+					    // Expired elements are absent, even before being reclaimed.
+					    if (!is_expired(node))
+					    {
+						    const node_t& data = *node.datanode_ptr;
+						    desc->entries.push_back({&slot, node, node_union{}, data.hash, data.value});
+						    values.push_back(data.value);
+						    found = true;
+					    }
+				    },
+				    true);
+
+				if (!found)
+				{
+					return operation_result::element_not_found;
+				}
+			}
+
+			if (!std::invoke(fun, values))
+			{
+				return operation_result::expected_value_mismatch;
+			}
+
+			for (std::size_t i = 0; i < keys.size(); ++i)
+			{
+				desc->entries[i].desired = allocate_node(desc->entries[i].hash, keys[i], values[i]);
+			}
+
+			// Slots are installed in address order, which also brings the entries read from the same slot together.
+			std::sort(desc->entries.begin(), desc->entries.end(), [](const auto& lhs, const auto& rhs) {
+				return std::less<>{}(lhs.slot, rhs.slot);
+			});
+			auto same_slot = std::adjacent_find(desc->entries.begin(),
+			                                    desc->entries.end(),
+			                                    [](const auto& lhs, const auto& rhs) { return lhs.slot == rhs.slot; });
+			if (same_slot != desc->entries.end())
+			{
+				// Distinct keys were read from the same slot, one replacing the other between both reads, so the
+				// values aren't a snapshot: they are read again.
+				for (auto& entry: desc->entries)
+				{
+					deallocate_node(entry.desired);
+				}
+				continue;
+			}
+
+			run_descriptor(desc.get());
+
+			// Helpers may still be reading the descriptor. Once they are done, no slot can hold it again, and the
+			// expected datanodes, kept until then, can't be mistaken for a reused address by a late install.
+			m_hazards.wait_until_unprotected(reinterpret_cast<std::uintptr_t>(desc.get()));
+
+			bool succeeded = desc->status.load(std::memory_order_acquire) == details::mcas_status::succeeded;
+			for (auto& entry: desc->entries)
+			{
+				if (succeeded)
+				{
+					safe_delete(entry.expected);
+				}
+				else
+				{
+					// Desired datanodes of a failed operation were never reachable.
+					deallocate_node(entry.desired);
+				}
+			}
+
+			if (succeeded)
+			{
+				for (std::size_t i = 0; i < keys.size(); ++i)
+				{
+					record_change(change_type::update, keys[i], values[i]);
+				}
+
+				return operation_result::success;
+			}
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun>
+	bool unordered_map<Key, Value, HashFunction>::visit_datanode(const Key& key, Fun&& fun, bool promote_compact)
+	{
+		std::size_t position;
+		node_union local{&m_head};
+		mark_arraynode(local);
+
+		hash_t fullhash = HashFunction{}(key);
+		hash_t hash = fullhash;
+
+		for (std::size_t depth = 0; depth < m_levels.size(); ++depth)
 		{
-			std::tie(position, hash) = compute_pos_and_hash(array_pow, hash, r);
-			node_union node = get_node(local, position);
+			std::tie(position, hash) = compute_pos_and_hash(hash, depth);
+			node_union node = load_slot(local, position);
 
 			if (is_array_node(node))
 			{
 				local = node;
 			}
+			else if (is_marked(node))
+			{
+				local = expand_node(local, position, depth);
+			}
 			else if (node.datanode_ptr == nullptr)
 			{
 				clear_watched_node();
-				return std::nullopt;
+				return false;
+			}
+			else if (is_compact_node(node))
+			{
+				node = promote_compact ? promote_compact_node(local, position, depth)
+				                       : find_in_compact_node(fullhash, local, position, depth, node);
+				if (is_array_node(node))
+				{
+					local = node;
+					continue;
+				}
+
+				bool found = node.datanode_ptr != nullptr && node.datanode_ptr->hash == fullhash;
+				if (found)
+				{
+					std::invoke(fun, (*sanitize_ptr(local).arraynode_ptr)[position], node);
+				}
+				clear_watched_node();
+
+				return found;
 			}
 			else
 			{
 				watch_node(node);
-				if (node.ptr_int != get_node(local, position).ptr_int)
+				if (node.ptr_int != load_slot(local, position).ptr_int)
 				{
-					ensure_not_replaced(local, position, r, node);
+					ensure_not_replaced(local, position, depth, node);
 
 					if (is_array_node(node))
 					{
 						local = node;
+						continue;
 					}
 					else if (is_marked(node))
 					{
-						local = expand_node(local, position, r);
+						local = expand_node(local, position, depth);
+						continue;
 					}
 					else if (node.datanode_ptr == nullptr)
 					{
 						clear_watched_node();
-						return std::nullopt;
+						return false;
 					}
 				}
-				else if (node.datanode_ptr->hash == fullhash)
+
+				// The datanode read after a replacement is checked too, rather than looked for one level below.
+				if (node.datanode_ptr->hash == fullhash)
 				{
-					std::optional result = node.datanode_ptr->value;
+					std::invoke(fun, (*sanitize_ptr(local).arraynode_ptr)[position], node);
 					clear_watched_node();
 
-					return result;
-				}
-				else
-				{
-					break;
+					return true;
 				}
+
+				break;
 			}
 		}
 
 		clear_watched_node();
-		return std::nullopt;
+		return false;
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
@@ -414,7 +1553,7 @@ namespace wfc
 	template <typename Key, typename Value, typename HashFunction>
 	operation_result unordered_map<Key, Value, HashFunction>::update(const Key& key, const Value& value)
 	{
-		return update_impl(key, value, [](auto) { return true; });
+		return update_impl(key, value, [](auto) { return true; }, true);
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
@@ -437,350 +1576,2549 @@ namespace wfc
 		static_assert(std::is_invocable_v<VisitorFun, std::pair<key_t, value_t>>,
 		              "Visitor doesn't respect the concept");
 
+		node_union head{&m_head};
+		mark_arraynode(head);
+		visit_array_node(head, fun);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::save(std::ostream& os)
+	{
+		static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>,
+		              "Key and Value should be trivially copyable to be saved");
+		namespace snapshot = details::snapshot;
+
+		std::uint32_t order = static_cast<std::uint32_t>(m_schedule.order());
+		snapshot::write(os, snapshot::make_header(sizeof(key_t), sizeof(value_t), m_head_size, order, m_levels));
+
+		node_union head{&m_head};
+		mark_arraynode(head);
+
+		std::vector<char> records;
+		std::uint64_t total = 0;
 		for (std::size_t i = 0; i < m_head_size; ++i)
 		{
-			node_union node = m_head[i].load();
-			if (node.datanode_ptr != nullptr)
+			std::uint64_t count = 0;
+			records.clear();
+
+			visit_slot_protected(head, i, 0, [&records, &count](const key_t& key, const value_t& value) {
+				std::size_t offset = records.size();
+				records.resize(offset + sizeof(key_t) + sizeof(value_t));
+				std::memcpy(records.data() + offset, &key, sizeof(key_t));
+				std::memcpy(records.data() + offset + sizeof(key_t), &value, sizeof(value_t));
+				++count;
+			});
+
+			if (count != 0)
+			{
+				snapshot::write(os, snapshot::chunk_header{i, count});
+				os.write(records.data(), static_cast<std::streamsize>(records.size()));
+				total += count;
+			}
+		}
+
+		snapshot::write(os, snapshot::chunk_header{snapshot::end_of_chunks, total});
+
+		if (!os)
+		{
+			throw std::runtime_error("Unable to write snapshot");
+		}
+
+		return total;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::save(const std::string& path)
+	{
+		std::ofstream os(path, std::ios::binary | std::ios::trunc);
+		if (!os)
+		{
+			throw std::runtime_error("Unable to open " + path);
+		}
+
+		return save(os);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::load(std::istream& is)
+	{
+		static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>,
+		              "Key and Value should be trivially copyable to be loaded");
+		namespace snapshot = details::snapshot;
+
+		snapshot::header h;
+		snapshot::read(is, h);
+		snapshot::check_header(h, sizeof(key_t), sizeof(value_t));
+
+		std::size_t inserted = 0;
+		std::uint64_t total = 0;
+		while (true)
+		{
+			snapshot::chunk_header ch;
+			snapshot::read(is, ch);
+
+			if (ch.bucket == snapshot::end_of_chunks)
+			{
+				if (ch.count != total)
+				{
+					throw std::runtime_error("Corrupted snapshot");
+				}
+				break;
+			}
+
+			for (std::uint64_t i = 0; i < ch.count; ++i)
+			{
+				key_t key;
+				value_t value;
+				snapshot::read(is, key);
+				snapshot::read(is, value);
+
+				if (build_insert(HashFunction{}(key), key, value))
+				{
+					++inserted;
+				}
+			}
+			total += ch.count;
+		}
+
+		m_size.fetch_add(inserted, std::memory_order_relaxed);
+		return inserted;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::load(const std::string& path, std::size_t nbr_threads)
+	{
+		static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>,
+		              "Key and Value should be trivially copyable to be loaded");
+		namespace snapshot = details::snapshot;
+
+		details::mapped_file file(path);
+		std::vector<snapshot::chunk_view> chunks;
+		snapshot::header h = snapshot::parse(file.data(), file.size(), sizeof(key_t), sizeof(value_t), chunks);
+
+		// Buckets can only be built concurrently if each chunk lands into its own head bucket, which needs the map the
+		// snapshot was taken from to be laid out the same way. The records are then checked to belong to their chunk.
+		std::uint32_t order = static_cast<std::uint32_t>(m_schedule.order());
+		bool same_layout = h.head_size == m_head_size && snapshot::same_layout(h, order, m_levels);
+		if (!same_layout || nbr_threads == 0)
+		{
+			nbr_threads = 1;
+		}
+
+		if (nbr_threads == 1)
+		{
+			std::size_t inserted = build_chunks(chunks.data(), chunks.data() + chunks.size(), same_layout);
+			m_size.fetch_add(inserted, std::memory_order_relaxed);
+			return inserted;
+		}
+
+		std::uint64_t total = 0;
+		for (const snapshot::chunk_view& chunk: chunks)
+		{
+			total += chunk.count;
+		}
+
+		// Each worker gets a contiguous range of buckets holding about the same number of records.
+		std::vector<std::pair<const snapshot::chunk_view*, const snapshot::chunk_view*>> ranges;
+		const snapshot::chunk_view* first = chunks.data();
+		const snapshot::chunk_view* const last = chunks.data() + chunks.size();
+		std::uint64_t assigned = 0;
+		for (std::size_t i = 1; i <= nbr_threads && first != last; ++i)
+		{
+			const snapshot::chunk_view* it = first;
+			while (it != last && (assigned < total * i / nbr_threads || i == nbr_threads))
+			{
+				assigned += it->count;
+				++it;
+			}
+
+			ranges.emplace_back(first, it);
+			first = it;
+		}
+
+		// The size counts the buckets built by the workers which succeeded, should another one throw.
+		std::vector<std::size_t> built = details::run_workers(ranges.size(), [this, &ranges](std::size_t i) {
+			check_thread_id();
+			std::size_t inserted = build_chunks(ranges[i].first, ranges[i].second, true);
+			m_size.fetch_add(inserted, std::memory_order_relaxed);
+			return inserted;
+		});
+
+		return std::accumulate(built.begin(), built.end(), std::size_t{0});
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::merge(unordered_map&& other, std::size_t nbr_threads)
+	{
+		if (&other == this)
+		{
+			return 0;
+		}
+
+		// Datanodes are freed from the resource of the map holding them, which has to be the one they come from.
+		bool splice = m_levels == other.m_levels && m_shifts == other.m_shifts && m_arenas.empty()
+		              && other.m_arenas.empty() && m_resource == other.m_resource;
+
+		nbr_threads = std::clamp<std::size_t>(nbr_threads, 1, other.m_head_size);
+		if (nbr_threads == 1)
+		{
+			std::size_t merged = merge_buckets(other, 0, other.m_head_size, splice);
+			other.m_size.store(0, std::memory_order_relaxed);
+			return merged;
+		}
+
+		auto merge_range = [this, &other, nbr_threads, splice](std::size_t i) {
+			check_thread_id();
+			std::size_t head_size = other.m_head_size;
+			return merge_buckets(other, i * head_size / nbr_threads, (i + 1) * head_size / nbr_threads, splice);
+		};
+		std::vector<std::size_t> merged = details::run_workers(nbr_threads, merge_range);
+
+		other.m_size.store(0, std::memory_order_relaxed);
+		return std::accumulate(merged.begin(), merged.end(), std::size_t{0});
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::set_contention_policy(const contention_policy& policy)
+	{
+		m_contention = policy;
+		if (policy.combining && !m_publications)
+		{
+			m_publications = std::make_unique<publication_slot[]>(nbr_publications);
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::set_hazard_fence_mode(hazard_fence_mode mode)
+	{
+		return m_hazards.set_fence_mode(mode);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::enable_compact_arraynodes()
+	{
+		// Expired datanodes are replaced in their slot, which datanodes of compact arraynodes don't have.
+		static_assert(!details::expiry_traits<value_t>::enabled,
+		              "Maps with expiring values don't support compact arraynodes");
+
+		m_compact_arraynodes = true;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::enable_change_log(std::size_t capacity_per_thread)
+	{
+		m_change_log = std::make_unique<details::change_log<key_t, value_t>>(m_max_nbr_threads, capacity_per_thread);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun>
+	std::size_t unordered_map<Key, Value, HashFunction>::drain_changes(Fun&& fun)
+	{
+		static_assert(std::is_invocable_v<Fun, const change_record<key_t, value_t>&>,
+		              "Functor doesn't respect the concept");
+
+		if (!m_change_log)
+		{
+			return 0;
+		}
+
+		return m_change_log->drain(std::forward<Fun>(fun));
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::save_delta(std::ostream& os)
+	{
+		static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>,
+		              "Key and Value should be trivially copyable to be saved");
+		namespace snapshot = details::snapshot;
+
+		if (!m_change_log)
+		{
+			throw std::runtime_error("Change log is not enabled");
+		}
+
+		std::vector<key_t> keys;
+		m_change_log->drain([&keys](const change_record<key_t, value_t>& record) { keys.push_back(record.key); });
+
+		if (m_change_log->reset_overflow())
+		{
+			throw std::runtime_error("Change log overflowed, a full snapshot is required");
+		}
+
+		std::uint32_t order = static_cast<std::uint32_t>(m_schedule.order());
+		snapshot::header h
+		    = snapshot::make_header(sizeof(key_t), sizeof(value_t), m_head_size, order, m_levels, snapshot::delta_magic);
+		snapshot::write(os, h);
+
+		// Keys are told apart by their hashes, which brings the changes of a key together once sorted.
+		auto hash_less = [](const key_t& lhs, const key_t& rhs) { return HashFunction{}(lhs) < HashFunction{}(rhs); };
+		auto hash_equal = [](const key_t& lhs, const key_t& rhs) { return HashFunction{}(lhs) == HashFunction{}(rhs); };
+		std::sort(keys.begin(), keys.end(), hash_less);
+		keys.erase(std::unique(keys.begin(), keys.end(), hash_equal), keys.end());
+
+		std::uint64_t count = keys.size();
+		snapshot::write(os, count);
+
+		// Records of different threads aren't ordered, so the current state of each key is written instead of the
+		// recorded values. It is at least as recent as every drained change.
+		for (const key_t& key: keys)
+		{
+			std::optional<value_t> value = get(key);
+			snapshot::write(os, static_cast<std::uint8_t>(value.has_value()));
+			snapshot::write(os, key);
+			snapshot::write(os, value.value_or(value_t{}));
+		}
+
+		if (!os)
+		{
+			throw std::runtime_error("Unable to write delta");
+		}
+
+		return count;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::load_delta(std::istream& is)
+	{
+		static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>,
+		              "Key and Value should be trivially copyable to be loaded");
+		namespace snapshot = details::snapshot;
+
+		snapshot::header h;
+		snapshot::read(is, h);
+		snapshot::check_header(h, sizeof(key_t), sizeof(value_t), snapshot::delta_magic);
+
+		std::uint64_t count;
+		snapshot::read(is, count);
+
+		for (std::uint64_t i = 0; i < count; ++i)
+		{
+			std::uint8_t present;
+			key_t key;
+			value_t value;
+			snapshot::read(is, present);
+			snapshot::read(is, key);
+			snapshot::read(is, value);
+
+			if (present != 0)
+			{
+				if (insert(key, value) == operation_result::already_present)
+				{
+					update(key, value);
+				}
+			}
+			else
+			{
+				remove(key);
+			}
+		}
+
+		return count;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	placement_report unordered_map<Key, Value, HashFunction>::memory_placement_report() const
+	{
+		placement_report report{0, 0};
+		for (const auto& arena: m_arenas)
+		{
+			report.reserved_bytes += arena->reserved_bytes();
+			report.huge_page_bytes += arena->huge_page_bytes();
+		}
+
+		return report;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::numa_node_of(const Key& key) const
+	{
+		if (m_arenas.size() <= 1)
+		{
+			return 0;
+		}
+
+		hash_t hash = HashFunction{}(key);
+		return std::get<0>(compute_pos_and_hash(hash, 0)) * m_arenas.size() / m_head_size;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename VisitorFun>
+	void unordered_map<Key, Value, HashFunction>::visit_range(const Key& lo, const Key& hi, VisitorFun&& fun)
+	{
+		static_assert(std::is_invocable_v<VisitorFun, std::pair<key_t, value_t>>,
+		              "Visitor doesn't respect the concept");
+		ensure_ordered();
+
+		node_union head{&m_head};
+		mark_arraynode(head);
+		visit_ordered(head, 0, hash_t{0}, HashFunction{}(lo), HashFunction{}(hi), [&fun](std::pair<key_t, value_t> p) {
+			std::invoke(fun, std::move(p));
+			return true;
+		});
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::lower_bound(const Key& key) -> range_cursor
+	{
+		ensure_ordered();
+
+		return range_cursor(*this, HashFunction{}(key));
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	unordered_map<Key, Value, HashFunction>::range_cursor::range_cursor(unordered_map& map, hash_t from) noexcept
+	    : m_map(&map), m_from(from), m_done(false)
+	{
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::range_cursor::next() -> std::optional<std::pair<key_t, value_t>>
+	{
+		if (m_done)
+		{
+			return std::nullopt;
+		}
+
+		std::optional<std::pair<key_t, value_t>> result;
+		node_union head{&m_map->m_head};
+		mark_arraynode(head);
+		m_map->visit_ordered(
+		    head, 0, hash_t{0}, m_from, std::numeric_limits<hash_t>::max(), [&result](std::pair<key_t, value_t> p) {
+			    result = std::move(p);
+			    return false;
+		    });
+
+		if (!result.has_value())
+		{
+			m_done = true;
+			return std::nullopt;
+		}
+
+		hash_t hash = HashFunction{}(result->first);
+		m_done = hash == std::numeric_limits<hash_t>::max();
+		m_from = static_cast<hash_t>(hash + 1);
+
+		return result;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename VisitorFun>
+	void unordered_map<Key, Value, HashFunction>::visit_bucket(std::size_t bucket, VisitorFun&& fun)
+	{
+		static_assert(std::is_invocable_v<VisitorFun, const key_t&, const value_t&>,
+		              "Visitor doesn't respect the concept");
+
+		node_union head{&m_head};
+		mark_arraynode(head);
+		visit_slot_protected(head, bucket, 0, fun);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::head_size() const noexcept
+	{
+		return m_head_size;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::purge_expired(std::size_t bucket)
+	{
+		if constexpr (details::expiry_traits<value_t>::enabled)
+		{
+			node_union head{&m_head};
+			mark_arraynode(head);
+			return purge_expired_slot(head, bucket, 0);
+		}
+		else
+		{
+			static_cast<void>(bucket);
+			return 0;
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Predicate>
+	std::size_t unordered_map<Key, Value, HashFunction>::erase_if(Predicate&& pred, std::size_t nbr_threads)
+	{
+		static_assert(std::is_invocable_r_v<bool, Predicate, const key_t&, const value_t&>,
+		              "Predicate doesn't respect the concept");
+
+		nbr_threads = std::clamp<std::size_t>(nbr_threads, 1, m_head_size);
+		if (nbr_threads == 1)
+		{
+			return erase_buckets_if(pred, 0, m_head_size);
+		}
+
+		std::vector<std::size_t> erased = details::run_workers(nbr_threads, [this, &pred, nbr_threads](std::size_t i) {
+			check_thread_id();
+			return erase_buckets_if(pred, i * m_head_size / nbr_threads, (i + 1) * m_head_size / nbr_threads);
+		});
+
+		return std::accumulate(erased.begin(), erased.end(), std::size_t{0});
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	structure_report unordered_map<Key, Value, HashFunction>::structure_stats(std::size_t nbr_threads)
+	{
+		structure_report report{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, {}};
+		nbr_threads = std::clamp<std::size_t>(nbr_threads, 1, m_head_size);
+
+		// The head is described here, the workers only walk its slots.
+		std::vector<structure_report> partials(nbr_threads, report);
+		std::vector<std::size_t> used =
+		    details::run_workers(nbr_threads, [this, &partials, nbr_threads](std::size_t i) {
+			    check_thread_id();
+			    return collect_slots(
+			        m_head, m_head_size * i / nbr_threads, m_head_size * (i + 1) / nbr_threads, 0, partials[i]);
+		    });
+		std::size_t used_slots = std::accumulate(used.begin(), used.end(), std::size_t{0});
+
+		for (const structure_report& partial: partials)
+		{
+			merge_structure(report, partial);
+		}
+
+		level_report& head = level_of(report, 0);
+		++head.arraynodes;
+		++head.occupancy[used_slots * (level_report::occupancy_buckets - 1) / m_head_size];
+		++report.arraynodes;
+		report.bytes += sizeof(arraynode_t);
+
+		return report;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::size() const noexcept
+	{
+		return m_size.load(std::memory_order_relaxed);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::is_empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::allocate_node(hash_t hash, key_t key, value_t value) const
+	    -> node_union
+	{
+		memory_resource* resource = resource_for(hash);
+		void* memory = resource->allocate(sizeof(node_t), node_alignment);
+		try
+		{
+			return node_union{new (memory) node_t{hash, key, value}};
+		}
+		catch (...)
+		{
+			resource->deallocate(memory, sizeof(node_t), node_alignment);
+			throw;
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::allocate_arraynode(hash_t hash, std::size_t depth) const
+	    -> node_union
+	{
+		return allocate_arraynode(resource_for(hash), depth);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::allocate_arraynode(memory_resource* resource, std::size_t depth) const
+	    -> node_union
+	{
+		void* memory = resource->allocate(sizeof(arraynode_t), arraynode_alignment);
+		try
+		{
+			return node_union{new (memory) arraynode_t{1UL << m_levels[depth], resource}};
+		}
+		catch (...)
+		{
+			resource->deallocate(memory, sizeof(arraynode_t), arraynode_alignment);
+			throw;
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	memory_resource* unordered_map<Key, Value, HashFunction>::resource_for(hash_t hash) const noexcept
+	{
+		if (m_arenas.size() <= 1)
+		{
+			return m_resource;
+		}
+
+		return m_arenas[std::get<0>(compute_pos_and_hash(hash, 0)) * m_arenas.size() / m_head_size].get();
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	fanout_schedule unordered_map<Key, Value, HashFunction>::legacy_schedule(std::size_t array_length)
+	{
+		if (!is_power_of_two(array_length))
+		{
+			throw std::runtime_error("Array length should be a power of two");
+		}
+
+		return fanout_schedule{array_length, log2_of_power_of_two(array_length)};
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::vector<std::size_t> unordered_map<Key, Value, HashFunction>::make_levels(const fanout_schedule& schedule)
+	{
+		std::vector<std::size_t> levels;
+		for (std::size_t consumed = 0, depth = 0; consumed < hash_size_in_bits; ++depth)
+		{
+			std::size_t bits = std::min(schedule.bits_at(depth), hash_size_in_bits - consumed);
+			levels.push_back(bits);
+			consumed += bits;
+		}
+
+		return levels;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::vector<std::size_t> unordered_map<Key, Value, HashFunction>::make_shifts(const std::vector<std::size_t>& levels,
+	                                                                             bit_order order)
+	{
+		std::vector<std::size_t> shifts;
+		for (std::size_t consumed = 0, depth = 0; depth < levels.size(); ++depth)
+		{
+			consumed += levels[depth];
+			shifts.push_back(order == bit_order::lsb_first ? consumed - levels[depth] : hash_size_in_bits - consumed);
+		}
+
+		return shifts;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::make_arenas(memory_placement placement, std::size_t max_nbr_threads)
+	    -> std::vector<std::unique_ptr<huge_page_arena>>
+	{
+		std::vector<std::unique_ptr<huge_page_arena>> arenas;
+
+		if (placement == memory_placement::huge_pages)
+		{
+			arenas.push_back(std::make_unique<huge_page_arena>(max_nbr_threads));
+		}
+		else if (placement == memory_placement::numa)
+		{
+			for (std::size_t node = 0, n = numa_node_count(); node < n; ++node)
+			{
+				arenas.push_back(std::make_unique<huge_page_arena>(max_nbr_threads, node));
+			}
+		}
+
+		return arenas;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::deallocate_node(node_union datanode) const noexcept
+	{
+		memory_resource* resource = resource_for(datanode.datanode_ptr->hash);
+		datanode.datanode_ptr->~node_t();
+		resource->deallocate(datanode.datanode_ptr, sizeof(node_t), node_alignment);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::deallocate_arraynode(node_union arraynode) const noexcept
+	{
+		arraynode_t* ptr = sanitize_ptr(arraynode).arraynode_ptr;
+		memory_resource* resource = ptr->resource();
+		ptr->~arraynode_t();
+		resource->deallocate(ptr, sizeof(arraynode_t), arraynode_alignment);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::destroy_subtree(node_union node) const noexcept
+	{
+		if (is_array_node(node))
+		{
+			arraynode_t& array = *sanitize_ptr(node).arraynode_ptr;
+			for (std::size_t i = 0; i < array.size(); ++i)
+			{
+				destroy_subtree(array[i].load(std::memory_order_relaxed));
+			}
+			deallocate_arraynode(node);
+		}
+		else if (is_compact_node(node))
+		{
+			compact_node_t* compact = untag_compact_node(node);
+			compact->for_each([this](std::size_t, node_t* datanode) { deallocate_node(node_union{datanode}); });
+			compact_node_t::destroy(compact);
+		}
+		else
+		{
+			unmark_datanode(node);
+			if (node.datanode_ptr != nullptr)
+			{
+				deallocate_node(node);
+			}
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::expand_node(node_union arraynode,
+	                                                          std::size_t position,
+	                                                          std::size_t depth) noexcept -> node_union
+	{
+		std::atomic<node_union>& node_atomic = (*sanitize_ptr(arraynode).arraynode_ptr)[position];
+		node_union old_value = node_atomic.load(std::memory_order_acquire);
+
+		watch_node(old_value);
+
+		if (is_array_node(old_value))
+		{
+			return old_value;
+		}
+		if (is_descriptor(old_value))
+		{
+			return load_slot(arraynode, position);
+		}
+		if (is_compact_node(old_value))
+		{
+			return promote_compact_node(arraynode, position, depth);
+		}
+		node_union value = node_atomic.load(std::memory_order_acquire);
+
+		if (value.ptr_int != old_value.ptr_int)
+		{
+			return load_slot(arraynode, position);
+		}
+
+		unmark_datanode(value);
+		if (value.datanode_ptr != nullptr)
+		{
+			node_union array_node = allocate_arraynode(value.datanode_ptr->hash, depth + 1);
+			std::size_t new_pos = next_position(value.datanode_ptr->hash, depth);
+
+			// The new arraynode is published by the release compare-and-swap.
+			(*array_node.arraynode_ptr)[new_pos].store(value, std::memory_order_relaxed);
+			mark_arraynode(array_node);
+
+			if (!node_atomic.compare_exchange_weak(
+			        old_value, array_node, std::memory_order_release, std::memory_order_relaxed))
+			{
+				array_node = sanitize_ptr(array_node);
+				(*array_node.arraynode_ptr)[new_pos].store(node_union{}, std::memory_order_relaxed);
+				deallocate_arraynode(array_node);
+			}
+		}
+
+		return load_slot(arraynode, position);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::try_node_insertion(node_union arraynode,
+	                                                                 std::size_t position,
+	                                                                 node_union datanode)
+	{
+		node_union null{static_cast<node_t*>(nullptr)};
+
+		arraynode_t& array = (*sanitize_ptr(arraynode).arraynode_ptr);
+
+		if (array[position].compare_exchange_weak(null, datanode, std::memory_order_release, std::memory_order_relaxed))
+		{
+			m_size.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::compact_capacity(std::size_t depth) const noexcept
+	{
+		// A bitmap covers up to 64 positions, and below 4 a compact arraynode saves next to nothing.
+		if (!m_compact_arraynodes || depth + 1 >= m_levels.size() || m_levels[depth + 1] < 2
+		    || (std::size_t{1} << m_levels[depth + 1]) > compact_node_t::max_positions)
+		{
+			return 0;
+		}
+
+		return (std::size_t{1} << m_levels[depth + 1]) / 2;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::try_compact_expansion(node_union arraynode,
+	                                                                    std::size_t position,
+	                                                                    std::size_t depth,
+	                                                                    node_union datanode,
+	                                                                    node_union new_node)
+	{
+		compact_node_t* compact = make_compact_pair(depth, datanode, new_node);
+
+		// The compact arraynode and the new datanode are published by the release compare-and-swap.
+		if ((*sanitize_ptr(arraynode).arraynode_ptr)[position].compare_exchange_strong(
+		        datanode, tag_compact_node(compact), std::memory_order_release, std::memory_order_relaxed))
+		{
+			m_size.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		compact_node_t::destroy(compact);
+
+		return false;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::make_compact_pair(std::size_t depth,
+	                                                                node_union first,
+	                                                                node_union second) const -> compact_node_t*
+	{
+		std::size_t first_position = next_position(first.datanode_ptr->hash, depth);
+		std::size_t second_position = next_position(second.datanode_ptr->hash, depth);
+		assert(first_position != second_position);
+
+		compact_node_t* compact = compact_node_t::create(
+		    std::uint64_t{1} << first_position | std::uint64_t{1} << second_position, resource_for(first.datanode_ptr->hash));
+		(*compact)[compact->index_of(first_position)] = first.datanode_ptr;
+		(*compact)[compact->index_of(second_position)] = second.datanode_ptr;
+
+		return compact;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::make_compact_copy(const compact_node_t& compact,
+	                                                                std::size_t position,
+	                                                                node_union datanode) -> compact_node_t*
+	{
+		const std::uint64_t bit = std::uint64_t{1} << position;
+		compact_node_t* copy = compact_node_t::create(
+		    datanode.datanode_ptr != nullptr ? compact.bitmap() | bit : compact.bitmap() & ~bit, compact.resource());
+
+		compact.for_each([copy, position](std::size_t child_position, node_t* child) {
+			if (child_position != position)
+			{
+				(*copy)[copy->index_of(child_position)] = child;
+			}
+		});
+		if (datanode.datanode_ptr != nullptr)
+		{
+			(*copy)[copy->index_of(position)] = datanode.datanode_ptr;
+		}
+
+		return copy;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::make_promoted_arraynode(const compact_node_t& compact,
+	                                                                      std::size_t depth) const -> node_union
+	{
+		node_union array_node = allocate_arraynode(compact.resource(), depth + 1);
+		compact.for_each([&array_node](std::size_t child_position, node_t* child) {
+			(*array_node.arraynode_ptr)[child_position].store(node_union{child}, std::memory_order_relaxed);
+		});
+		mark_arraynode(array_node);
+
+		return array_node;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::promote_compact_node(node_union arraynode,
+	                                                                   std::size_t position,
+	                                                                   std::size_t depth) noexcept -> node_union
+	{
+		std::atomic<node_union>& slot = (*sanitize_ptr(arraynode).arraynode_ptr)[position];
+		node_union node = slot.load(std::memory_order_acquire);
+
+		while (is_compact_node(node))
+		{
+			if (!is_marked(node))
+			{
+				// Fails if a copy replaced the compact arraynode, which is then frozen in turn.
+				node_union frozen = node;
+				mark_datanode(frozen);
+				if (slot.compare_exchange_strong(node, frozen, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					node = frozen;
+				}
+				continue;
+			}
+
+			const compact_node_t* compact = protect_compact_node(arraynode, position, node);
+			if (compact == nullptr)
+			{
+				continue;
+			}
+
+			// Once frozen, only the full arraynode can replace the compact one, which every promoter builds alike.
+			node_union array_node = make_promoted_arraynode(*compact, depth);
+			node_union frozen = node;
+			if (slot.compare_exchange_strong(node, array_node, std::memory_order_release, std::memory_order_acquire))
+			{
+				m_hazards.clear(2);
+				m_hazards.retire(untag_compact_node(frozen), &delete_compact_node);
+				node = array_node;
+			}
+			else
+			{
+				m_hazards.clear(2);
+				deallocate_arraynode(array_node);
+			}
+		}
+
+		return load_slot(arraynode, position);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::protect_compact_node(node_union arraynode,
+	                                                                   std::size_t position,
+	                                                                   node_union& node) noexcept
+	    -> const compact_node_t*
+	{
+		const compact_node_t* compact = untag_compact_node(node);
+		m_hazards.protect(2, reinterpret_cast<std::uintptr_t>(compact));
+
+		node_union current = load_slot(arraynode, position);
+		if (current.ptr_int != node.ptr_int)
+		{
+			m_hazards.clear(2);
+			node = current;
+			return nullptr;
+		}
+
+		return compact;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::watch_compact_child(node_union arraynode,
+	                                                                  std::size_t position,
+	                                                                  node_union& node,
+	                                                                  node_union datanode) noexcept
+	{
+		watch_node(datanode);
+
+		node_union current = load_slot(arraynode, position);
+		if (current.ptr_int != node.ptr_int)
+		{
+			clear_watched_node();
+			node = current;
+			return false;
+		}
+
+		return true;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::replace_compact_node(node_union arraynode,
+	                                                                   std::size_t position,
+	                                                                   node_union node,
+	                                                                   std::size_t child_position,
+	                                                                   node_union datanode)
+	{
+		compact_node_t* copy = make_compact_copy(*untag_compact_node(node), child_position, datanode);
+
+		node_union expected = node;
+		if (!(*sanitize_ptr(arraynode).arraynode_ptr)[position].compare_exchange_strong(
+		        expected, tag_compact_node(copy), std::memory_order_release, std::memory_order_relaxed))
+		{
+			compact_node_t::destroy(copy);
+			return false;
+		}
+
+		// Readers which protected it before may still be reading it, and the datanodes are shared with the copy.
+		m_hazards.clear(2);
+		m_hazards.retire(untag_compact_node(node), &delete_compact_node);
+
+		return true;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::insert_in_compact_node(const Key& key,
+	                                                                     const Value& value,
+	                                                                     hash_t fullhash,
+	                                                                     node_union arraynode,
+	                                                                     std::size_t position,
+	                                                                     std::size_t depth,
+	                                                                     node_union& node,
+	                                                                     node_union& new_node)
+	    -> std::optional<operation_result>
+	{
+		details::backoff backoff(m_contention.backoff, m_contention.max_backoff_spins);
+		const std::size_t child_position = next_position(fullhash, depth);
+		std::size_t fail_count = 0;
+
+		while (is_compact_node(node))
+		{
+			if (is_marked(node) || fail_count > m_max_fail_count)
+			{
+				node = promote_compact_node(arraynode, position, depth);
+				break;
+			}
+
+			const compact_node_t* compact = protect_compact_node(arraynode, position, node);
+			if (compact == nullptr)
+			{
+				++fail_count;
+				backoff.pause();
+				continue;
+			}
+
+			if (compact->contains(child_position))
+			{
+				node_union child{(*compact)[compact->index_of(child_position)]};
+				bool watched = watch_compact_child(arraynode, position, node, child);
+				m_hazards.clear(2);
+				if (!watched)
+				{
+					++fail_count;
+					backoff.pause();
+					continue;
+				}
+
+				if (child.datanode_ptr->hash == fullhash)
+				{
+					clear_watched_node();
+					return operation_result::already_present;
+				}
+
+				// The other key at that position moves one level below, in a full arraynode.
+				node = promote_compact_node(arraynode, position, depth);
+				break;
+			}
+
+			if (compact->size() >= compact_capacity(depth))
+			{
+				m_hazards.clear(2);
+				node = promote_compact_node(arraynode, position, depth);
+				break;
+			}
+
+			if (new_node.datanode_ptr == nullptr)
+			{
+				new_node = allocate_node(fullhash, key, value);
+			}
+			if (replace_compact_node(arraynode, position, node, child_position, new_node))
+			{
+				new_node = node_union{static_cast<node_t*>(nullptr)};
+				m_size.fetch_add(1, std::memory_order_relaxed);
+				record_change(change_type::insert, key, value);
+
+				return operation_result::success;
+			}
+
+			m_hazards.clear(2);
+			++fail_count;
+			backoff.pause();
+			node = load_slot(arraynode, position);
+		}
+
+		return std::nullopt;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename CmpFun, typename AllocFun>
+	auto unordered_map<Key, Value, HashFunction>::update_in_compact_node(const Key& key,
+	                                                                     hash_t fullhash,
+	                                                                     CmpFun& compare_expected_value,
+	                                                                     AllocFun& replacing_node,
+	                                                                     node_union arraynode,
+	                                                                     std::size_t position,
+	                                                                     std::size_t depth,
+	                                                                     node_union& node)
+	    -> std::optional<operation_result>
+	{
+		details::backoff backoff(m_contention.backoff, m_contention.max_backoff_spins);
+		const std::size_t child_position = next_position(fullhash, depth);
+		std::size_t fail_count = 0;
+
+		while (is_compact_node(node))
+		{
+			if (is_marked(node) || fail_count > m_max_fail_count)
+			{
+				node = promote_compact_node(arraynode, position, depth);
+				break;
+			}
+
+			const compact_node_t* compact = protect_compact_node(arraynode, position, node);
+			if (compact == nullptr)
+			{
+				++fail_count;
+				backoff.pause();
+				continue;
+			}
+
+			if (!compact->contains(child_position))
+			{
+				m_hazards.clear(2);
+				return operation_result::element_not_found;
+			}
+
+			node_union child{(*compact)[compact->index_of(child_position)]};
+			if (!watch_compact_child(arraynode, position, node, child))
+			{
+				m_hazards.clear(2);
+				++fail_count;
+				backoff.pause();
+				continue;
+			}
+
+			if (!(child.datanode_ptr->hash == fullhash))
+			{
+				m_hazards.clear(2);
+				clear_watched_node();
+				return operation_result::element_not_found;
+			}
+			if (!compare_expected_value(child.datanode_ptr))
+			{
+				m_hazards.clear(2);
+				clear_watched_node();
+				return operation_result::expected_value_mismatch;
+			}
+
+			node_union new_node = replacing_node(fullhash);
+			if (replace_compact_node(arraynode, position, node, child_position, new_node))
+			{
+				if (new_node.datanode_ptr == nullptr)
+				{
+					m_size.fetch_sub(1, std::memory_order_relaxed);
+					record_change(change_type::remove, key, child.datanode_ptr->value);
+				}
+				else
+				{
+					record_change(change_type::update, key, new_node.datanode_ptr->value);
+				}
+
+				clear_watched_node();
+				safe_delete(child);
+
+				return operation_result::success;
+			}
+
+			m_hazards.clear(2);
+			clear_watched_node();
+			if (new_node.datanode_ptr != nullptr)
+			{
+				deallocate_node(new_node);
+			}
+			++fail_count;
+			backoff.pause();
+			node = load_slot(arraynode, position);
+		}
+
+		return std::nullopt;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::find_in_compact_node(hash_t fullhash,
+	                                                                   node_union arraynode,
+	                                                                   std::size_t position,
+	                                                                   std::size_t depth,
+	                                                                   node_union node) -> node_union
+	{
+		const std::size_t child_position = next_position(fullhash, depth);
+		std::size_t fail_count = 0;
+
+		// A frozen compact arraynode is still read, its promotion doesn't change its datanodes.
+		while (is_compact_node(node))
+		{
+			if (fail_count > m_max_fail_count)
+			{
+				return promote_compact_node(arraynode, position, depth);
+			}
+
+			const compact_node_t* compact = protect_compact_node(arraynode, position, node);
+			if (compact == nullptr)
+			{
+				++fail_count;
+				continue;
+			}
+
+			if (!compact->contains(child_position))
+			{
+				m_hazards.clear(2);
+				return node_union{};
+			}
+
+			node_union child{(*compact)[compact->index_of(child_position)]};
+			bool watched = watch_compact_child(arraynode, position, node, child);
+			m_hazards.clear(2);
+			if (watched)
+			{
+				return child;
+			}
+			++fail_count;
+		}
+
+		return node;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun, typename ResumeFun>
+	bool unordered_map<Key, Value, HashFunction>::visit_compact_node(
+	    node_union arraynode, std::size_t position, std::size_t depth, node_union node, Fun&& fun, ResumeFun&& resume)
+	{
+		std::size_t next = 0;
+		std::size_t fail_count = 0;
+
+		while (is_compact_node(node))
+		{
+			if (fail_count > m_max_fail_count)
+			{
+				node = promote_compact_node(arraynode, position, depth);
+				break;
+			}
+
+			const compact_node_t* compact = protect_compact_node(arraynode, position, node);
+			if (compact == nullptr)
+			{
+				++fail_count;
+				continue;
+			}
+
+			bool replaced = false;
+			bool keep_going = true;
+			compact->for_each([&](std::size_t child_position, node_t* child) {
+				if (replaced || !keep_going || child_position < next)
+				{
+					return;
+				}
+
+				node_union datanode{child};
+				if (!watch_compact_child(arraynode, position, node, datanode))
+				{
+					replaced = true;
+					return;
+				}
+				keep_going = std::invoke(fun, datanode);
+				clear_watched_node();
+				next = child_position + 1;
+			});
+			m_hazards.clear(2);
+
+			if (!replaced)
+			{
+				return keep_going;
+			}
+			++fail_count;
+		}
+
+		return std::invoke(resume, node, next);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::delete_compact_node(void* compact)
+	{
+		compact_node_t::destroy(static_cast<compact_node_t*>(compact));
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun>
+	operation_result unordered_map<Key, Value, HashFunction>::update_impl(const Key& key,
+	                                                                      const Value& value,
+	                                                                      Fun&& compare_expected_value,
+	                                                                      bool combinable)
+	{
+		return update_or_remove_impl(
+		    key,
+		    compare_expected_value,
+		    [&value, &key, this](hash_t fullhash) { return this->allocate_node(fullhash, key, value); },
+		    combinable);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun>
+	operation_result unordered_map<Key, Value, HashFunction>::remove_impl(const Key& key, Fun&& compare_expected_value)
+	{
+		return update_or_remove_impl(key, compare_expected_value, [](hash_t) { return node_union{}; });
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename CmpFun, typename AllocFun>
+	operation_result unordered_map<Key, Value, HashFunction>::update_or_remove_impl(const Key& key,
+	                                                                                CmpFun&& compare_expected_value,
+	                                                                                AllocFun&& replacing_node,
+	                                                                                bool combinable)
+	{
+		details::backoff backoff(m_contention.backoff, m_contention.max_backoff_spins);
+		combinable = combinable && m_contention.combining;
+		std::size_t position;
+		node_union local{&m_head};
+		mark_arraynode(local);
+
+		hash_t fullhash = HashFunction{}(key);
+		hash_t hash = fullhash;
+
+		for (std::size_t depth = 0; depth < m_levels.size(); ++depth)
+		{
+			std::tie(position, hash) = compute_pos_and_hash(hash, depth);
+			node_union node = load_slot(local, position);
+
+			if (is_array_node(node))
+			{
+				local = node;
+			}
+			else if (is_marked(node))
+			{
+				local = expand_node(local, position, depth);
+			}
+			else if (node.datanode_ptr == nullptr)
+			{
+				clear_watched_node();
+				return operation_result::element_not_found;
+			}
+			else if (is_compact_node(node))
+			{
+				std::optional<operation_result> result = update_in_compact_node(
+				    key, fullhash, compare_expected_value, replacing_node, local, position, depth, node);
+				if (result.has_value())
+				{
+					return *result;
+				}
+
+				local = node;
+			}
+			else
+			{
+				watch_node(node);
+				if (node.ptr_int != load_slot(local, position).ptr_int)
+				{
+					ensure_not_replaced(local, position, depth, node);
+
+					if (is_array_node(node))
+					{
+						local = node;
+						continue;
+					}
+					else if (is_marked(node))
+					{
+						local = expand_node(local, position, depth);
+						continue;
+					}
+					else if (node.datanode_ptr == nullptr)
+					{
+						clear_watched_node();
+						return operation_result::element_not_found;
+					}
+				}
+
+				if (node.datanode_ptr->hash == fullhash && is_expired(node))
+				{
+					replace_expired(local, position, node, node_union{static_cast<node_t*>(nullptr)});
+					clear_watched_node();
+					return operation_result::element_not_found;
+				}
+				else if (node.datanode_ptr->hash == fullhash)
+				{
+					if (!compare_expected_value(node.datanode_ptr))
+					{
+						clear_watched_node();
+						return operation_result::expected_value_mismatch;
+					}
+
+					node_union new_node = replacing_node(fullhash);
+					if (combinable)
+					{
+						// The new datanode is watched until published, so that it can't be freed before. It has its own
+						// hazard, the replaced datanode staying watched until the compare-and-swap is done.
+						m_hazards.protect(3, new_node.ptr_int);
+					}
+					node_union expected = node;
+					if ((*sanitize_ptr(local).arraynode_ptr)[position].compare_exchange_weak(
+					        node, new_node, std::memory_order_release, std::memory_order_relaxed))
+					{
+						if (combinable)
+						{
+							publication_of(fullhash).store(new_node, std::memory_order_release);
+							m_hazards.clear(3);
+						}
+
+						if (new_node.datanode_ptr == nullptr)
+						{
+							m_size.fetch_sub(1, std::memory_order_relaxed);
+							record_change(change_type::remove, key, node.datanode_ptr->value);
+						}
+						else
+						{
+							record_change(change_type::update, key, new_node.datanode_ptr->value);
+						}
+
+						// Watches are dropped before waiting for the readers of the replaced datanode, otherwise
+						// updates of a hot key would each wait for the one which replaced their own datanode.
+						clear_watched_node();
+						safe_delete(node);
+						//delete node.datanode_ptr;
+
+						return operation_result::success;
+					}
+					else
+					{
+						if (combinable)
+						{
+							m_hazards.clear(3);
+						}
+						if (new_node.datanode_ptr != nullptr)
+						{
+							deallocate_node(new_node);
+						}
+
+						backoff.pause();
+						node = load_slot(local, position);
+						if (combinable && node.ptr_int != expected.ptr_int && is_combinable_with(node, fullhash))
+						{
+							// Linearized right before the update which replaced the datanode, it is never observed.
+							// It isn't recorded in the change log either, where it could be drained after that update.
+							clear_watched_node();
+							return operation_result::success;
+						}
+						else if (is_array_node(node))
+						{
+							local = node;
+						}
+						else if (is_marked(node) || is_compact_node(node))
+						{
+							// A compact arraynode holding the datanode is promoted rather than searched.
+							local = expand_node(local, position, depth);
+						}
+						else
+						{
+							clear_watched_node();
+							return operation_result::element_not_found;
+						}
+					}
+				}
+				else
+				{
+					clear_watched_node();
+					return operation_result::element_not_found;
+				}
+			}
+		}
+
+		clear_watched_node();
+		return operation_result::element_not_found;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::ensure_not_replaced(node_union& local,
+	                                                                  size_t position,
+	                                                                  size_t depth,
+	                                                                  node_union& node)
+	{
+		details::backoff backoff(m_contention.backoff, m_contention.max_backoff_spins);
+		std::size_t fail_count = 0;
+		do
+		{
+			if (fail_count > 0)
+			{
+				backoff.pause();
+			}
+			node = load_slot(local, position);
+			if (is_compact_node(node))
+			{
+				// The datanode was expanded into a compact arraynode, which is promoted rather than searched.
+				node = expand_node(local, position, depth);
+				break;
+			}
+			watch_node(node);
+			++fail_count;
+
+			// Nodes of the last level can't be expanded since they have no hash bits left.
+			if (fail_count > m_max_fail_count && depth + 1 < m_levels.size())
+			{
+				mark_datanode(node);
+				local = expand_node(local, position, depth);
+				break;
+			}
+		} while (node.ptr_int != load_slot(local, position).ptr_int);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::load_slot(node_union arraynode, std::size_t position) noexcept
+	    -> node_union
+	{
+		std::atomic<node_union>& slot = (*sanitize_ptr(arraynode).arraynode_ptr)[position];
+		node_union node = slot.load(std::memory_order_acquire);
+		while (is_descriptor(node))
+		{
+			help_descriptor(slot, node);
+			node = slot.load(std::memory_order_acquire);
+		}
+
+		return node;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::help_descriptor(std::atomic<node_union>& slot,
+	                                                              node_union descriptor) noexcept
+	{
+		std::atomic<node_union>* where = &slot;
+		while (true)
+		{
+			mcas_t* desc = details::untag_descriptor(descriptor);
+			m_hazards.protect(1, reinterpret_cast<std::uintptr_t>(desc));
+
+			// Once released from the slot, the descriptor may have been freed by its owner.
+			if (where->load(std::memory_order_acquire).ptr_int != descriptor.ptr_int)
+			{
+				break;
+			}
+
+			std::atomic<node_union>* blocked = nullptr;
+			node_union blocker;
+			bool installed = install_descriptor(desc, blocked, blocker);
+			if (blocked == nullptr)
+			{
+				release_descriptor(desc, installed);
+				break;
+			}
+
+			// The operation holds a slot further in address order, it has to complete first. Following them
+			// ends since slots are installed in address order.
+			where = blocked;
+			descriptor = blocker;
+		}
+
+		m_hazards.clear(1);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::run_descriptor(mcas_t* desc) noexcept
+	{
+		while (true)
+		{
+			std::atomic<node_union>* blocked = nullptr;
+			node_union blocker;
+			bool installed = install_descriptor(desc, blocked, blocker);
+			if (blocked == nullptr)
+			{
+				release_descriptor(desc, installed);
+				return;
+			}
+
+			help_descriptor(*blocked, blocker);
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::install_descriptor(mcas_t* desc,
+	                                                                 std::atomic<node_union>*& blocked,
+	                                                                 node_union& blocker) noexcept
+	{
+		const node_union tagged = details::tag_descriptor(desc);
+		for (const auto& entry: desc->entries)
+		{
+			while (true)
+			{
+				// Checked after each install: a slot installed once the status is decided may have been missed by
+				// the threads releasing the descriptor, it is then released by the caller.
+				if (desc->status.load(std::memory_order_acquire) != details::mcas_status::undecided)
+				{
+					return false;
+				}
+
+				node_union current = entry.slot->load(std::memory_order_acquire);
+				if (current.ptr_int == tagged.ptr_int)
+				{
+					break;
+				}
+				if (is_descriptor(current))
+				{
+					blocked = entry.slot;
+					blocker = current;
+					return false;
+				}
+				if (current.ptr_int != entry.expected.ptr_int)
+				{
+					return false;
+				}
+
+				// The expected datanode may have been freed and its address reused since it was read, it is
+				// protected for its content to be checked, with a hazard of its own since readers help meanwhile.
+				m_hazards.protect(4, entry.expected.ptr_int);
+				if (entry.slot->load(std::memory_order_acquire).ptr_int != entry.expected.ptr_int)
+				{
+					m_hazards.clear(4);
+					continue;
+				}
+				bool same = entry.expected.datanode_ptr->hash == entry.hash
+				            && entry.expected.datanode_ptr->value == entry.value;
+				m_hazards.clear(4);
+				if (!same)
+				{
+					return false;
+				}
+
+				if (entry.slot->compare_exchange_strong(
+				        current, tagged, std::memory_order_release, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::release_descriptor(mcas_t* desc, bool installed) noexcept
+	{
+		details::mcas_status undecided = details::mcas_status::undecided;
+		desc->status.compare_exchange_strong(undecided,
+		                                     installed ? details::mcas_status::succeeded : details::mcas_status::failed,
+		                                     std::memory_order_acq_rel);
+
+		const bool succeeded = desc->status.load(std::memory_order_acquire) == details::mcas_status::succeeded;
+		for (const auto& entry: desc->entries)
+		{
+			node_union tagged = details::tag_descriptor(desc);
+			entry.slot->compare_exchange_strong(
+			    tagged, succeeded ? entry.desired : entry.expected, std::memory_order_release, std::memory_order_relaxed);
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::is_combinable_with(node_union current, hash_t fullhash) noexcept
+	{
+		if (is_array_node(current) || is_marked(current) || current.datanode_ptr == nullptr)
+		{
+			return false;
+		}
+
+		// Only updates publish their datanodes, and a datanode is unpublished before being freed:
+		// once watched, a datanode still published can be read.
+		std::atomic<node_union>& published = publication_of(fullhash);
+		if (published.load(std::memory_order_acquire).ptr_int != current.ptr_int)
+		{
+			return false;
+		}
+		watch_node(current);
+		bool combinable = published.load(std::memory_order_acquire).ptr_int == current.ptr_int
+		                  && current.datanode_ptr->hash == fullhash;
+		clear_watched_node();
+
+		return combinable;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::publication_of(hash_t fullhash) const noexcept
+	    -> std::atomic<node_union>&
+	{
+		return m_publications[static_cast<std::size_t>(fullhash & (nbr_publications - 1))].node;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::is_expired(node_union datanode) noexcept
+	{
+		if constexpr (details::expiry_traits<value_t>::enabled)
+		{
+			return details::expiry_traits<value_t>::is_expired(datanode.datanode_ptr->value);
+		}
+		else
+		{
+			static_cast<void>(datanode);
+			return false;
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	bool unordered_map<Key, Value, HashFunction>::replace_expired(node_union arraynode,
+	                                                              std::size_t position,
+	                                                              node_union expired,
+	                                                              node_union replacement)
+	{
+		if (!(*sanitize_ptr(arraynode).arraynode_ptr)[position].compare_exchange_strong(
+		        expired, replacement, std::memory_order_release, std::memory_order_relaxed))
+		{
+			return false;
+		}
+
+		if (replacement.datanode_ptr == nullptr)
+		{
+			m_size.fetch_sub(1, std::memory_order_relaxed);
+		}
+		record_change(change_type::remove, expired.datanode_ptr->key, expired.datanode_ptr->value);
+		safe_delete(expired);
+
+		return true;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::purge_expired_slot(node_union arraynode,
+	                                                                        std::size_t position,
+	                                                                        std::size_t depth)
+	{
+		node_union node = read_slot_protected(arraynode, position, depth);
+
+		std::size_t purged = 0;
+		if (is_array_node(node))
+		{
+			for (std::size_t i = 0, n = sanitize_ptr(node).arraynode_ptr->size(); i < n; ++i)
+			{
+				purged += purge_expired_slot(node, i, depth + 1);
+			}
+		}
+		else if (node.datanode_ptr != nullptr)
+		{
+			assert(!is_compact_node(node) && "Maps with expiring values have no compact arraynodes");
+
+			// The datanode is removed from the slot it was read from, without walking down from the head again.
+			if (is_expired(node) && replace_expired(arraynode, position, node, node_union{static_cast<node_t*>(nullptr)}))
+			{
+				++purged;
+			}
+			clear_watched_node();
+		}
+
+		return purged;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Predicate>
+	std::size_t unordered_map<Key, Value, HashFunction>::erase_buckets_if(Predicate& pred,
+	                                                                      std::size_t first,
+	                                                                      std::size_t last)
+	{
+		node_union head{&m_head};
+		mark_arraynode(head);
+
+		std::vector<node_union> removed;
+		removed.reserve(erase_batch_size);
+		std::size_t erased = 0;
+		details::for_each_occupied_slot(m_head, first, last, [this, &head, &pred, &removed, &erased](std::size_t i) {
+			erased += erase_slot_if(head, i, 0, pred, removed);
+		});
+		reclaim_removed(removed);
+
+		return erased;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Predicate>
+	std::size_t unordered_map<Key, Value, HashFunction>::erase_slot_if(node_union arraynode,
+	                                                                   std::size_t position,
+	                                                                   std::size_t depth,
+	                                                                   Predicate& pred,
+	                                                                   std::vector<node_union>& removed)
+	{
+		node_union node = read_slot_protected(arraynode, position, depth);
+
+		if (is_compact_node(node))
+		{
+			// A compact arraynode holding a matching datanode is promoted, instead of being copied for each removal.
+			bool matching = false;
+			visit_compact_node(
+			    arraynode,
+			    position,
+			    depth,
+			    node,
+			    [&pred, &matching](node_union datanode) {
+				    matching = std::invoke(pred,
+				                           std::as_const(datanode.datanode_ptr->key),
+				                           std::as_const(datanode.datanode_ptr->value));
+				    return !matching;
+			    },
+			    [&matching](node_union, std::size_t) {
+				    // Called once the compact arraynode was promoted, whose full arraynode is then walked.
+				    matching = true;
+				    return false;
+			    });
+			if (!matching)
+			{
+				return 0;
+			}
+			node = promote_compact_node(arraynode, position, depth);
+		}
+
+		std::size_t erased = 0;
+		if (is_array_node(node))
+		{
+			const arraynode_t& array = *sanitize_ptr(node).arraynode_ptr;
+			details::for_each_occupied_slot(array, 0, array.size(), [&](std::size_t i) {
+				erased += erase_slot_if(node, i, depth + 1, pred, removed);
+			});
+		}
+		else if (node.datanode_ptr != nullptr)
+		{
+			std::atomic<node_union>& slot = (*sanitize_ptr(arraynode).arraynode_ptr)[position];
+			node_union current = node;
+			bool matching =
+			    std::invoke(pred, std::as_const(node.datanode_ptr->key), std::as_const(node.datanode_ptr->value));
+			if (matching
+			    && slot.compare_exchange_strong(
+			        current, node_union{static_cast<node_t*>(nullptr)}, std::memory_order_release, std::memory_order_relaxed))
+			{
+				m_size.fetch_sub(1, std::memory_order_relaxed);
+				record_change(change_type::remove, node.datanode_ptr->key, node.datanode_ptr->value);
+				removed.push_back(node);
+				++erased;
+			}
+			clear_watched_node();
+
+			// A datanode marked or expanded meanwhile was moved down rather than modified, so it is looked for again.
+			node_union marked = node;
+			mark_datanode(marked);
+			if (matching && current.ptr_int != node.ptr_int
+			    && (current.ptr_int == marked.ptr_int || is_array_node(current) || is_compact_node(current)))
+			{
+				erased += erase_slot_if(arraynode, position, depth, pred, removed);
+			}
+			else if (removed.size() >= erase_batch_size)
+			{
+				reclaim_removed(removed);
+			}
+		}
+
+		return erased;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::reclaim_removed(std::vector<node_union>& removed)
+	{
+		std::vector<std::uintptr_t> hazards = m_hazards.protected_by_others();
+		auto watched = [&hazards](node_union node) {
+			return std::binary_search(hazards.begin(), hazards.end(), node.ptr_int);
+		};
+		auto unwatched = std::partition(removed.begin(), removed.end(), watched);
+
+		// Unpublished once no thread watches them, then scanned again, @see safe_delete
+		if (m_publications)
+		{
+			for (auto it = unwatched; it != removed.end(); ++it)
+			{
+				node_union published = *it;
+				publication_of(it->datanode_ptr->hash)
+				    .compare_exchange_strong(
+				        published, node_union{}, std::memory_order_acq_rel, std::memory_order_acquire);
+			}
+			hazards = m_hazards.protected_by_others();
+			unwatched = std::partition(unwatched, removed.end(), watched);
+		}
+
+		for (auto it = removed.begin(); it != unwatched; ++it)
+		{
+			safe_delete(*it);
+		}
+		for (auto it = unwatched; it != removed.end(); ++it)
+		{
+			deallocate_node(*it);
+		}
+		removed.clear();
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename VisitorFun>
+	void unordered_map<Key, Value, HashFunction>::visit_array_node(node_union node, VisitorFun&& fun) noexcept(
+	    noexcept(std::is_nothrow_invocable_v<VisitorFun, std::pair<key_t, value_t>>))
+	{
+		// Empty slots, the most common ones in sparse arraynodes, are skipped by blocks.
+		const arraynode_t& array = *sanitize_ptr(node).arraynode_ptr;
+		details::for_each_occupied_slot(array, 0, array.size(), [this, &node, &fun](std::size_t i) {
+			node_union child = get_node(node, i);
+			if (child.datanode_ptr != nullptr)
+			{
+				if (is_array_node(child))
+				{
+					visit_array_node(child, fun);
+				}
+				else if (is_compact_node(child))
+				{
+					untag_compact_node(child)->for_each([&fun](std::size_t, node_t* datanode) {
+						std::invoke(fun, std::pair<key_t, value_t>(datanode->key, datanode->value));
+					});
+				}
+				else
+				{
+					std::invoke(fun, std::pair<key_t, value_t>(child.datanode_ptr->key, child.datanode_ptr->value));
+				}
+			}
+		});
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::collect_structure(const arraynode_t& array,
+	                                                                std::size_t depth,
+	                                                                structure_report& report)
+	{
+		std::size_t used_slots = collect_slots(array, 0, array.size(), depth, report);
+
+		level_report& level = level_of(report, depth);
+		++level.arraynodes;
+		++level.occupancy[used_slots * (level_report::occupancy_buckets - 1) / array.size()];
+		++report.arraynodes;
+		report.bytes += sizeof(arraynode_t);
+		if (used_slots == 0)
+		{
+			++report.empty_arraynodes;
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::collect_compact_structure(const compact_node_t& compact,
+	                                                                        std::size_t depth,
+	                                                                        structure_report& report) const
+	{
+		// Each datanode has its own slot, the positions left out take no memory.
+		std::size_t size = compact.size();
+
+		level_report& level = level_of(report, depth);
+		++level.arraynodes;
+		level.slots += size;
+		level.datanodes += size;
+		++level.occupancy[(size * (level_report::occupancy_buckets - 1)) >> m_levels[depth]];
+		++report.arraynodes;
+		++report.compact_arraynodes;
+		report.slots += size;
+		report.datanodes += size;
+		report.total_depth += size * depth;
+		report.bytes += sizeof(compact_node_t) + size * (sizeof(node_t*) + sizeof(node_t));
+		if (size == 0)
+		{
+			++report.empty_arraynodes;
+		}
+		else
+		{
+			report.max_depth = std::max(report.max_depth, depth);
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	std::size_t unordered_map<Key, Value, HashFunction>::collect_slots(const arraynode_t& array,
+	                                                                   std::size_t first,
+	                                                                   std::size_t last,
+	                                                                   std::size_t depth,
+	                                                                   structure_report& report)
+	{
+		// Levels may be added while walking the children, so they are looked up again for every slot.
+		std::size_t used_slots = 0;
+		level_of(report, depth).slots += last - first;
+		report.slots += last - first;
+		report.bytes += (last - first) * sizeof(typename arraynode_t::value_t);
+
+		// Only the occupied slots are visited, the others are counted as empty at the end.
+		details::for_each_occupied_slot(array, first, last, [this, &array, depth, &report, &used_slots](std::size_t i) {
+			node_union node = array[i].load(std::memory_order_acquire);
+			// Compact arraynodes are replaced on every change and freed once no thread protects them.
+			while (is_compact_node(node))
+			{
+				m_hazards.protect(2, reinterpret_cast<std::uintptr_t>(untag_compact_node(node)));
+				node_union current = array[i].load(std::memory_order_acquire);
+				if (current.ptr_int == node.ptr_int)
+				{
+					break;
+				}
+				m_hazards.clear(2);
+				node = current;
+			}
+
+			if (is_array_node(node))
+			{
+				++used_slots;
+				collect_structure(*sanitize_ptr(node).arraynode_ptr, depth + 1, report);
+			}
+			else if (is_compact_node(node))
+			{
+				++used_slots;
+				collect_compact_structure(*untag_compact_node(node), depth + 1, report);
+				m_hazards.clear(2);
+			}
+			else if (node.datanode_ptr != nullptr)
+			{
+				++used_slots;
+				++level_of(report, depth).datanodes;
+				++report.datanodes;
+				report.total_depth += depth;
+				report.max_depth = std::max(report.max_depth, depth);
+				report.bytes += sizeof(node_t);
+				if (is_marked(node))
+				{
+					++report.marked_slots;
+				}
+			}
+		});
+
+		level_of(report, depth).empty_slots += last - first - used_slots;
+		report.empty_slots += last - first - used_slots;
+
+		return used_slots;
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	level_report& unordered_map<Key, Value, HashFunction>::level_of(structure_report& report, std::size_t depth)
+	{
+		if (report.levels.size() <= depth)
+		{
+			report.levels.resize(depth + 1, level_report{0, 0, 0, 0, {}});
+		}
+
+		return report.levels[depth];
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::merge_structure(structure_report& report,
+	                                                              const structure_report& other)
+	{
+		report.arraynodes += other.arraynodes;
+		report.datanodes += other.datanodes;
+		report.slots += other.slots;
+		report.empty_slots += other.empty_slots;
+		report.total_depth += other.total_depth;
+		report.max_depth = std::max(report.max_depth, other.max_depth);
+		report.bytes += other.bytes;
+		report.marked_slots += other.marked_slots;
+		report.empty_arraynodes += other.empty_arraynodes;
+		report.compact_arraynodes += other.compact_arraynodes;
+
+		for (std::size_t depth = 0; depth < other.levels.size(); ++depth)
+		{
+			level_report& level = level_of(report, depth);
+			const level_report& other_level = other.levels[depth];
+			level.arraynodes += other_level.arraynodes;
+			level.slots += other_level.slots;
+			level.empty_slots += other_level.empty_slots;
+			level.datanodes += other_level.datanodes;
+			for (std::size_t i = 0; i < level_report::occupancy_buckets; ++i)
+			{
+				level.occupancy[i] += other_level.occupancy[i];
+			}
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename VisitorFun>
+	void unordered_map<Key, Value, HashFunction>::visit_slot_protected(node_union arraynode,
+	                                                                   std::size_t position,
+	                                                                   std::size_t depth,
+	                                                                   VisitorFun&& fun)
+	{
+		node_union node = read_slot_protected(arraynode, position, depth);
+
+		if (is_array_node(node))
+		{
+			// Arraynodes are never freed while the map is alive, only datanodes need protection.
+			const arraynode_t& array = *sanitize_ptr(node).arraynode_ptr;
+			details::for_each_occupied_slot(array, 0, array.size(), [this, &node, depth, &fun](std::size_t i) {
+				visit_slot_protected(node, i, depth + 1, fun);
+			});
+		}
+		else if (is_compact_node(node))
+		{
+			visit_compact_node(
+			    arraynode,
+			    position,
+			    depth,
+			    node,
+			    [&fun](node_union datanode) {
+				    std::invoke(fun, std::as_const(datanode.datanode_ptr->key), std::as_const(datanode.datanode_ptr->value));
+				    return true;
+			    },
+			    [this, depth, &fun](node_union array_node, std::size_t next) {
+				    const arraynode_t& array = *sanitize_ptr(array_node).arraynode_ptr;
+				    details::for_each_occupied_slot(array, next, array.size(), [this, &array_node, depth, &fun](std::size_t i) {
+					    visit_slot_protected(array_node, i, depth + 1, fun);
+				    });
+				    return true;
+			    });
+		}
+		else if (node.datanode_ptr != nullptr)
+		{
+			std::invoke(fun, std::as_const(node.datanode_ptr->key), std::as_const(node.datanode_ptr->value));
+			clear_watched_node();
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	auto unordered_map<Key, Value, HashFunction>::read_slot_protected(node_union arraynode,
+	                                                                  std::size_t position,
+	                                                                  std::size_t depth) -> node_union
+	{
+		node_union node = load_slot(arraynode, position);
+
+		while (true)
+		{
+			if (is_array_node(node) || is_compact_node(node))
+			{
+				return node;
+			}
+
+			node_union data = node;
+			unmark_datanode(data);
+			if (data.datanode_ptr == nullptr)
+			{
+				return data;
+			}
+
+			if (is_marked(node))
+			{
+				node = expand_node(arraynode, position, depth);
+				clear_watched_node();
+				continue;
+			}
+
+			watch_node(node);
+			node_union current = load_slot(arraynode, position);
+			if (current.ptr_int == node.ptr_int)
+			{
+				return node;
+			}
+
+			node = current;
+		}
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	template <typename Fun>
+	bool unordered_map<Key, Value, HashFunction>::visit_ordered(
+	    node_union arraynode, std::size_t depth, hash_t first, hash_t lo, hash_t hi, Fun&& fun)
+	{
+		const std::size_t shift = m_shifts[depth];
+		const hash_t span_mask = static_cast<hash_t>((hash_t{1} << shift) - 1);
+
+		for (std::size_t i = 0, n = sanitize_ptr(arraynode).arraynode_ptr->size(); i < n; ++i)
+		{
+			// Hashes stored below this slot are in [slot_first, slot_first | span_mask].
+			auto slot_first = static_cast<hash_t>(first | static_cast<hash_t>(static_cast<hash_t>(i) << shift));
+			if (static_cast<hash_t>(slot_first | span_mask) < lo)
+			{
+				continue;
+			}
+			if (slot_first > hi)
+			{
+				break;
+			}
+
+			node_union node = read_slot_protected(arraynode, i, depth);
+			if (is_array_node(node))
+			{
+				if (!visit_ordered(node, depth + 1, slot_first, lo, hi, fun))
+				{
+					return false;
+				}
+			}
+			else if (is_compact_node(node))
+			{
+				bool keep_going = visit_compact_node(
+				    arraynode,
+				    i,
+				    depth,
+				    node,
+				    [lo, hi, &fun](node_union datanode) {
+					    hash_t hash = datanode.datanode_ptr->hash;
+					    return !(lo <= hash && hash <= hi)
+					           || std::invoke(
+					               fun, std::pair<key_t, value_t>(datanode.datanode_ptr->key, datanode.datanode_ptr->value));
+				    },
+				    [this, depth, slot_first, lo, hi, &fun](node_union array_node, std::size_t next) {
+					    if (next == sanitize_ptr(array_node).arraynode_ptr->size())
+					    {
+						    return true;
+					    }
+
+					    // The hashes of the positions before next were visited in the compact arraynode.
+					    auto resume_from = static_cast<hash_t>(
+					        slot_first | static_cast<hash_t>(static_cast<hash_t>(next) << m_shifts[depth + 1]));
+					    return visit_ordered(array_node, depth + 1, slot_first, std::max(lo, resume_from), hi, fun);
+				    });
+
+				if (!keep_going)
+				{
+					return false;
+				}
+			}
+			else if (node.datanode_ptr != nullptr)
 			{
-				if (is_array_node(node))
+				hash_t hash = node.datanode_ptr->hash;
+				bool keep_going = true;
+				if (lo <= hash && hash <= hi)
 				{
-					visit_array_node(node, fun);
+					keep_going = std::invoke(fun, std::pair<key_t, value_t>(node.datanode_ptr->key, node.datanode_ptr->value));
 				}
-				else
+				clear_watched_node();
+
+				if (!keep_going)
 				{
-					std::invoke(fun, std::pair<key_t, value_t>(node.datanode_ptr->key, node.datanode_ptr->value));
+					return false;
 				}
 			}
 		}
-	}
 
-	template <typename Key, typename Value, typename HashFunction>
-	std::size_t unordered_map<Key, Value, HashFunction>::size() const noexcept
-	{
-		return m_size;
-	}
-
-	template <typename Key, typename Value, typename HashFunction>
-	bool unordered_map<Key, Value, HashFunction>::is_empty() const noexcept
-	{
-		return size() == 0;
+		return true;
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	auto unordered_map<Key, Value, HashFunction>::allocate_node(hash_t hash, key_t key, value_t value) const
-	    -> node_union
+	void unordered_map<Key, Value, HashFunction>::ensure_ordered() const
 	{
-		if (alignof(node_t*) < 4)
-		{
-			return node_union{new (std::align_val_t{8}) node_t{hash, key, value}};
-		}
-		else
+		if (m_schedule.order() != bit_order::msb_first)
 		{
-			return node_union{new node_t{hash, key, value}};
+			throw std::runtime_error("Range queries need a map ordered with bit_order::msb_first");
 		}
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	auto unordered_map<Key, Value, HashFunction>::expand_node(node_union arraynode,
-	                                                          std::size_t position,
-	                                                          std::size_t level) noexcept -> node_union
+	bool unordered_map<Key, Value, HashFunction>::build_insert(hash_t fullhash, const key_t& key, const value_t& value)
 	{
-		std::atomic<node_union>& node_atomic = (*sanitize_ptr(arraynode).arraynode_ptr)[position];
-		node_union old_value = node_atomic.load();
+		std::size_t position;
+		node_union local{&m_head};
+		mark_arraynode(local);
 
-		watch_node(old_value);
+		hash_t hash = fullhash;
 
-		if (is_array_node(old_value))
+		for (std::size_t depth = 0; depth + 1 < m_levels.size(); ++depth)
 		{
-			return old_value;
-		}
-		node_union value = node_atomic.load();
+			std::tie(position, hash) = compute_pos_and_hash(hash, depth);
+			std::atomic<node_union>& slot = (*sanitize_ptr(local).arraynode_ptr)[position];
+			node_union node = slot.load(std::memory_order_relaxed);
 
-		if (value.ptr_int != old_value.ptr_int)
-		{
-			return value;
-		}
+			if (node.datanode_ptr == nullptr)
+			{
+				slot.store(allocate_node(fullhash, key, value), std::memory_order_release);
+				return true;
+			}
 
-		if (value.datanode_ptr != nullptr)
-		{
-			node_union array_node;
+			if (is_array_node(node))
+			{
+				local = node;
+				continue;
+			}
 
-			if (alignof(arraynode_t*) < 4)
+			// Nothing else reads the map while it is built, replaced nodes are freed right away.
+			if (is_compact_node(node))
 			{
-				array_node = node_union{new (std::align_val_t{8}) arraynode_t{m_arrayLength}};
+				compact_node_t* compact = untag_compact_node(node);
+				std::size_t child_position = next_position(fullhash, depth);
+				if (compact->contains(child_position) && (*compact)[compact->index_of(child_position)]->hash == fullhash)
+				{
+					return false;
+				}
+
+				if (!compact->contains(child_position) && compact->size() < compact_capacity(depth))
+				{
+					slot.store(tag_compact_node(make_compact_copy(*compact, child_position, allocate_node(fullhash, key, value))),
+					           std::memory_order_release);
+					compact_node_t::destroy(compact);
+					return true;
+				}
+
+				node_union array_node = make_promoted_arraynode(*compact, depth);
+				slot.store(array_node, std::memory_order_release);
+				compact_node_t::destroy(compact);
+				local = array_node;
+				continue;
 			}
-			else
+
+			unmark_datanode(node);
+			if (node.datanode_ptr->hash == fullhash)
 			{
-				array_node = node_union{new arraynode_t{m_arrayLength}};
+				return false;
 			}
 
-			std::size_t new_pos = value.datanode_ptr->hash >> (m_arrayLength + level) & (m_arrayLength - 1);
-			unmark_datanode(value);
+			if (compact_capacity(depth) != 0
+			    && next_position(node.datanode_ptr->hash, depth) != next_position(fullhash, depth))
+			{
+				slot.store(tag_compact_node(make_compact_pair(depth, node, allocate_node(fullhash, key, value))),
+				           std::memory_order_release);
+				return true;
+			}
 
-			(*array_node.arraynode_ptr)[new_pos] = value;
+			node_union array_node = allocate_arraynode(fullhash, depth + 1);
+			std::size_t new_pos = next_position(node.datanode_ptr->hash, depth);
+			(*array_node.arraynode_ptr)[new_pos].store(node, std::memory_order_relaxed);
 			mark_arraynode(array_node);
 
-			if (!node_atomic.compare_exchange_weak(old_value, array_node))
-			{
-				array_node = sanitize_ptr(array_node);
-				(*array_node.arraynode_ptr)[new_pos] = node_union{};
-				delete array_node.arraynode_ptr;
-			}
+			slot.store(array_node, std::memory_order_release);
+			local = array_node;
+		}
+
+		std::tie(position, std::ignore) = compute_pos_and_hash(hash, m_levels.size() - 1);
+		std::atomic<node_union>& slot = (*sanitize_ptr(local).arraynode_ptr)[position];
+		if (slot.load(std::memory_order_relaxed).datanode_ptr != nullptr)
+		{
+			return false;
 		}
 
-		return node_atomic.load();
+		slot.store(allocate_node(fullhash, key, value), std::memory_order_release);
+		return true;
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	bool unordered_map<Key, Value, HashFunction>::try_node_insertion(node_union arraynode,
-	                                                                 std::size_t position,
-	                                                                 node_union& datanode)
+	std::size_t unordered_map<Key, Value, HashFunction>::build_chunks(const details::snapshot::chunk_view* first,
+	                                                                  const details::snapshot::chunk_view* last,
+	                                                                  bool check_buckets)
 	{
-		node_union null{static_cast<node_t*>(nullptr)};
+		std::size_t inserted = 0;
+		for (; first != last; ++first)
+		{
+			const char* record = first->records;
+			for (std::uint64_t i = 0; i < first->count; ++i)
+			{
+				key_t key;
+				value_t value;
+				std::memcpy(&key, record, sizeof(key_t));
+				std::memcpy(&value, record + sizeof(key_t), sizeof(value_t));
+				record += sizeof(key_t) + sizeof(value_t);
 
-		arraynode_t& array = (*sanitize_ptr(arraynode).arraynode_ptr);
+				hash_t fullhash = HashFunction{}(key);
+				// Another worker may be building the bucket of a misplaced record.
+				if (check_buckets && std::get<0>(compute_pos_and_hash(fullhash, 0)) != first->bucket)
+				{
+					throw std::runtime_error("Corrupted snapshot");
+				}
 
-		if (array[position].compare_exchange_weak(null, datanode))
-		{
-			datanode = array[position].load();
-			++m_size;
-			return true;
+				if (build_insert(fullhash, key, value))
+				{
+					++inserted;
+				}
+			}
 		}
 
-		delete datanode.datanode_ptr;
-		datanode = array[position].load();
-
-		return false;
+		return inserted;
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	template <typename Fun>
-	operation_result unordered_map<Key, Value, HashFunction>::update_impl(const Key& key,
-	                                                                      const Value& value,
-	                                                                      Fun&& compare_expected_value)
+	std::size_t unordered_map<Key, Value, HashFunction>::merge_buckets(unordered_map& other,
+	                                                                   std::size_t first,
+	                                                                   std::size_t last,
+	                                                                   bool splice)
 	{
-		return update_or_remove_impl(key, compare_expected_value, [&value, &key, this](hash_t fullhash) {
-			return this->allocate_node(fullhash, key, value);
-		});
-	}
+		node_union head{&m_head};
+		mark_arraynode(head);
 
-	template <typename Key, typename Value, typename HashFunction>
-	template <typename Fun>
-	operation_result unordered_map<Key, Value, HashFunction>::remove_impl(const Key& key, Fun&& compare_expected_value)
-	{
-		return update_or_remove_impl(key, compare_expected_value, [](hash_t) { return node_union{}; });
+		std::size_t merged = 0;
+		for (std::size_t i = first; i < last; ++i)
+		{
+			// No other thread uses other, its buckets are emptied one by one.
+			node_union moved = other.m_head[i].load(std::memory_order_relaxed);
+			if (moved.datanode_ptr == nullptr)
+			{
+				continue;
+			}
+			other.m_head[i].store(node_union{static_cast<node_t*>(nullptr)}, std::memory_order_relaxed);
+
+			if (splice)
+			{
+				merged += merge_subtree(head, i, 0, moved);
+			}
+			else
+			{
+				for_each_datanode(moved, [this, &merged](node_t* datanode) {
+					if (!is_expired(node_union{datanode}) && insert(datanode->key, datanode->value) == operation_result::success)
+					{
+						++merged;
+					}
+				});
+				other.destroy_subtree(moved);
+			}
+		}
+
+		return merged;
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	template <typename CmpFun, typename AllocFun>
-	operation_result unordered_map<Key, Value, HashFunction>::update_or_remove_impl(const Key& key,
-	                                                                                CmpFun&& compare_expected_value,
-	                                                                                AllocFun&& replacing_node)
+	std::size_t unordered_map<Key, Value, HashFunction>::merge_subtree(node_union arraynode,
+	                                                                   std::size_t position,
+	                                                                   std::size_t depth,
+	                                                                   node_union moved)
 	{
-		std::size_t array_pow = log2_of_power_of_two(m_arrayLength);
-
-		std::size_t position;
-		node_union local{&m_head};
-		mark_arraynode(local);
-
-		hash_t fullhash = HashFunction{}(key);
-		hash_t hash = fullhash;
-
-		for (std::size_t r = 0; r < hash_size_in_bits - array_pow; r += array_pow)
+		if (!is_array_node(moved) && !is_compact_node(moved))
 		{
-			std::tie(position, hash) = compute_pos_and_hash(array_pow, hash, r);
-			node_union node = get_node(local, position);
-
-			if (is_array_node(node))
+			unmark_datanode(moved);
+			if (is_expired(moved))
 			{
-				local = node;
+				deallocate_node(moved);
+				return 0;
 			}
-			else if (is_marked(node))
+
+			// The datanode may be removed by another thread as soon as it is inserted: the change is recorded from a
+			// copy, and otherwise its key and value aren't read anymore.
+			operation_result result;
+			node_t& datanode = *moved.datanode_ptr;
+			if (m_change_log)
 			{
-				local = expand_node(local, position, r);
+				key_t key = datanode.key;
+				value_t value = datanode.value;
+				result = insert_node(datanode.hash, key, value, moved);
 			}
-			else if (node.datanode_ptr == nullptr)
+			else
 			{
-				clear_watched_node();
-				return operation_result::element_not_found;
+				result = insert_node(datanode.hash, datanode.key, datanode.value, moved);
 			}
-			else
+
+			if (moved.datanode_ptr != nullptr)
 			{
-				watch_node(node);
-				if (node.ptr_int != get_node(local, position).ptr_int)
-				{
-					ensure_not_replaced(local, position, r, node);
+				deallocate_node(moved);
+			}
+			return result == operation_result::success ? 1 : 0;
+		}
 
-					if (is_array_node(node))
-					{
-						local = node;
-						continue;
-					}
-					else if (is_marked(node))
-					{
-						local = expand_node(local, position, r);
-						continue;
-					}
-					else if (node.datanode_ptr == nullptr)
-					{
-						clear_watched_node();
-						return operation_result::element_not_found;
-					}
-				}
+		// Once published, the datanodes of the subtree may be modified, so they are counted beforehand.
+		std::size_t count = 0;
+		std::vector<std::pair<key_t, value_t>> changes;
+		for_each_datanode(moved, [this, &count, &changes](node_t* datanode) {
+			++count;
+			if (m_change_log)
+			{
+				changes.emplace_back(datanode->key, datanode->value);
+			}
+		});
 
-				if (node.datanode_ptr->hash == fullhash)
+		std::atomic<node_union>& slot = (*sanitize_ptr(arraynode).arraynode_ptr)[position];
+		node_union node = load_slot(arraynode, position);
+		while (!is_array_node(node))
+		{
+			if (node.datanode_ptr == nullptr)
+			{
+				node_union null{static_cast<node_t*>(nullptr)};
+				if (slot.compare_exchange_strong(null, moved, std::memory_order_release, std::memory_order_relaxed))
 				{
-					if (!compare_expected_value(node.datanode_ptr))
+					m_size.fetch_add(count, std::memory_order_relaxed);
+					for (const std::pair<key_t, value_t>& change: changes)
 					{
-						clear_watched_node();
-						return operation_result::expected_value_mismatch;
+						record_change(change_type::insert, change.first, change.second);
 					}
+					return count;
+				}
 
-					node_union new_node = replacing_node(fullhash);
-					if ((*sanitize_ptr(local).arraynode_ptr)[position].compare_exchange_weak(node, new_node))
-					{
-						safe_delete(node);
-						//delete node.datanode_ptr;
+				node = load_slot(arraynode, position);
+				continue;
+			}
 
-						clear_watched_node();
-						return operation_result::success;
-					}
-					else
-					{
-						delete new_node.datanode_ptr;
+			// The datanode or the compact arraynode of this map goes one level below, where both are merged.
+			node = expand_node(arraynode, position, depth);
+		}
+		clear_watched_node();
 
-						node = get_node(local, position);
-						if (is_array_node(node))
-						{
-							local = node;
-						}
-						else if (is_marked(node))
-						{
-							local = expand_node(local, position, r);
-						}
-						else
-						{
-							clear_watched_node();
-							return operation_result::element_not_found;
-						}
-					}
-				}
-				else
-				{
-					clear_watched_node();
-					return operation_result::element_not_found;
-				}
-			}
+		std::size_t merged = 0;
+		if (is_compact_node(moved))
+		{
+			compact_node_t* compact = untag_compact_node(moved);
+			compact->for_each([this, &node, depth, &merged](std::size_t child_position, node_t* datanode) {
+				merged += merge_subtree(node, child_position, depth + 1, node_union{datanode});
+			});
+			compact_node_t::destroy(compact);
+		}
+		else
+		{
+			const arraynode_t& array = *sanitize_ptr(moved).arraynode_ptr;
+			details::for_each_occupied_slot(array, 0, array.size(), [this, &array, &node, depth, &merged](std::size_t i) {
+				merged += merge_subtree(node, i, depth + 1, array[i].load(std::memory_order_relaxed));
+			});
+			deallocate_arraynode(moved);
 		}
 
-		clear_watched_node();
-		return operation_result::element_not_found;
+		return merged;
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	void unordered_map<Key, Value, HashFunction>::ensure_not_replaced(node_union& local,
-	                                                                  size_t position,
-	                                                                  size_t r,
-	                                                                  node_union& node)
+	template <typename Fun>
+	void unordered_map<Key, Value, HashFunction>::for_each_datanode(node_union node, Fun&& fun)
 	{
-		std::size_t fail_count = 0;
-		do
+		if (is_array_node(node))
 		{
-			node = get_node(local, position);
-			watch_node(node);
-			++fail_count;
-
-			if (fail_count > m_max_fail_count)
+			const arraynode_t& array = *sanitize_ptr(node).arraynode_ptr;
+			details::for_each_occupied_slot(array, 0, array.size(), [&array, &fun](std::size_t i) {
+				for_each_datanode(array[i].load(std::memory_order_relaxed), fun);
+			});
+		}
+		else if (is_compact_node(node))
+		{
+			untag_compact_node(node)->for_each([&fun](std::size_t, node_t* datanode) { std::invoke(fun, datanode); });
+		}
+		else
+		{
+			unmark_datanode(node);
+			if (node.datanode_ptr != nullptr)
 			{
-				mark_datanode(node);
-				local = expand_node(local, position, r);
-				break;
+				std::invoke(fun, node.datanode_ptr);
 			}
-		} while (node.ptr_int != get_node(local, position).ptr_int);
+		}
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	template <typename VisitorFun>
-	void unordered_map<Key, Value, HashFunction>::visit_array_node(node_union node, VisitorFun&& fun) noexcept(
-	    noexcept(std::is_nothrow_invocable_v<VisitorFun, std::pair<key_t, value_t>>))
+	auto unordered_map<Key, Value, HashFunction>::compute_pos_and_hash(hash_t lasthash, std::size_t depth) const
+	    -> std::tuple<std::size_t, hash_t>
 	{
-		for (std::size_t i = 0; i < m_arrayLength; ++i)
+		std::size_t bits = m_levels[depth];
+		std::size_t position;
+
+		if constexpr (std::numeric_limits<hash_t>::is_integer && !std::numeric_limits<hash_t>::is_signed)
 		{
-			node_union child = get_node(node, i);
-			if (child.datanode_ptr != nullptr)
+			if (m_schedule.order() == bit_order::msb_first)
 			{
-				if (is_array_node(child))
-				{
-					visit_array_node(child, fun);
-				}
-				else
-				{
-					std::invoke(fun, std::pair<key_t, value_t>(child.datanode_ptr->key, child.datanode_ptr->value));
-				}
+				position = (lasthash >> (hash_size_in_bits - bits)) & ((std::size_t{1} << bits) - 1);
+				lasthash = bits < hash_size_in_bits ? static_cast<hash_t>(lasthash << bits) : hash_t{0};
+
+				return {position, lasthash};
 			}
 		}
+
+		if constexpr (std::is_integral_v<hash_t>)
+		{
+			// Signed hashes are split as their unsigned representation, which has the same low bits.
+			auto bits_of_hash = static_cast<std::make_unsigned_t<hash_t>>(lasthash);
+			position = bits_of_hash & ((std::size_t{1} << bits) - 1);
+			lasthash = static_cast<hash_t>(bits_of_hash >> bits);
+		}
+		else
+		{
+			position = lasthash & ((std::size_t{1} << bits) - 1);
+			lasthash >>= bits;
+		}
+
+		return {position, lasthash};
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
-	auto unordered_map<Key, Value, HashFunction>::compute_pos_and_hash(size_t array_pow,
-	                                                                   hash_t lasthash,
-	                                                                   size_t level) const
-	    -> std::tuple<std::size_t, hash_t>
+	std::size_t unordered_map<Key, Value, HashFunction>::next_position(hash_t fullhash, std::size_t depth) const
 	{
-		size_t position;
-
-		if (level == 0)
+		if constexpr (std::is_integral_v<hash_t>)
 		{
-			position = lasthash & (m_head_size - 1);
-			lasthash >>= m_arrayLength;
+			auto bits_of_hash = static_cast<std::make_unsigned_t<hash_t>>(fullhash);
+			return bits_of_hash >> m_shifts[depth + 1] & ((std::size_t{1} << m_levels[depth + 1]) - 1);
 		}
 		else
 		{
-			position = lasthash & (m_arrayLength - 1);
-			lasthash >>= array_pow;
+			return fullhash >> m_shifts[depth + 1] & ((std::size_t{1} << m_levels[depth + 1]) - 1);
 		}
+	}
 
-		return {position, lasthash};
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::record_change(change_type type,
+	                                                            const key_t& key,
+	                                                            const value_t& value)
+	{
+		if (m_change_log)
+		{
+			m_change_log->push(details::get_thread_id(), type, key, value);
+		}
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
 	void unordered_map<Key, Value, HashFunction>::safe_delete(node_union node_to_free)
 	{
-		bool freeable;
+		// Removed datanodes are freed right away, once the threads reading them are done.
+		m_hazards.wait_until_unprotected(node_to_free.ptr_int);
 
-		do
+		// Unpublished once no thread watches it anymore, in particular not the update still publishing it.
+		// A combining update may have read the publication before it changed and watched the datanode since,
+		// so the hazards are scanned again, the fence of the scan ordering them after the publication.
+		if (m_publications)
 		{
-			freeable = true;
-			for (std::ptrdiff_t i = 0; i < m_max_nbr_threads; ++i)
-			{
-				if (static_cast<std::uintptr_t>(i) == details::get_thread_id())
-				{
-					continue;
-				}
-				else if (m_watched_nodes[i] == node_to_free.ptr_int)
-				{
-					freeable = false;
-					break;
-				}
-			}
+			node_union published = node_to_free;
+			publication_of(node_to_free.datanode_ptr->hash)
+			    .compare_exchange_strong(published, node_union{}, std::memory_order_acq_rel, std::memory_order_acquire);
+			m_hazards.wait_until_unprotected(node_to_free.ptr_int);
+		}
 
-			if (freeable)
-			{
-				delete node_to_free.datanode_ptr;
-			}
-		} while (!freeable);
+		deallocate_node(node_to_free);
+	}
+
+	template <typename Key, typename Value, typename HashFunction>
+	void unordered_map<Key, Value, HashFunction>::check_thread_id() const
+	{
+		if (details::get_thread_id() >= m_max_nbr_threads)
+		{
+			throw std::runtime_error("Thread id should be lower than the maximum number of threads");
+		}
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
 	void unordered_map<Key, Value, HashFunction>::watch_node(node_union node) noexcept
 	{
-		m_watched_nodes[static_cast<std::ptrdiff_t>(details::get_thread_id())] = node.ptr_int;
+		m_hazards.protect(0, node.ptr_int);
 	}
 
 	template <typename Key, typename Value, typename HashFunction>
 	void unordered_map<Key, Value, HashFunction>::clear_watched_node() noexcept
 	{
-		m_watched_nodes[static_cast<std::ptrdiff_t>(details::get_thread_id())] = 0;
+		m_hazards.clear(0);
 	}
 } // namespace wfc
 
@@ -0,0 +1,298 @@
+#ifndef WFC_UNORDERED_SET_HPP
+#define WFC_UNORDERED_SET_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+#include "unordered_map.hpp"
+
+namespace wfc
+{
+	/**
+	 * A wait free hash set
+	 *
+	 * @details The set is an unordered_map whose datanodes only hold the hash and the key, hence it shares the trie,
+	 * the expansion of contended slots and the reclamation of datanodes with the map.
+	 *
+	 * @tparam Key type of the elements in the set
+	 * @tparam HashFunction Functor that holds the hash function to be used on keys.
+	 * The hash function has to be collision-free, @see unordered_map
+	 */
+	template <typename Key, typename HashFunction = identity_hash<Key>>
+	class unordered_set
+	{
+	public:
+		using key_t = Key;
+		using hash_t = std::invoke_result_t<HashFunction, Key>;
+
+		/**
+		 * @see unordered_map::unordered_map(const fanout_schedule&, std::size_t, std::size_t, memory_placement)
+		 */
+		explicit unordered_set(const fanout_schedule& schedule,
+		                       std::size_t max_fail_count = 8,
+		                       std::size_t max_nbr_threads = 8,
+		                       memory_placement placement = memory_placement::heap);
+
+		/**
+		 * @see unordered_map::unordered_map(std::size_t, std::size_t, std::size_t, memory_placement)
+		 */
+		explicit unordered_set(std::size_t array_length,
+		                       std::size_t max_fail_count = 8,
+		                       std::size_t max_nbr_threads = 8,
+		                       memory_placement placement = memory_placement::heap);
+
+		/**
+		 * @see unordered_map::unordered_map(const fanout_schedule&, std::size_t, std::size_t, memory_resource*)
+		 */
+		unordered_set(const fanout_schedule& schedule,
+		              std::size_t max_fail_count,
+		              std::size_t max_nbr_threads,
+		              memory_resource* resource);
+
+		/**
+		 * @see unordered_map::unordered_map(std::size_t, std::size_t, std::size_t, memory_resource*)
+		 */
+		unordered_set(std::size_t array_length,
+		              std::size_t max_fail_count,
+		              std::size_t max_nbr_threads,
+		              memory_resource* resource);
+		unordered_set(const unordered_set&) = delete;
+
+		unordered_set& operator=(const unordered_set&) = delete;
+
+		/**
+		 * Inserts the key in the set.
+		 *
+		 * @return Returns operation_result::already_present if the key is already in the set.
+		 * Otherwise it returns operation_result::success
+		 */
+		operation_result insert(const Key& key);
+
+		/**
+		 * Inserts every key of the range.
+		 *
+		 * @return the number of keys which were not already present
+		 */
+		template <typename InputIt>
+		std::size_t insert(InputIt first, InputIt last);
+
+		/**
+		 * Returns true if the key is in the set.
+		 */
+		bool contains(const Key& key);
+
+		/**
+		 * Removes the key from the set.
+		 *
+		 * @return Returns operation_result::element_not_found if the key is not in the set.
+		 * Otherwise it returns operation_result::success
+		 */
+		operation_result erase(const Key& key);
+
+		/**
+		 * Applies functor on every key in the set.
+		 * This function is NOT thread safe.
+		 * @tparam VisitorFun The type should be compatible with this prototype
+		 * 	void(const key_t&);
+		 */
+		template <typename VisitorFun>
+		void visit(VisitorFun&& fun);
+
+		/**
+		 * Inserts every key of other, making this set the union of both sets.
+		 * Other may not be modified during the operation, this set may.
+		 *
+		 * @return the number of inserted keys
+		 */
+		std::size_t insert_all(unordered_set& other);
+
+		/**
+		 * Removes every key of other, making this set the difference of both sets.
+		 * Other may not be modified during the operation, this set may.
+		 *
+		 * @return the number of removed keys
+		 */
+		std::size_t erase_all(unordered_set& other);
+
+		/**
+		 * Removes every key which is not in other, making this set the intersection of both sets.
+		 * Both sets may be modified during the operation, keys inserted in this set meanwhile may or may not be
+		 * removed.
+		 *
+		 * @return the number of removed keys
+		 */
+		std::size_t retain_all(unordered_set& other);
+
+		/**
+		 * Returns true if every key of this set is in other.
+		 * This set may not be modified during the operation, other may.
+		 */
+		bool is_subset_of(unordered_set& other);
+
+		/**
+		 * @see unordered_map::structure_stats
+		 */
+		structure_report structure_stats(std::size_t nbr_threads = 1);
+
+		/**
+		 * Returns the number of elements into the collection
+		 */
+		std::size_t size() const noexcept;
+
+		/**
+		 * Returns true if the set is empty, false otherwise.
+		 */
+		bool is_empty() const noexcept;
+
+	private:
+		unordered_map<Key, details::no_value, HashFunction> m_map;
+	};
+
+	template <typename Key, typename HashFunction>
+	unordered_set<Key, HashFunction>::unordered_set(const fanout_schedule& schedule,
+	                                                std::size_t max_fail_count,
+	                                                std::size_t max_nbr_threads,
+	                                                memory_placement placement)
+	    : m_map(schedule, max_fail_count, max_nbr_threads, placement)
+	{
+	}
+
+	template <typename Key, typename HashFunction>
+	unordered_set<Key, HashFunction>::unordered_set(std::size_t array_length,
+	                                                std::size_t max_fail_count,
+	                                                std::size_t max_nbr_threads,
+	                                                memory_placement placement)
+	    : m_map(array_length, max_fail_count, max_nbr_threads, placement)
+	{
+	}
+
+	template <typename Key, typename HashFunction>
+	unordered_set<Key, HashFunction>::unordered_set(const fanout_schedule& schedule,
+	                                                std::size_t max_fail_count,
+	                                                std::size_t max_nbr_threads,
+	                                                memory_resource* resource)
+	    : m_map(schedule, max_fail_count, max_nbr_threads, resource)
+	{
+	}
+
+	template <typename Key, typename HashFunction>
+	unordered_set<Key, HashFunction>::unordered_set(std::size_t array_length,
+	                                                std::size_t max_fail_count,
+	                                                std::size_t max_nbr_threads,
+	                                                memory_resource* resource)
+	    : m_map(array_length, max_fail_count, max_nbr_threads, resource)
+	{
+	}
+
+	template <typename Key, typename HashFunction>
+	operation_result unordered_set<Key, HashFunction>::insert(const Key& key)
+	{
+		return m_map.insert(key, details::no_value{});
+	}
+
+	template <typename Key, typename HashFunction>
+	template <typename InputIt>
+	std::size_t unordered_set<Key, HashFunction>::insert(InputIt first, InputIt last)
+	{
+		std::size_t inserted = 0;
+		for (; first != last; ++first)
+		{
+			if (succeeded(insert(*first)))
+			{
+				++inserted;
+			}
+		}
+
+		return inserted;
+	}
+
+	template <typename Key, typename HashFunction>
+	bool unordered_set<Key, HashFunction>::contains(const Key& key)
+	{
+		return m_map.get(key).has_value();
+	}
+
+	template <typename Key, typename HashFunction>
+	operation_result unordered_set<Key, HashFunction>::erase(const Key& key)
+	{
+		return m_map.remove(key);
+	}
+
+	template <typename Key, typename HashFunction>
+	template <typename VisitorFun>
+	void unordered_set<Key, HashFunction>::visit(VisitorFun&& fun)
+	{
+		static_assert(std::is_invocable_v<VisitorFun, const key_t&>, "Visitor doesn't respect the concept");
+
+		m_map.visit([&fun](std::pair<key_t, details::no_value> p) { std::invoke(fun, std::as_const(p.first)); });
+	}
+
+	template <typename Key, typename HashFunction>
+	std::size_t unordered_set<Key, HashFunction>::insert_all(unordered_set& other)
+	{
+		std::size_t inserted = 0;
+		other.visit([this, &inserted](const key_t& key) {
+			if (succeeded(insert(key)))
+			{
+				++inserted;
+			}
+		});
+
+		return inserted;
+	}
+
+	template <typename Key, typename HashFunction>
+	std::size_t unordered_set<Key, HashFunction>::erase_all(unordered_set& other)
+	{
+		std::size_t erased = 0;
+		other.visit([this, &erased](const key_t& key) {
+			if (succeeded(erase(key)))
+			{
+				++erased;
+			}
+		});
+
+		return erased;
+	}
+
+	template <typename Key, typename HashFunction>
+	std::size_t unordered_set<Key, HashFunction>::retain_all(unordered_set& other)
+	{
+		if (&other == this)
+		{
+			return 0;
+		}
+
+		// The predicate reads other, whose hazard pointers are distinct from the ones of this set.
+		return m_map.erase_if([&other](const key_t& key, const details::no_value&) { return !other.contains(key); });
+	}
+
+	template <typename Key, typename HashFunction>
+	bool unordered_set<Key, HashFunction>::is_subset_of(unordered_set& other)
+	{
+		bool subset = true;
+		visit([&other, &subset](const key_t& key) { subset = subset && other.contains(key); });
+
+		return subset;
+	}
+
+	template <typename Key, typename HashFunction>
+	structure_report unordered_set<Key, HashFunction>::structure_stats(std::size_t nbr_threads)
+	{
+		return m_map.structure_stats(nbr_threads);
+	}
+
+	template <typename Key, typename HashFunction>
+	std::size_t unordered_set<Key, HashFunction>::size() const noexcept
+	{
+		return m_map.size();
+	}
+
+	template <typename Key, typename HashFunction>
+	bool unordered_set<Key, HashFunction>::is_empty() const noexcept
+	{
+		return m_map.is_empty();
+	}
+} // namespace wfc
+
+#endif // WFC_UNORDERED_SET_HPP
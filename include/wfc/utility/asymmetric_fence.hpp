@@ -0,0 +1,80 @@
+#ifndef WFC_ASYMMETRIC_FENCE_HPP
+#define WFC_ASYMMETRIC_FENCE_HPP
+
+#include <atomic>
+
+#if defined(__linux__)
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(SYS_membarrier)
+#	define WFC_HAS_MEMBARRIER 1
+#else
+#	define WFC_HAS_MEMBARRIER 0
+#endif
+
+namespace wfc
+{
+	/**
+	 * @brief how the publication of a hazard pointer is ordered before the check that its node is still reachable.
+	 */
+	enum class hazard_fence_mode
+	{
+		symmetric, /**< readers and reclaimers both issue a sequentially consistent fence */
+		asymmetric /**< readers only prevent compiler reordering, reclaimers interrupt every running thread */
+	};
+
+	/**
+	 * Returns true if the system supports asymmetric fences, registering the process for them the first time.
+	 */
+	bool asymmetric_fence_supported() noexcept;
+
+	namespace details
+	{
+		// Values from linux/membarrier.h, which isn't always installed.
+		constexpr int membarrier_cmd_query = 0;
+		constexpr int membarrier_cmd_private_expedited = 1 << 3;
+		constexpr int membarrier_cmd_register_private_expedited = 1 << 4;
+
+		/**
+		 * Read side of an asymmetric fence, which only orders the accesses of the calling thread for the compiler.
+		 */
+		inline void light_fence() noexcept
+		{
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		}
+
+		/**
+		 * Write side of an asymmetric fence: every running thread of the process goes through a full memory barrier
+		 * before it returns, so the accesses of each thread before its light_fence are visible, or those after it
+		 * see the accesses made before the heavy_fence.
+		 * asymmetric_fence_supported should have returned true.
+		 */
+		inline void heavy_fence() noexcept
+		{
+#if WFC_HAS_MEMBARRIER
+			::syscall(SYS_membarrier, membarrier_cmd_private_expedited, 0);
+#else
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+		}
+	} // namespace details
+
+	inline bool asymmetric_fence_supported() noexcept
+	{
+#if WFC_HAS_MEMBARRIER
+		static const bool supported = []() {
+			long commands = ::syscall(SYS_membarrier, details::membarrier_cmd_query, 0);
+			return commands >= 0 && (commands & details::membarrier_cmd_private_expedited) != 0
+			       && ::syscall(SYS_membarrier, details::membarrier_cmd_register_private_expedited, 0) == 0;
+		}();
+
+		return supported;
+#else
+		return false;
+#endif
+	}
+} // namespace wfc
+
+#endif // WFC_ASYMMETRIC_FENCE_HPP
@@ -0,0 +1,92 @@
+#ifndef WFC_BACKOFF_HPP
+#define WFC_BACKOFF_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#	include <immintrin.h>
+#endif
+
+namespace wfc
+{
+	/**
+	 * @brief how long a thread waits after failing to modify a contended slot.
+	 */
+	enum class backoff_policy
+	{
+		none, /**< retries right away */
+		exponential, /**< doubles the wait after each failure */
+		proportional /**< grows the wait linearly with the number of failures */
+	};
+
+	namespace details
+	{
+		/**
+		 * Hints the processor that the thread is spinning.
+		 */
+		inline void cpu_relax() noexcept
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+#elif defined(__aarch64__)
+			asm volatile("yield");
+#endif
+		}
+
+		/**
+		 * Spins between the attempts of a single operation, according to a backoff_policy.
+		 */
+		class backoff
+		{
+		public:
+			/**
+			 * @param max_spins upper bound of a single wait, in pause instructions
+			 */
+			backoff(backoff_policy policy, std::size_t max_spins) noexcept;
+
+			/**
+			 * Waits after a failed attempt, longer as failures accumulate.
+			 */
+			void pause() noexcept;
+
+		private:
+			static constexpr std::size_t min_spins = 4;
+
+			backoff_policy m_policy;
+			std::size_t m_max_spins;
+			std::size_t m_failures;
+		};
+
+		inline backoff::backoff(backoff_policy policy, std::size_t max_spins) noexcept
+		    : m_policy(policy), m_max_spins(max_spins), m_failures(0)
+		{
+		}
+
+		inline void backoff::pause() noexcept
+		{
+			if (m_policy == backoff_policy::none)
+			{
+				return;
+			}
+
+			++m_failures;
+			std::size_t spins = m_max_spins;
+			if (m_policy == backoff_policy::exponential && m_failures < 32)
+			{
+				spins = std::min(m_max_spins, min_spins << m_failures);
+			}
+			else if (m_policy == backoff_policy::proportional)
+			{
+				spins = std::min(m_max_spins, min_spins * m_failures);
+			}
+
+			for (std::size_t i = 0; i < spins; ++i)
+			{
+				cpu_relax();
+			}
+		}
+	} // namespace details
+} // namespace wfc
+
+#endif // WFC_BACKOFF_HPP
@@ -0,0 +1,468 @@
+#ifndef WFC_HUGE_PAGE_ARENA_HPP
+#define WFC_HUGE_PAGE_ARENA_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+#include "memory_resource.hpp"
+#include "numa.hpp"
+#include "thread_manipulation.hpp"
+
+#if defined(__linux__)
+#	include <sys/mman.h>
+#	define WFC_HAS_HUGE_PAGES 1
+#else
+#	define WFC_HAS_HUGE_PAGES 0
+#endif
+
+namespace wfc
+{
+	/**
+	 * Memory resource carving blocks out of 2 MiB regions, which are backed by transparent huge pages when
+	 * the system allows it.
+	 *
+	 * @details Regions are obtained with mmap and madvise(MADV_HUGEPAGE) on Linux. If that fails, or on other
+	 * systems, they are allocated with the global operator new and end up on regular pages.
+	 * Blocks are rounded up to a size class, by steps of block_granularity bytes up to 512 bytes and then to powers of
+	 * two up to a quarter of a region. A deallocated block is given back to a free list owned by the deallocating
+	 * thread and reused by its next allocations of the same class. Threads whose id isn't lower than max_nbr_threads
+	 * share free lists guarded by a mutex instead.
+	 * Larger blocks get a region of their own, released when they are deallocated or else with the arena.
+	 * A block aligned on more than block_granularity bytes is carved out of a block of its size plus its alignment.
+	 * When a NUMA node is given, regions are placed on the memory of that node.
+	 */
+	class huge_page_arena : public memory_resource
+	{
+	public:
+		static constexpr std::size_t huge_page_size = 2UL * 1024UL * 1024UL;
+		static constexpr std::size_t any_numa_node = std::numeric_limits<std::size_t>::max();
+
+		/**
+		 * @param max_nbr_threads maximal number of threads allocating from the arena
+		 * @param numa_node NUMA node on which regions are placed
+		 */
+		explicit huge_page_arena(std::size_t max_nbr_threads, std::size_t numa_node = any_numa_node);
+		~huge_page_arena() noexcept override;
+
+		/**
+		 * Returns the number of bytes reserved by the arena.
+		 */
+		std::size_t reserved_bytes() const noexcept;
+
+		/**
+		 * Returns the number of bytes of the shared regions actually backed by huge pages, the regions of large blocks
+		 * aren't counted.
+		 * This is read from /proc/self/smaps, hence is only available on Linux and is 0 elsewhere.
+		 */
+		std::size_t huge_page_bytes() const;
+
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept override;
+
+	private:
+		static constexpr std::size_t block_granularity = 16;
+		static constexpr std::size_t nbr_small_classes = 32;
+		// Small classes are followed by powers of two from 1 KiB to a quarter of a region.
+		static constexpr std::size_t nbr_size_classes = nbr_small_classes + 10;
+		static constexpr std::size_t max_class_size = huge_page_size / 4;
+		static constexpr std::size_t cache_line_size = 64;
+
+		struct region
+		{
+			region* next;
+			// Previous region of a large block, whose regions are unlinked when released.
+			region* previous;
+			std::size_t size;
+			bool mapped;
+			alignas(cache_line_size) std::atomic<std::size_t> offset;
+		};
+
+		static constexpr std::size_t region_header_size = (sizeof(region) + cache_line_size - 1)
+		                                                  & ~(cache_line_size - 1);
+
+		struct alignas(cache_line_size) free_lists
+		{
+			void* heads[nbr_size_classes];
+		};
+
+		struct free_block
+		{
+			free_block* next;
+		};
+
+		/**
+		 * Returns the class of blocks of the given size, nbr_size_classes if they are too large for any.
+		 */
+		static std::size_t size_class(std::size_t bytes) noexcept;
+
+		static std::size_t class_size(std::size_t cls) noexcept;
+
+		/**
+		 * Maps a region of at least size bytes, which isn't linked to the regions of the arena.
+		 */
+		region* map_region(std::size_t size);
+
+		region* new_region(std::size_t size);
+
+		void release_region(region* r) noexcept;
+
+		void* allocate_from_region(region* r, std::size_t bytes, std::size_t alignment) noexcept;
+
+		/**
+		 * Returns the free lists of the calling thread, nullptr if its id is too high to have any.
+		 */
+		free_lists* own_free_lists() const noexcept;
+
+		std::unique_ptr<free_lists[]> m_free_lists;
+		// Free lists of the threads whose id is too high to have their own ones, and regions of large blocks, both
+		// guarded by m_mutex.
+		free_lists m_shared_free_lists;
+		region* m_large_regions;
+		std::mutex m_mutex;
+		std::size_t m_max_nbr_threads;
+		std::size_t m_numa_node;
+		std::atomic<region*> m_current;
+		std::atomic<region*> m_regions;
+		std::atomic<std::size_t> m_reserved;
+	};
+
+	inline huge_page_arena::huge_page_arena(std::size_t max_nbr_threads, std::size_t numa_node)
+	    : m_free_lists{new free_lists[max_nbr_threads]()}
+	    , m_shared_free_lists{}
+	    , m_large_regions{nullptr}
+	    , m_mutex{}
+	    , m_max_nbr_threads{max_nbr_threads}
+	    , m_numa_node{numa_node}
+	    , m_current{nullptr}
+	    , m_regions{nullptr}
+	    , m_reserved{0}
+	{
+	}
+
+	inline huge_page_arena::~huge_page_arena() noexcept
+	{
+		for (region* list: {m_regions.load(), m_large_regions})
+		{
+			region* r = list;
+			while (r != nullptr)
+			{
+				region* next = r->next;
+				release_region(r);
+				r = next;
+			}
+		}
+	}
+
+	inline std::size_t huge_page_arena::reserved_bytes() const noexcept
+	{
+		return m_reserved.load();
+	}
+
+	inline std::size_t huge_page_arena::huge_page_bytes() const
+	{
+#if WFC_HAS_HUGE_PAGES
+		std::ifstream smaps("/proc/self/smaps");
+		std::string line;
+		std::uintptr_t overlap = 0;
+		std::size_t result = 0;
+
+		while (std::getline(smaps, line))
+		{
+			std::size_t dash = line.find('-');
+			std::size_t space = line.find(' ');
+			if (dash != std::string::npos && space != std::string::npos && dash < space
+			    && line.find_first_not_of("0123456789abcdef") == dash)
+			{
+				std::uintptr_t begin = std::stoull(line.substr(0, dash), nullptr, 16);
+				std::uintptr_t end = std::stoull(line.substr(dash + 1, space - dash - 1), nullptr, 16);
+
+				overlap = 0;
+				for (region* r = m_regions.load(); r != nullptr; r = r->next)
+				{
+					std::uintptr_t r_begin = reinterpret_cast<std::uintptr_t>(r);
+					std::uintptr_t r_end = r_begin + r->size;
+					if (r->mapped && r_begin < end && begin < r_end)
+					{
+						overlap += std::min(end, r_end) - std::max(begin, r_begin);
+					}
+				}
+			}
+			else if (overlap != 0 && line.compare(0, 14, "AnonHugePages:") == 0)
+			{
+				std::size_t kb = std::stoull(line.substr(14));
+				result += std::min<std::size_t>(kb * 1024, overlap);
+			}
+		}
+
+		return result;
+#else
+		return 0;
+#endif
+	}
+
+	inline void* huge_page_arena::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+		if (alignment > block_granularity)
+		{
+			// The start of the enclosing block is stored right before the aligned one, to be freed from there.
+			void* room = do_allocate(bytes + alignment, block_granularity);
+			std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(room) + block_granularity + alignment - 1)
+			                   & ~(alignment - 1);
+			reinterpret_cast<void**>(p)[-1] = room;
+			return reinterpret_cast<void*>(p);
+		}
+
+		std::size_t cls = size_class(bytes);
+		if (cls == nbr_size_classes)
+		{
+			// Large blocks get their own region, so that they don't waste the end of the current one and can be
+			// released on their own.
+			region* r = map_region(region_header_size + bytes);
+			m_reserved += r->size;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			r->next = m_large_regions;
+			if (m_large_regions != nullptr)
+			{
+				m_large_regions->previous = r;
+			}
+			m_large_regions = r;
+			return allocate_from_region(r, bytes, alignment);
+		}
+
+		free_lists* lists = own_free_lists();
+		if (lists == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			void*& head = m_shared_free_lists.heads[cls];
+			if (head != nullptr)
+			{
+				void* p = head;
+				head = static_cast<free_block*>(p)->next;
+				return p;
+			}
+		}
+		else if (lists->heads[cls] != nullptr)
+		{
+			void*& head = lists->heads[cls];
+			void* p = head;
+			head = static_cast<free_block*>(p)->next;
+			return p;
+		}
+
+		// Blocks are carved with the size of their class, so that they can serve any block of the class once freed.
+		bytes = class_size(cls);
+		region* r = m_current.load(std::memory_order_acquire);
+		while (true)
+		{
+			if (r != nullptr)
+			{
+				void* p = allocate_from_region(r, bytes, alignment);
+				if (p != nullptr)
+				{
+					return p;
+				}
+			}
+
+			region* fresh = new_region(huge_page_size);
+			if (m_current.compare_exchange_strong(r, fresh))
+			{
+				r = fresh;
+			}
+			else
+			{
+				// Another thread installed a region first. Ours stays in the list and will be released with
+				// the arena, but it can still serve this allocation.
+				void* p = allocate_from_region(fresh, bytes, alignment);
+				if (p != nullptr)
+				{
+					return p;
+				}
+			}
+		}
+	}
+
+	inline void huge_page_arena::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+	{
+		if (alignment > block_granularity)
+		{
+			do_deallocate(static_cast<void**>(p)[-1], bytes + alignment, block_granularity);
+			return;
+		}
+
+		std::size_t cls = size_class(bytes);
+		if (cls == nbr_size_classes)
+		{
+			// The block is right after the header of its region.
+			region* r = reinterpret_cast<region*>(static_cast<char*>(p) - region_header_size);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				(r->previous != nullptr ? r->previous->next : m_large_regions) = r->next;
+				if (r->next != nullptr)
+				{
+					r->next->previous = r->previous;
+				}
+			}
+			m_reserved -= r->size;
+			release_region(r);
+			return;
+		}
+
+		free_lists* lists = own_free_lists();
+		if (lists == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			void*& head = m_shared_free_lists.heads[cls];
+			static_cast<free_block*>(p)->next = static_cast<free_block*>(head);
+			head = p;
+		}
+		else
+		{
+			void*& head = lists->heads[cls];
+			static_cast<free_block*>(p)->next = static_cast<free_block*>(head);
+			head = p;
+		}
+	}
+
+	inline std::size_t huge_page_arena::size_class(std::size_t bytes) noexcept
+	{
+		bytes = std::max(bytes, sizeof(free_block));
+		if (bytes <= nbr_small_classes * block_granularity)
+		{
+			return (bytes - 1) / block_granularity;
+		}
+		if (bytes > max_class_size)
+		{
+			return nbr_size_classes;
+		}
+
+		std::size_t cls = nbr_small_classes;
+		while (class_size(cls) < bytes)
+		{
+			++cls;
+		}
+		return cls;
+	}
+
+	inline std::size_t huge_page_arena::class_size(std::size_t cls) noexcept
+	{
+		if (cls < nbr_small_classes)
+		{
+			return (cls + 1) * block_granularity;
+		}
+
+		return (nbr_small_classes * block_granularity * 2) << (cls - nbr_small_classes);
+	}
+
+	inline auto huge_page_arena::own_free_lists() const noexcept -> free_lists*
+	{
+		std::size_t thread_id = details::get_thread_id();
+
+		return thread_id < m_max_nbr_threads ? &m_free_lists[thread_id] : nullptr;
+	}
+
+	inline auto huge_page_arena::map_region(std::size_t size) -> region*
+	{
+		size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+
+		void* memory = nullptr;
+		bool mapped = false;
+#if WFC_HAS_HUGE_PAGES
+		// Over-allocates by one huge page to be able to align the region on a huge page boundary.
+		void* raw = ::mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw != MAP_FAILED)
+		{
+			std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(raw);
+			std::uintptr_t aligned = (begin + huge_page_size - 1) & ~(huge_page_size - 1);
+			if (aligned != begin)
+			{
+				::munmap(raw, aligned - begin);
+			}
+			::munmap(reinterpret_cast<void*>(aligned + size), huge_page_size - (aligned - begin));
+
+			memory = reinterpret_cast<void*>(aligned);
+			mapped = true;
+			::madvise(memory, size, MADV_HUGEPAGE);
+		}
+#endif
+		if (memory == nullptr)
+		{
+			memory = ::operator new(size, std::align_val_t{huge_page_size});
+		}
+
+		if (m_numa_node != any_numa_node)
+		{
+			details::bind_to_numa_node(memory, size, m_numa_node);
+		}
+
+		region* r = new (memory) region{nullptr, nullptr, size, mapped, {0}};
+		r->offset.store(region_header_size);
+
+		return r;
+	}
+
+	inline auto huge_page_arena::new_region(std::size_t size) -> region*
+	{
+		region* r = map_region(size);
+		m_reserved += r->size;
+
+		region* head = m_regions.load();
+		do
+		{
+			r->next = head;
+		} while (!m_regions.compare_exchange_weak(head, r));
+
+		return r;
+	}
+
+	inline void huge_page_arena::release_region(region* r) noexcept
+	{
+		std::size_t size = r->size;
+		bool mapped = r->mapped;
+		r->~region();
+
+#if WFC_HAS_HUGE_PAGES
+		if (mapped)
+		{
+			::munmap(r, size);
+			return;
+		}
+#endif
+		static_cast<void>(mapped);
+		::operator delete(static_cast<void*>(r), std::align_val_t{huge_page_size});
+	}
+
+	inline void* huge_page_arena::allocate_from_region(region* r, std::size_t bytes, std::size_t alignment) noexcept
+	{
+		alignment = std::max(alignment, block_granularity);
+		std::size_t padded = (bytes + alignment - 1) & ~(alignment - 1);
+		if (alignment > block_granularity)
+		{
+			padded += alignment;
+		}
+
+		std::size_t offset = r->offset.fetch_add(padded);
+		if (offset + padded > r->size)
+		{
+			return nullptr;
+		}
+
+		std::uintptr_t p = reinterpret_cast<std::uintptr_t>(r) + offset;
+		return reinterpret_cast<void*>((p + alignment - 1) & ~(alignment - 1));
+	}
+} // namespace wfc
+
+#undef WFC_HAS_HUGE_PAGES
+
+#endif // WFC_HUGE_PAGE_ARENA_HPP
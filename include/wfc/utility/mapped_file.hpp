@@ -0,0 +1,112 @@
+#ifndef WFC_MAPPED_FILE_HPP
+#define WFC_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	define WFC_HAS_MMAP 1
+#else
+#	define WFC_HAS_MMAP 0
+#endif
+
+namespace wfc
+{
+	namespace details
+	{
+		/**
+		 * Read-only view over the content of a file.
+		 * The file is memory mapped when the platform allows it, otherwise it is read into a buffer.
+		 */
+		class mapped_file
+		{
+		public:
+			explicit mapped_file(const std::string& path);
+			mapped_file(const mapped_file&) = delete;
+			~mapped_file() noexcept;
+
+			mapped_file& operator=(const mapped_file&) = delete;
+
+			const char* data() const noexcept;
+
+			std::size_t size() const noexcept;
+
+		private:
+			const char* m_data;
+			std::size_t m_size;
+			std::vector<char> m_buffer;
+			bool m_mapped;
+		};
+
+		inline mapped_file::mapped_file(const std::string& path) : m_data{nullptr}, m_size{0}, m_buffer{}, m_mapped{false}
+		{
+#if WFC_HAS_MMAP
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				throw std::runtime_error("Unable to open " + path);
+			}
+
+			struct stat st;
+			if (::fstat(fd, &st) == 0 && st.st_size > 0)
+			{
+				void* addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (addr != MAP_FAILED)
+				{
+					::madvise(addr, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+					m_data = static_cast<const char*>(addr);
+					m_size = static_cast<std::size_t>(st.st_size);
+					m_mapped = true;
+				}
+			}
+			::close(fd);
+
+			if (m_mapped)
+			{
+				return;
+			}
+#endif
+			std::ifstream is(path, std::ios::binary);
+			if (!is)
+			{
+				throw std::runtime_error("Unable to open " + path);
+			}
+
+			m_buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+			m_data = m_buffer.data();
+			m_size = m_buffer.size();
+		}
+
+		inline mapped_file::~mapped_file() noexcept
+		{
+#if WFC_HAS_MMAP
+			if (m_mapped)
+			{
+				::munmap(const_cast<char*>(m_data), m_size);
+			}
+#endif
+		}
+
+		inline const char* mapped_file::data() const noexcept
+		{
+			return m_data;
+		}
+
+		inline std::size_t mapped_file::size() const noexcept
+		{
+			return m_size;
+		}
+	} // namespace details
+} // namespace wfc
+
+#undef WFC_HAS_MMAP
+
+#endif // WFC_MAPPED_FILE_HPP
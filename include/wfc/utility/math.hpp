@@ -1,6 +1,7 @@
 #ifndef WFC_MATH_HPP
 #define WFC_MATH_HPP
 
+#include <cassert>
 #include <limits>
 #include <type_traits>
 
@@ -60,6 +61,83 @@ namespace wfc
 			return result;
 		}
 #endif
+
+#if WFC__has_builtin(__builtin_ctz) && WFC__has_builtin(__builtin_ctzl) && WFC__has_builtin(__builtin_ctzll)
+		template <typename T>
+		T ctz(T x)
+		{
+			assert(x != 0); // ctz is undefined for 0
+
+			if constexpr (std::is_same_v<T, unsigned int>)
+			{
+				return static_cast<T>(__builtin_ctz(x));
+			}
+			else if constexpr (std::is_same_v<T, unsigned long int>)
+			{
+				return static_cast<T>(__builtin_ctzl(x));
+			}
+			else if constexpr (std::is_same_v<T, unsigned long long int>)
+			{
+				return static_cast<T>(__builtin_ctzll(x));
+			}
+			else
+			{
+				static_assert(!std::is_same_v<T, T>);
+			}
+		}
+#else
+		template <typename T>
+		T ctz(T x)
+		{
+			static_assert(std::is_unsigned_v<T>, "T should be unsigned");
+
+			T result = 0;
+			while ((x & T(1)) == 0 && result < std::numeric_limits<T>::digits)
+			{
+				++result;
+				x >>= 1;
+			}
+
+			return result;
+		}
+#endif
+
+#if WFC__has_builtin(__builtin_popcount) && WFC__has_builtin(__builtin_popcountl) && WFC__has_builtin(__builtin_popcountll)
+		template <typename T>
+		T popcount(T x)
+		{
+			if constexpr (std::is_same_v<T, unsigned int>)
+			{
+				return static_cast<T>(__builtin_popcount(x));
+			}
+			else if constexpr (std::is_same_v<T, unsigned long int>)
+			{
+				return static_cast<T>(__builtin_popcountl(x));
+			}
+			else if constexpr (std::is_same_v<T, unsigned long long int>)
+			{
+				return static_cast<T>(__builtin_popcountll(x));
+			}
+			else
+			{
+				static_assert(!std::is_same_v<T, T>);
+			}
+		}
+#else
+		template <typename T>
+		T popcount(T x)
+		{
+			static_assert(std::is_unsigned_v<T>, "T should be unsigned");
+
+			T result = 0;
+			for (; x != 0; x &= x - 1)
+			{
+				++result;
+			}
+
+			return result;
+		}
+#endif
 	} // namespace details
 
 	template <typename T>
@@ -0,0 +1,128 @@
+#ifndef WFC_MEMORY_RESOURCE_HPP
+#define WFC_MEMORY_RESOURCE_HPP
+
+#include <cstddef>
+#include <new>
+
+#if __has_include(<memory_resource>)
+#	include <memory_resource>
+#	define WFC_HAS_PMR 1
+#else
+#	define WFC_HAS_PMR 0
+#endif
+
+namespace wfc
+{
+	/**
+	 * Source of the memory used by the nodes of a collection.
+	 * This interface mirrors std::pmr::memory_resource, which is not available on every supported compiler.
+	 */
+	class memory_resource
+	{
+	public:
+		memory_resource() = default;
+		memory_resource(const memory_resource&) = delete;
+		virtual ~memory_resource() noexcept = default;
+
+		memory_resource& operator=(const memory_resource&) = delete;
+
+		void* allocate(std::size_t bytes, std::size_t alignment);
+
+		/**
+		 * Gives back a block obtained from allocate with the same size and alignment.
+		 * The block may be given back by any thread.
+		 */
+		void deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept;
+
+	protected:
+		virtual void* do_allocate(std::size_t bytes, std::size_t alignment) = 0;
+
+		virtual void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept = 0;
+	};
+
+	/**
+	 * Returns a memory resource using the global operator new and operator delete.
+	 */
+	memory_resource* new_delete_resource() noexcept;
+
+#if WFC_HAS_PMR
+	/**
+	 * Memory resource forwarding to a std::pmr::memory_resource, such as a std::pmr::monotonic_buffer_resource
+	 * for a collection built once and then only read.
+	 * The wrapped resource has to be thread safe if the collection is modified by several threads.
+	 */
+	class pmr_resource : public memory_resource
+	{
+	public:
+		explicit pmr_resource(std::pmr::memory_resource* upstream) noexcept;
+
+		std::pmr::memory_resource* upstream() const noexcept;
+
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept override;
+
+	private:
+		std::pmr::memory_resource* m_upstream;
+	};
+
+	inline pmr_resource::pmr_resource(std::pmr::memory_resource* upstream) noexcept : m_upstream(upstream)
+	{
+	}
+
+	inline std::pmr::memory_resource* pmr_resource::upstream() const noexcept
+	{
+		return m_upstream;
+	}
+
+	inline void* pmr_resource::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+		return m_upstream->allocate(bytes, alignment);
+	}
+
+	inline void pmr_resource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+	{
+		m_upstream->deallocate(p, bytes, alignment);
+	}
+#endif
+
+	namespace details
+	{
+		class new_delete_resource_t : public memory_resource
+		{
+		protected:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+			void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept override;
+		};
+
+		inline void* new_delete_resource_t::do_allocate(std::size_t bytes, std::size_t alignment)
+		{
+			return ::operator new(bytes, std::align_val_t{alignment});
+		}
+
+		inline void new_delete_resource_t::do_deallocate(void* p, std::size_t, std::size_t alignment) noexcept
+		{
+			::operator delete(p, std::align_val_t{alignment});
+		}
+	} // namespace details
+
+	inline void* memory_resource::allocate(std::size_t bytes, std::size_t alignment)
+	{
+		return do_allocate(bytes, alignment);
+	}
+
+	inline void memory_resource::deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+	{
+		do_deallocate(p, bytes, alignment);
+	}
+
+	inline memory_resource* new_delete_resource() noexcept
+	{
+		static details::new_delete_resource_t resource;
+		return &resource;
+	}
+} // namespace wfc
+
+#endif // WFC_MEMORY_RESOURCE_HPP
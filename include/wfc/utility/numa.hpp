@@ -0,0 +1,172 @@
+#ifndef WFC_NUMA_HPP
+#define WFC_NUMA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#	include <sched.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#	define WFC_HAS_NUMA 1
+#else
+#	define WFC_HAS_NUMA 0
+#endif
+
+namespace wfc
+{
+	/**
+	 * Returns the number of NUMA nodes of the machine, 1 if the topology can't be read.
+	 */
+	std::size_t numa_node_count();
+
+	/**
+	 * Restricts the calling thread to the CPUs of the given NUMA node and makes it prefer the memory of that node.
+	 * @return false if the thread couldn't be pinned, for instance on a system without NUMA support.
+	 */
+	bool pin_current_thread_to_numa_node(std::size_t node);
+
+	namespace details
+	{
+		// Values from linux/mempolicy.h, which isn't always installed.
+		constexpr int mpol_preferred = 1;
+		constexpr unsigned int mpol_mf_move = 1U << 1U;
+
+		/**
+		 * Parses a Linux list of ids such as "0-3,8,10-11".
+		 */
+		inline std::vector<std::size_t> parse_id_list(const std::string& list)
+		{
+			std::vector<std::size_t> ids;
+			std::stringstream ss(list);
+			std::string range;
+
+			while (std::getline(ss, range, ','))
+			{
+				if (range.empty() || range == "\n")
+				{
+					continue;
+				}
+
+				std::size_t dash = range.find('-');
+				std::size_t first = std::stoul(range.substr(0, dash));
+				std::size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+				for (std::size_t id = first; id <= last; ++id)
+				{
+					ids.push_back(id);
+				}
+			}
+
+			return ids;
+		}
+
+		inline std::vector<std::size_t> numa_node_cpus(std::size_t node)
+		{
+			std::ifstream is("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+			std::string list;
+			std::getline(is, list);
+
+			return parse_id_list(list);
+		}
+
+		/**
+		 * Asks the kernel to place the pages lying entirely inside [addr, addr + size) on the given NUMA node.
+		 * Pages the range only partly covers are left alone, so that other data sharing them isn't moved.
+		 * Pages already touched are migrated. This is only a preference, allocations still succeed when the node
+		 * is full.
+		 * @return false if no page was bound, for instance when the range doesn't cover a whole page
+		 */
+		inline bool bind_to_numa_node(void* addr, std::size_t size, std::size_t node) noexcept
+		{
+#if WFC_HAS_NUMA
+			const std::uintptr_t page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+			std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(addr) + page_size - 1) & ~(page_size - 1);
+			std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(addr) + size) & ~(page_size - 1);
+			if (begin >= end)
+			{
+				return false;
+			}
+
+			constexpr std::size_t bits_per_word = sizeof(unsigned long) * 8;
+			unsigned long mask[16] = {};
+			if (node >= sizeof(mask) * 8)
+			{
+				return false;
+			}
+			mask[node / bits_per_word] = 1UL << (node % bits_per_word);
+
+			return ::syscall(SYS_mbind,
+			                 begin,
+			                 end - begin,
+			                 mpol_preferred,
+			                 mask,
+			                 sizeof(mask) * 8,
+			                 mpol_mf_move)
+			       == 0;
+#else
+			static_cast<void>(addr);
+			static_cast<void>(size);
+			static_cast<void>(node);
+			return false;
+#endif
+		}
+	} // namespace details
+
+	inline std::size_t numa_node_count()
+	{
+		static const std::size_t count = []() {
+			std::ifstream is("/sys/devices/system/node/possible");
+			std::string list;
+			std::getline(is, list);
+
+			std::vector<std::size_t> nodes = details::parse_id_list(list);
+			return nodes.empty() ? std::size_t{1} : nodes.back() + 1;
+		}();
+
+		return count;
+	}
+
+	inline bool pin_current_thread_to_numa_node(std::size_t node)
+	{
+#if WFC_HAS_NUMA
+		std::vector<std::size_t> cpus = details::numa_node_cpus(node);
+		if (cpus.empty())
+		{
+			return false;
+		}
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (std::size_t cpu: cpus)
+		{
+			CPU_SET(cpu, &set);
+		}
+
+		if (::sched_setaffinity(0, sizeof(set), &set) != 0)
+		{
+			return false;
+		}
+
+		constexpr std::size_t bits_per_word = sizeof(unsigned long) * 8;
+		unsigned long mask[16] = {};
+		if (node < sizeof(mask) * 8)
+		{
+			mask[node / bits_per_word] = 1UL << (node % bits_per_word);
+			::syscall(SYS_set_mempolicy, details::mpol_preferred, mask, sizeof(mask) * 8);
+		}
+
+		return true;
+#else
+		static_cast<void>(node);
+		return false;
+#endif
+	}
+} // namespace wfc
+
+#undef WFC_HAS_NUMA
+
+#endif // WFC_NUMA_HPP
@@ -0,0 +1,16 @@
+#ifndef WFC_SANITIZER_HPP
+#define WFC_SANITIZER_HPP
+
+// WFC_THREAD_SANITIZER is 1 when compiling with ThreadSanitizer, which doesn't model fences nor racy vector loads.
+#if defined(__SANITIZE_THREAD__)
+#	define WFC_THREAD_SANITIZER 1
+#elif defined(__has_feature)
+#	if __has_feature(thread_sanitizer)
+#		define WFC_THREAD_SANITIZER 1
+#	endif
+#endif
+#ifndef WFC_THREAD_SANITIZER
+#	define WFC_THREAD_SANITIZER 0
+#endif
+
+#endif // WFC_SANITIZER_HPP
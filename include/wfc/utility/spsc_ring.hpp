@@ -0,0 +1,117 @@
+#ifndef WFC_SPSC_RING_HPP
+#define WFC_SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace wfc
+{
+	namespace details
+	{
+		/**
+		 * Bounded wait-free ring buffer with a single producer and a single consumer.
+		 *
+		 * @tparam T type of the stored elements, it should be default constructible and copy assignable
+		 */
+		template <typename T>
+		class spsc_ring
+		{
+		public:
+			/**
+			 * @param capacity minimal number of elements the ring can hold, rounded up to a power of two
+			 */
+			explicit spsc_ring(std::size_t capacity);
+			spsc_ring(const spsc_ring&) = delete;
+			~spsc_ring() noexcept = default;
+
+			spsc_ring& operator=(const spsc_ring&) = delete;
+
+			/**
+			 * Must only be called by the producer.
+			 * @return false if the ring is full, in which case t is not pushed
+			 */
+			bool push(const T& t) noexcept(std::is_nothrow_copy_assignable_v<T>);
+
+			/**
+			 * Must only be called by the consumer.
+			 * @return false if the ring is empty
+			 */
+			bool pop(T& t) noexcept(std::is_nothrow_copy_assignable_v<T>);
+
+			std::size_t capacity() const noexcept;
+
+		private:
+			static constexpr std::size_t cache_line_size = 64;
+
+			std::unique_ptr<T[]> m_buffer;
+			std::size_t m_mask;
+			alignas(cache_line_size) std::atomic<std::size_t> m_tail;
+			std::size_t m_cached_head;
+			alignas(cache_line_size) std::atomic<std::size_t> m_head;
+			std::size_t m_cached_tail;
+		};
+
+		template <typename T>
+		spsc_ring<T>::spsc_ring(std::size_t capacity)
+		    : m_buffer{}, m_mask{0}, m_tail{0}, m_cached_head{0}, m_head{0}, m_cached_tail{0}
+		{
+			std::size_t size = 1;
+			while (size < capacity)
+			{
+				size <<= 1;
+			}
+
+			m_buffer.reset(new T[size]);
+			m_mask = size - 1;
+		}
+
+		template <typename T>
+		bool spsc_ring<T>::push(const T& t) noexcept(std::is_nothrow_copy_assignable_v<T>)
+		{
+			std::size_t tail = m_tail.load(std::memory_order_relaxed);
+
+			if (tail - m_cached_head > m_mask)
+			{
+				m_cached_head = m_head.load(std::memory_order_acquire);
+				if (tail - m_cached_head > m_mask)
+				{
+					return false;
+				}
+			}
+
+			m_buffer[tail & m_mask] = t;
+			m_tail.store(tail + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		template <typename T>
+		bool spsc_ring<T>::pop(T& t) noexcept(std::is_nothrow_copy_assignable_v<T>)
+		{
+			std::size_t head = m_head.load(std::memory_order_relaxed);
+
+			if (head == m_cached_tail)
+			{
+				m_cached_tail = m_tail.load(std::memory_order_acquire);
+				if (head == m_cached_tail)
+				{
+					return false;
+				}
+			}
+
+			t = m_buffer[head & m_mask];
+			m_head.store(head + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		template <typename T>
+		std::size_t spsc_ring<T>::capacity() const noexcept
+		{
+			return m_mask + 1;
+		}
+	} // namespace details
+} // namespace wfc
+#endif // WFC_SPSC_RING_HPP
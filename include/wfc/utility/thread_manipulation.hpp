@@ -2,17 +2,153 @@
 #define WAITFREEHASHMAP_THREAD_MANIPULATION_HPP
 
 #include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace wfc
 {
 	namespace details
 	{
+		/**
+		 * Hands out the lowest thread id no running thread holds, so that ids stay lower than the number of threads
+		 * running at once rather than the number of threads ever started.
+		 */
+		class thread_id_registry
+		{
+		public:
+			std::size_t acquire()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_released.empty())
+				{
+					return m_next++;
+				}
+
+				std::size_t id = m_released.top();
+				m_released.pop();
+				return id;
+			}
+
+			void release(std::size_t id)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_released.push(id);
+			}
+
+		private:
+			std::mutex m_mutex;
+			std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<>> m_released;
+			std::size_t m_next = 0;
+		};
+
+		inline thread_id_registry& thread_ids()
+		{
+			// Never destroyed, threads may exit after the static objects are.
+			static auto* registry = new thread_id_registry();
+			return *registry;
+		}
+
+		/**
+		 * Holds the id of a thread until it exits.
+		 */
+		class thread_id_holder
+		{
+		public:
+			thread_id_holder() : m_id(thread_ids().acquire())
+			{
+			}
+
+			thread_id_holder(const thread_id_holder&) = delete;
+
+			~thread_id_holder() noexcept
+			{
+				thread_ids().release(m_id);
+			}
+
+			thread_id_holder& operator=(const thread_id_holder&) = delete;
+
+			std::size_t id() const noexcept
+			{
+				return m_id;
+			}
+
+		private:
+			std::size_t m_id;
+		};
+
+		/**
+		 * Returns the id of the calling thread. It is given back when the thread exits and handed to a later thread,
+		 * which then takes over the per-thread state the collections keep under this id.
+		 */
 		inline std::size_t get_thread_id()
 		{
-			static std::atomic<std::size_t> i = 0;
-			thread_local static std::size_t id = i++;
+			thread_local static const thread_id_holder holder;
+
+			return holder.id();
+		}
+
+		/**
+		 * Calls fun(i) for every i in [0, nbr_workers) and returns the results by increasing i.
+		 * Worker 0 is the calling thread and the others are threads joined before returning, so that their ids are
+		 * given back and repeated calls keep using the same ids. The first exception thrown by a worker is rethrown
+		 * once every worker is done.
+		 */
+		template <typename Fun>
+		std::vector<std::invoke_result_t<Fun&, std::size_t>> run_workers(std::size_t nbr_workers, Fun&& fun)
+		{
+			std::vector<std::invoke_result_t<Fun&, std::size_t>> results(nbr_workers);
+			std::vector<std::exception_ptr> errors(nbr_workers);
+			auto work = [&fun, &results, &errors](std::size_t i) {
+				try
+				{
+					results[i] = std::invoke(fun, i);
+				}
+				catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
+			};
+
+			std::vector<std::thread> threads;
+			threads.reserve(nbr_workers);
+			try
+			{
+				for (std::size_t i = 1; i < nbr_workers; ++i)
+				{
+					threads.emplace_back(work, i);
+				}
+			}
+			catch (...)
+			{
+				for (std::thread& thread: threads)
+				{
+					thread.join();
+				}
+				throw;
+			}
+			if (nbr_workers != 0)
+			{
+				work(0);
+			}
+			for (std::thread& thread: threads)
+			{
+				thread.join();
+			}
 
-			return id;
+			for (std::exception_ptr& error: errors)
+			{
+				if (error)
+				{
+					std::rethrow_exception(error);
+				}
+			}
+			return results;
 		}
 	} // namespace details
 } // namespace wfc
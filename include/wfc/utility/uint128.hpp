@@ -0,0 +1,240 @@
+#ifndef WFC_UINT128_HPP
+#define WFC_UINT128_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace wfc
+{
+	/**
+	 * A 128 bits unsigned integer, to be used as a key or a hash for UUIDs, IPv6 addresses and other 16 bytes
+	 * identifiers
+	 *
+	 * @details It only provides the operations the maps need on hashes: shifts, bitwise operations, comparisons,
+	 * addition and subtraction. Converting it to a smaller integer, or masking it with a std::size_t, keeps its
+	 * lowest bits.
+	 */
+	class uint128
+	{
+	public:
+		constexpr uint128() noexcept = default;
+
+		// Implicit, as for the promotion of builtin integers.
+		constexpr uint128(std::uint64_t low) noexcept;
+
+		constexpr uint128(std::uint64_t high, std::uint64_t low) noexcept;
+
+		/**
+		 * Reads 16 bytes in network order, the first one being the most significant: the order of the integers is
+		 * the lexicographic order of the bytes, as for the s6_addr of an IPv6 address or the bytes of a UUID.
+		 */
+		static uint128 from_bytes(const unsigned char* bytes) noexcept;
+
+		constexpr std::uint64_t high() const noexcept;
+
+		constexpr std::uint64_t low() const noexcept;
+
+		template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+		constexpr explicit operator T() const noexcept;
+
+		constexpr uint128& operator>>=(std::size_t n) noexcept;
+
+		constexpr uint128& operator<<=(std::size_t n) noexcept;
+
+		friend constexpr uint128 operator>>(uint128 value, std::size_t n) noexcept
+		{
+			return value >>= n;
+		}
+
+		friend constexpr uint128 operator<<(uint128 value, std::size_t n) noexcept
+		{
+			return value <<= n;
+		}
+
+		friend constexpr uint128 operator&(uint128 lhs, uint128 rhs) noexcept
+		{
+			return {lhs.m_high & rhs.m_high, lhs.m_low & rhs.m_low};
+		}
+
+		/**
+		 * Masks the lowest bits, as the maps do to compute the position of a hash in an arraynode.
+		 */
+		friend constexpr std::size_t operator&(uint128 lhs, std::size_t mask) noexcept
+		{
+			return static_cast<std::size_t>(lhs.m_low) & mask;
+		}
+
+		friend constexpr uint128 operator|(uint128 lhs, uint128 rhs) noexcept
+		{
+			return {lhs.m_high | rhs.m_high, lhs.m_low | rhs.m_low};
+		}
+
+		friend constexpr uint128 operator^(uint128 lhs, uint128 rhs) noexcept
+		{
+			return {lhs.m_high ^ rhs.m_high, lhs.m_low ^ rhs.m_low};
+		}
+
+		friend constexpr uint128 operator~(uint128 value) noexcept
+		{
+			return {~value.m_high, ~value.m_low};
+		}
+
+		friend constexpr uint128 operator+(uint128 lhs, uint128 rhs) noexcept
+		{
+			std::uint64_t low = lhs.m_low + rhs.m_low;
+			return {lhs.m_high + rhs.m_high + (low < lhs.m_low ? 1U : 0U), low};
+		}
+
+		friend constexpr uint128 operator-(uint128 lhs, uint128 rhs) noexcept
+		{
+			return {lhs.m_high - rhs.m_high - (lhs.m_low < rhs.m_low ? 1U : 0U), lhs.m_low - rhs.m_low};
+		}
+
+		friend constexpr bool operator==(uint128 lhs, uint128 rhs) noexcept
+		{
+			return lhs.m_high == rhs.m_high && lhs.m_low == rhs.m_low;
+		}
+
+		friend constexpr bool operator!=(uint128 lhs, uint128 rhs) noexcept
+		{
+			return !(lhs == rhs);
+		}
+
+		friend constexpr bool operator<(uint128 lhs, uint128 rhs) noexcept
+		{
+			return lhs.m_high < rhs.m_high || (lhs.m_high == rhs.m_high && lhs.m_low < rhs.m_low);
+		}
+
+		friend constexpr bool operator>(uint128 lhs, uint128 rhs) noexcept
+		{
+			return rhs < lhs;
+		}
+
+		friend constexpr bool operator<=(uint128 lhs, uint128 rhs) noexcept
+		{
+			return !(rhs < lhs);
+		}
+
+		friend constexpr bool operator>=(uint128 lhs, uint128 rhs) noexcept
+		{
+			return !(lhs < rhs);
+		}
+
+	private:
+		static constexpr std::size_t word_bits = 64;
+
+		std::uint64_t m_high = 0;
+		std::uint64_t m_low = 0;
+	};
+
+	constexpr uint128::uint128(std::uint64_t low) noexcept : m_high(0), m_low(low)
+	{
+	}
+
+	constexpr uint128::uint128(std::uint64_t high, std::uint64_t low) noexcept : m_high(high), m_low(low)
+	{
+	}
+
+	inline uint128 uint128::from_bytes(const unsigned char* bytes) noexcept
+	{
+		std::uint64_t words[2] = {0, 0};
+		for (std::size_t i = 0; i < 16; ++i)
+		{
+			words[i / 8] = words[i / 8] << 8U | bytes[i];
+		}
+
+		return {words[0], words[1]};
+	}
+
+	constexpr std::uint64_t uint128::high() const noexcept
+	{
+		return m_high;
+	}
+
+	constexpr std::uint64_t uint128::low() const noexcept
+	{
+		return m_low;
+	}
+
+	template <typename T, typename>
+	constexpr uint128::operator T() const noexcept
+	{
+		return static_cast<T>(m_low);
+	}
+
+	constexpr uint128& uint128::operator>>=(std::size_t n) noexcept
+	{
+		if (n >= 2 * word_bits)
+		{
+			m_high = 0;
+			m_low = 0;
+		}
+		else if (n >= word_bits)
+		{
+			m_low = m_high >> (n - word_bits);
+			m_high = 0;
+		}
+		else if (n > 0)
+		{
+			m_low = m_low >> n | m_high << (word_bits - n);
+			m_high >>= n;
+		}
+
+		return *this;
+	}
+
+	constexpr uint128& uint128::operator<<=(std::size_t n) noexcept
+	{
+		if (n >= 2 * word_bits)
+		{
+			m_high = 0;
+			m_low = 0;
+		}
+		else if (n >= word_bits)
+		{
+			m_high = m_low << (n - word_bits);
+			m_low = 0;
+		}
+		else if (n > 0)
+		{
+			m_high = m_high << n | m_low >> (word_bits - n);
+			m_low <<= n;
+		}
+
+		return *this;
+	}
+} // namespace wfc
+
+namespace std
+{
+	template <>
+	class numeric_limits<wfc::uint128>
+	{
+	public:
+		static constexpr bool is_specialized = true;
+		static constexpr bool is_signed = false;
+		static constexpr bool is_integer = true;
+		static constexpr bool is_exact = true;
+		static constexpr int digits = 128;
+		static constexpr int radix = 2;
+
+		static constexpr wfc::uint128 min() noexcept
+		{
+			return {};
+		}
+
+		static constexpr wfc::uint128 lowest() noexcept
+		{
+			return {};
+		}
+
+		static constexpr wfc::uint128 max() noexcept
+		{
+			return {std::numeric_limits<std::uint64_t>::max(), std::numeric_limits<std::uint64_t>::max()};
+		}
+	};
+} // namespace std
+
+#endif // WFC_UINT128_HPP
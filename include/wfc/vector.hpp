@@ -0,0 +1,275 @@
+#ifndef WFC_VECTOR_HPP
+#define WFC_VECTOR_HPP
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "details/vector/slot.hpp"
+#include "utility/math.hpp"
+#include "utility/memory_resource.hpp"
+
+namespace wfc
+{
+	/**
+	 * A wait free growable array supporting push_back and random access
+	 *
+	 * @details Elements are stored in buckets whose sizes double: bucket b holds first_bucket_size * 2^b elements.
+	 * A push_back reserves its position with a single fetch_add, allocates the bucket of the position if no other
+	 * thread did it yet, then constructs the element in place. Growing never copies nor moves the elements,
+	 * so references to them stay valid for the lifetime of the vector.
+	 * Elements are never removed, hence they don't need to be protected against reclamation.
+	 *
+	 * @tparam T type of the elements, it has to be copy constructible
+	 */
+	template <typename T>
+	class vector
+	{
+	public:
+		using value_t = T;
+
+		/**
+		 * @param first_bucket_size number of elements of the first bucket, it has to be a power of 2.
+		 * @param resource source of the memory of the buckets, which has to outlive the vector.
+		 * @throw std::runtime_error if first_bucket_size is not a power of 2.
+		 */
+		explicit vector(std::size_t first_bucket_size = 8, memory_resource* resource = new_delete_resource());
+		vector(const vector&) = delete;
+
+		/**
+		 * Destroys the elements. No thread may use the vector anymore.
+		 */
+		~vector() noexcept;
+
+		vector& operator=(const vector&) = delete;
+
+		/**
+		 * Appends a copy of value.
+		 *
+		 * @return the index of the element
+		 */
+		std::size_t push_back(const T& value);
+
+		/**
+		 * Returns the element at index.
+		 * The push_back which returned index has to happen before, such as when the index was handed over by the
+		 * pushing thread. Otherwise, @see get
+		 */
+		T& operator[](std::size_t index) noexcept;
+
+		/**
+		 * @see operator[](std::size_t)
+		 */
+		const T& operator[](std::size_t index) const noexcept;
+
+		/**
+		 * Returns a copy of the element at index.
+		 *
+		 * @return std::nullopt if there is no element at index or if its push_back isn't done yet.
+		 */
+		std::optional<T> get(std::size_t index) const;
+
+		/**
+		 * Returns the number of reserved positions, the elements of the last ones may still be under construction.
+		 */
+		std::size_t size() const noexcept;
+
+		/**
+		 * Returns true if the vector is empty, false otherwise.
+		 */
+		bool is_empty() const noexcept;
+
+		/**
+		 * Returns the number of elements the allocated buckets can hold.
+		 */
+		std::size_t capacity() const noexcept;
+
+	private:
+		using slot_t = details::vector_slot_t<T>;
+
+		static constexpr std::size_t max_buckets = std::numeric_limits<std::size_t>::digits;
+
+		/**
+		 * Returns the bucket of the position and the position inside of it.
+		 */
+		std::pair<std::size_t, std::size_t> locate(std::size_t index) const noexcept;
+
+		std::size_t bucket_size(std::size_t bucket) const noexcept;
+
+		/**
+		 * Returns the bucket, allocating it if no thread did it yet.
+		 */
+		slot_t* ensure_bucket(std::size_t bucket);
+
+		std::size_t m_first_bucket_bits;
+		memory_resource* m_resource;
+		std::atomic<std::size_t> m_size;
+		std::array<std::atomic<slot_t*>, max_buckets> m_buckets;
+	};
+
+	template <typename T>
+	vector<T>::vector(std::size_t first_bucket_size, memory_resource* resource)
+	    : m_first_bucket_bits(0), m_resource(resource), m_size(0), m_buckets()
+	{
+		if (!is_power_of_two(first_bucket_size))
+		{
+			throw std::runtime_error("First bucket size must be a power of 2");
+		}
+
+		m_first_bucket_bits = log2_of_power_of_two(first_bucket_size);
+		for (std::atomic<slot_t*>& bucket: m_buckets)
+		{
+			bucket = nullptr;
+		}
+	}
+
+	template <typename T>
+	vector<T>::~vector() noexcept
+	{
+		for (std::size_t b = 0; b < max_buckets; ++b)
+		{
+			slot_t* bucket = m_buckets[b].load();
+			if (bucket == nullptr)
+			{
+				continue;
+			}
+
+			for (std::size_t i = 0; i < bucket_size(b); ++i)
+			{
+				if (bucket[i].ready.load())
+				{
+					bucket[i].element()->~T();
+				}
+				bucket[i].~slot_t();
+			}
+			m_resource->deallocate(bucket, bucket_size(b) * sizeof(slot_t), alignof(slot_t));
+		}
+	}
+
+	template <typename T>
+	std::size_t vector<T>::push_back(const T& value)
+	{
+		std::size_t index = m_size.fetch_add(1);
+		auto [bucket, offset] = locate(index);
+
+		slot_t& slot = ensure_bucket(bucket)[offset];
+		new (slot.storage) T(value);
+		slot.ready.store(true, std::memory_order_release);
+
+		return index;
+	}
+
+	template <typename T>
+	T& vector<T>::operator[](std::size_t index) noexcept
+	{
+		auto [bucket, offset] = locate(index);
+		return *m_buckets[bucket].load(std::memory_order_acquire)[offset].element();
+	}
+
+	template <typename T>
+	const T& vector<T>::operator[](std::size_t index) const noexcept
+	{
+		auto [bucket, offset] = locate(index);
+		return *m_buckets[bucket].load(std::memory_order_acquire)[offset].element();
+	}
+
+	template <typename T>
+	std::optional<T> vector<T>::get(std::size_t index) const
+	{
+		if (index >= m_size.load())
+		{
+			return {};
+		}
+
+		auto [bucket, offset] = locate(index);
+		const slot_t* slots = m_buckets[bucket].load(std::memory_order_acquire);
+		if (slots == nullptr || !slots[offset].ready.load(std::memory_order_acquire))
+		{
+			return {};
+		}
+
+		return *slots[offset].element();
+	}
+
+	template <typename T>
+	std::size_t vector<T>::size() const noexcept
+	{
+		return m_size.load();
+	}
+
+	template <typename T>
+	bool vector<T>::is_empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	template <typename T>
+	std::size_t vector<T>::capacity() const noexcept
+	{
+		std::size_t capacity = 0;
+		for (std::size_t b = 0; b < max_buckets; ++b)
+		{
+			if (m_buckets[b].load() != nullptr)
+			{
+				capacity += bucket_size(b);
+			}
+		}
+
+		return capacity;
+	}
+
+	template <typename T>
+	std::pair<std::size_t, std::size_t> vector<T>::locate(std::size_t index) const noexcept
+	{
+		// Shifting the index by the first bucket size makes each bucket start at a power of 2.
+		std::size_t position = index + (1UL << m_first_bucket_bits);
+		std::size_t high_bit = std::numeric_limits<std::size_t>::digits - 1 - details::clz(position);
+
+		return {high_bit - m_first_bucket_bits, position ^ (1UL << high_bit)};
+	}
+
+	template <typename T>
+	std::size_t vector<T>::bucket_size(std::size_t bucket) const noexcept
+	{
+		return 1UL << (m_first_bucket_bits + bucket);
+	}
+
+	template <typename T>
+	auto vector<T>::ensure_bucket(std::size_t bucket) -> slot_t*
+	{
+		slot_t* slots = m_buckets[bucket].load(std::memory_order_acquire);
+		if (slots != nullptr)
+		{
+			return slots;
+		}
+
+		std::size_t length = bucket_size(bucket);
+		auto* allocated = static_cast<slot_t*>(m_resource->allocate(length * sizeof(slot_t), alignof(slot_t)));
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			new (&allocated[i]) slot_t;
+			allocated[i].ready.store(false, std::memory_order_relaxed);
+		}
+
+		// Several threads may allocate the same bucket, only one of them installs it.
+		if (m_buckets[bucket].compare_exchange_strong(slots, allocated))
+		{
+			return allocated;
+		}
+
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			allocated[i].~slot_t();
+		}
+		m_resource->deallocate(allocated, length * sizeof(slot_t), alignof(slot_t));
+		return slots;
+	}
+} // namespace wfc
+
+#endif // WFC_VECTOR_HPP
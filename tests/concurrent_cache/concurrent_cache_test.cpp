@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <wfc/concurrent_cache.hpp>
+
+TEST(ConcurrentCache, PutGetErase)
+{
+	wfc::concurrent_cache<std::size_t, std::size_t> cache(100, 4);
+	ASSERT_TRUE(cache.is_empty());
+	ASSERT_FALSE(cache.get(1).has_value());
+
+	ASSERT_EQ(cache.put(1, 10), wfc::operation_result::success);
+	ASSERT_EQ(cache.put(1, 11), wfc::operation_result::already_present);
+	ASSERT_EQ(cache.get(1), 11);
+	ASSERT_EQ(cache.size(), 1);
+
+	ASSERT_EQ(cache.erase(1), wfc::operation_result::success);
+	ASSERT_EQ(cache.erase(1), wfc::operation_result::element_not_found);
+	ASSERT_TRUE(cache.is_empty());
+}
+
+TEST(ConcurrentCache, CapacityIsEnforced)
+{
+	wfc::concurrent_cache<std::size_t, std::size_t> cache(64, 4);
+	for (std::size_t i = 0; i < 10000; ++i)
+	{
+		cache.put(i, i);
+		// Each put sweeps 4 of the 16 head buckets, the first 4 puts over the capacity may only clear bits.
+		ASSERT_LE(cache.size(), cache.capacity() + 4);
+	}
+	ASSERT_EQ(cache.size(), 64);
+}
+
+TEST(ConcurrentCache, ReadEntriesGetASecondChance)
+{
+	wfc::concurrent_cache<std::size_t, std::size_t> cache(64, 4);
+	constexpr std::size_t hot_key = 3;
+
+	for (std::size_t i = 0; i < 10000; ++i)
+	{
+		ASSERT_EQ(cache.get(hot_key).value_or(hot_key), hot_key);
+		cache.put(i < 64 ? i : 1000 + i, i < 64 ? i : 0);
+		// Once cached, the hot key is read before every insertion and never evicted.
+		ASSERT_EQ(cache.get(hot_key).has_value(), i >= hot_key);
+	}
+}
+
+TEST(ConcurrentCache, ConcurrentPutGet)
+{
+	constexpr std::size_t nbr_threads = 8;
+	constexpr std::size_t capacity = 256;
+
+	wfc::concurrent_cache<std::size_t, std::size_t> cache(capacity, 4, nbr_threads, nbr_threads + 1);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&cache, t]() {
+			for (std::size_t i = 0; i < 20000; ++i)
+			{
+				std::size_t key = (i * 7 + t) % 2048;
+				if (i % 3 == 0)
+				{
+					cache.put(key, key * 2);
+				}
+				else
+				{
+					std::optional<std::size_t> value = cache.get(key);
+					ASSERT_TRUE(!value || *value == key * 2);
+				}
+			}
+		});
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+
+	// Writers may stop sweeping over the capacity, the next puts go on from the hand.
+	for (std::size_t i = 0; i < 64 && cache.size() > capacity; ++i)
+	{
+		cache.put(0, 0);
+	}
+	ASSERT_LE(cache.size(), capacity);
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <wfc/queue.hpp>
+
+TEST(WaitFreeQueue, Fifo)
+{
+	wfc::queue<int> queue(1);
+	ASSERT_TRUE(queue.is_empty());
+	ASSERT_FALSE(queue.dequeue().has_value());
+
+	for (int i = 0; i < 100; ++i)
+	{
+		queue.enqueue(i);
+	}
+	ASSERT_FALSE(queue.is_empty());
+
+	for (int i = 0; i < 100; ++i)
+	{
+		std::optional<int> value = queue.dequeue();
+		ASSERT_TRUE(value.has_value());
+		ASSERT_EQ(*value, i);
+	}
+	ASSERT_TRUE(queue.is_empty());
+	ASSERT_FALSE(queue.dequeue().has_value());
+}
+
+TEST(WaitFreeQueue, Bulk)
+{
+	wfc::queue<int> queue(1);
+	std::vector<int> values(50);
+	std::iota(values.begin(), values.end(), 0);
+
+	ASSERT_EQ(queue.enqueue_bulk(values.begin(), values.begin()), 0);
+	ASSERT_EQ(queue.enqueue_bulk(values.begin(), values.end()), 50);
+	queue.enqueue(50);
+	ASSERT_EQ(queue.enqueue_bulk(values.begin(), values.begin() + 10), 10);
+
+	std::vector<int> out;
+	ASSERT_EQ(queue.dequeue_bulk(std::back_inserter(out), 51), 51);
+	for (int i = 0; i <= 50; ++i)
+	{
+		ASSERT_EQ(out[static_cast<std::size_t>(i)], i);
+	}
+
+	out.clear();
+	ASSERT_EQ(queue.dequeue_bulk(std::back_inserter(out), 100), 10);
+	ASSERT_TRUE(std::equal(out.begin(), out.end(), values.begin()));
+	ASSERT_TRUE(queue.is_empty());
+}
+
+TEST(WaitFreeQueue, ConcurrentProducersConsumers)
+{
+	constexpr std::size_t nbr_producers = 4;
+	constexpr std::size_t nbr_consumers = 4;
+	constexpr std::size_t per_producer = 20000;
+
+	// The calling thread uses the queue too.
+	wfc::queue<std::size_t> queue(nbr_producers + nbr_consumers + 1);
+	std::vector<std::atomic<int>> seen(nbr_producers * per_producer);
+	std::atomic<std::size_t> consumed{0};
+
+	std::vector<std::thread> threads;
+	for (std::size_t p = 0; p < nbr_producers; ++p)
+	{
+		threads.emplace_back([&queue, p]() {
+			std::vector<std::size_t> batch;
+			for (std::size_t i = 0; i < per_producer; ++i)
+			{
+				batch.push_back(p * per_producer + i);
+				// Half of the values are enqueued one by one, the others by batches.
+				if (i % 2 == 0 || batch.size() == 8)
+				{
+					queue.enqueue_bulk(batch.begin(), batch.end());
+					batch.clear();
+				}
+			}
+			queue.enqueue_bulk(batch.begin(), batch.end());
+		});
+	}
+
+	for (std::size_t c = 0; c < nbr_consumers; ++c)
+	{
+		threads.emplace_back([&queue, &seen, &consumed]() {
+			std::vector<std::size_t> last(nbr_producers, 0);
+			std::vector<bool> started(nbr_producers, false);
+			while (consumed.load() < nbr_producers * per_producer)
+			{
+				std::optional<std::size_t> value = queue.dequeue();
+				if (!value)
+				{
+					continue;
+				}
+
+				// Values of a producer come out in the order they were enqueued.
+				std::size_t producer = *value / per_producer;
+				ASSERT_TRUE(!started[producer] || last[producer] < *value);
+				started[producer] = true;
+				last[producer] = *value;
+
+				seen[*value].fetch_add(1);
+				consumed.fetch_add(1);
+			}
+		});
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+
+	ASSERT_TRUE(queue.is_empty());
+	for (const std::atomic<int>& count: seen)
+	{
+		ASSERT_EQ(count.load(), 1);
+	}
+}
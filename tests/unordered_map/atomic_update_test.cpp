@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+TEST(AtomicUpdate, UpdatesEveryKey)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(1, 10);
+	map.insert(5, 50);
+	map.insert(9, 90);
+
+	auto result = map.atomic_update({1, 5, 9}, [](std::vector<std::size_t>& values) {
+		EXPECT_EQ(values, (std::vector<std::size_t>{10, 50, 90}));
+		values[0] += 1;
+		values[1] += 2;
+		values[2] += 3;
+		return true;
+	});
+
+	ASSERT_EQ(result, wfc::operation_result::success);
+	ASSERT_EQ(map.get(1), 11);
+	ASSERT_EQ(map.get(5), 52);
+	ASSERT_EQ(map.get(9), 93);
+	ASSERT_EQ(map.size(), 3);
+}
+
+TEST(AtomicUpdate, MissingKeyOrCancellation)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(1, 10);
+	map.insert(2, 20);
+
+	auto increment = [](std::vector<std::size_t>& values) {
+		for (std::size_t& value: values)
+		{
+			++value;
+		}
+		return true;
+	};
+	ASSERT_EQ(map.atomic_update({1, 3}, increment), wfc::operation_result::element_not_found);
+	ASSERT_EQ(map.atomic_update({1, 2}, [](std::vector<std::size_t>& values) { return values[0] > values[1]; }),
+	          wfc::operation_result::expected_value_mismatch);
+	ASSERT_EQ(map.get(1), 10);
+	ASSERT_EQ(map.get(2), 20);
+
+	ASSERT_THROW(map.atomic_update({1, 1}, increment), std::runtime_error);
+	ASSERT_EQ(map.get(1), 10);
+	ASSERT_EQ(map.atomic_update({}, increment), wfc::operation_result::success);
+}
+
+TEST(AtomicUpdate, ConcurrentTransfersKeepTheTotal)
+{
+	constexpr std::size_t nbr_accounts = 16;
+	constexpr std::size_t initial_balance = 1000;
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t nbr_transfers = 500;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(2, 4, 65535);
+	for (std::size_t i = 0; i < nbr_accounts; ++i)
+	{
+		map.insert(i, initial_balance);
+	}
+
+	std::atomic<bool> done{false};
+	// Single key operations run into the descriptors and help them complete while transfers go on.
+	std::thread rewriter([&map, &done]() {
+		for (std::size_t i = 0; !done.load(); i = (i + 1) % nbr_accounts)
+		{
+			std::optional<std::size_t> balance = map.get(i);
+			ASSERT_TRUE(balance.has_value());
+			map.update(i, *balance, *balance);
+		}
+	});
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, t]() {
+			for (std::size_t i = 0; i < nbr_transfers; ++i)
+			{
+				std::size_t from = (t + i) % nbr_accounts;
+				std::size_t to = (t * 7 + i * 3 + 1) % nbr_accounts;
+				if (from == to)
+				{
+					continue;
+				}
+
+				auto result = map.atomic_update({from, to}, [](std::vector<std::size_t>& balances) {
+					if (balances[0] == 0)
+					{
+						return false;
+					}
+					--balances[0];
+					++balances[1];
+					return true;
+				});
+				ASSERT_NE(result, wfc::operation_result::element_not_found);
+			}
+		});
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+	done = true;
+	rewriter.join();
+
+	std::size_t total = 0;
+	map.visit([&total](std::pair<std::size_t, std::size_t> p) { total += p.second; });
+	ASSERT_EQ(total, nbr_accounts * initial_balance);
+	ASSERT_EQ(map.size(), nbr_accounts);
+}
+
+TEST(AtomicUpdate, DistinctKeysReadFromTheSameSlot)
+{
+	constexpr std::size_t nbr_rounds = 200000;
+
+	// Keys 1 and 5 share a head slot, which the writer hands from one to the other without expanding it.
+	wfc::unordered_map<std::size_t, std::size_t> map(4, 4, 4);
+	map.insert(1, 10);
+
+	std::atomic<bool> done{false};
+	std::thread writer([&map, &done]() {
+		for (std::size_t i = 0; i < nbr_rounds; ++i)
+		{
+			map.remove(1);
+			map.insert(5, 50);
+			map.remove(5);
+			map.insert(1, 10);
+		}
+		done = true;
+	});
+
+	// Both keys are never in the map at once, and reading them from the same slot isn't taken for a duplicate key.
+	while (!done.load())
+	{
+		auto result = map.atomic_update({1, 5}, [](std::vector<std::size_t>&) { return true; });
+		EXPECT_EQ(result, wfc::operation_result::element_not_found);
+	}
+	writer.join();
+}
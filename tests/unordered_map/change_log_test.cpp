@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+TEST(WaitFreeHashMapChangeLog, Disabled)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(1, 1);
+
+	ASSERT_EQ(map.drain_changes([](const auto&) {}), 0);
+
+	std::stringstream ss;
+	ASSERT_THROW(map.save_delta(ss), std::runtime_error);
+}
+
+TEST(WaitFreeHashMapChangeLog, RecordsSuccessfulChanges)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.enable_change_log(16);
+
+	map.insert(1, 10);
+	map.insert(1, 11);
+	map.update(1, 12);
+	map.update(2, 12);
+	map.remove(1);
+	map.remove(1);
+
+	std::vector<wfc::change_record<std::size_t, std::size_t>> records;
+	ASSERT_EQ(map.drain_changes([&records](const auto& r) { records.push_back(r); }), 3);
+
+	ASSERT_EQ(records[0].type, wfc::change_type::insert);
+	ASSERT_EQ(records[0].value, 10);
+	ASSERT_EQ(records[1].type, wfc::change_type::update);
+	ASSERT_EQ(records[1].value, 12);
+	ASSERT_EQ(records[2].type, wfc::change_type::remove);
+	ASSERT_EQ(records[2].value, 12);
+
+	ASSERT_EQ(map.drain_changes([](const auto&) {}), 0);
+}
+
+TEST(WaitFreeHashMapChangeLog, DeltaOnTopOfSnapshot)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		map.insert(i, i);
+	}
+
+	std::stringstream base;
+	map.save(base);
+	map.enable_change_log(64);
+
+	map.update(1, 100);
+	map.update(1, 101);
+	map.remove(2);
+	map.insert(200, 200);
+
+	std::stringstream delta;
+	ASSERT_EQ(map.save_delta(delta), 3);
+
+	wfc::unordered_map<std::size_t, std::size_t> restored(4);
+	restored.load(base);
+	ASSERT_EQ(restored.load_delta(delta), 3);
+
+	ASSERT_EQ(restored.get(1).value(), 101);
+	ASSERT_FALSE(restored.get(2).has_value());
+	ASSERT_EQ(restored.get(200).value(), 200);
+	ASSERT_EQ(restored.size(), map.size());
+}
+
+TEST(WaitFreeHashMapChangeLog, Overflow)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.enable_change_log(4);
+
+	for (std::size_t i = 0; i < 10; ++i)
+	{
+		map.insert(i, i);
+	}
+
+	std::stringstream delta;
+	ASSERT_THROW(map.save_delta(delta), std::runtime_error);
+
+	map.insert(10, 10);
+	ASSERT_EQ(map.save_delta(delta), 1);
+}
+
+TEST(WaitFreeHashMapChangeLog, ConcurrentWriters)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t per_thread = 1000;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(4, nbr_threads, 65535);
+	map.enable_change_log(per_thread);
+
+	// Threads wait for each other before exiting, a thread id given back would hand its ring to a later thread.
+	std::atomic<std::size_t> done{0};
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, &done, t]() {
+			for (std::size_t i = 0; i < per_thread; ++i)
+			{
+				map.insert(t * per_thread + i, i);
+			}
+
+			++done;
+			while (done.load() != nbr_threads)
+			{
+				std::this_thread::yield();
+			}
+		});
+	}
+
+	for (auto& t: threads)
+	{
+		t.join();
+	}
+
+	std::size_t inserted = 0;
+	map.drain_changes([&inserted](const auto& r) {
+		if (r.type == wfc::change_type::insert)
+		{
+			++inserted;
+		}
+	});
+	ASSERT_EQ(inserted, nbr_threads * per_thread);
+}
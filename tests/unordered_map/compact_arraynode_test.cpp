@@ -0,0 +1,315 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <wfc/frozen_map.hpp>
+#include <wfc/unordered_map.hpp>
+
+namespace
+{
+	using map_t = wfc::unordered_map<std::size_t, std::size_t>;
+
+	std::size_t spread(std::size_t i) noexcept
+	{
+		i = (i ^ (i >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+		i = (i ^ (i >> 27U)) * 0x94D049BB133111EBULL;
+		return i ^ (i >> 31U);
+	}
+} // namespace
+
+TEST(WaitFreeHashMapCompactArraynode, ExpansionStartsCompact)
+{
+	// Heads of 16 slots, then arraynodes of 8 slots holding up to 4 datanodes while compact.
+	map_t map(wfc::fanout_schedule{4, 3});
+	map.enable_compact_arraynodes();
+
+	// 0, 16, 32 and 48 share the first slot of the head and have different positions below it.
+	for (std::size_t key: {0U, 16U, 32U, 48U})
+	{
+		ASSERT_EQ(map.insert(key, key + 1), wfc::operation_result::success);
+	}
+	ASSERT_EQ(map.insert(32, 0), wfc::operation_result::already_present);
+
+	wfc::structure_report report = map.structure_stats();
+	ASSERT_EQ(report.arraynodes, 2);
+	ASSERT_EQ(report.compact_arraynodes, 1);
+	ASSERT_EQ(report.datanodes, 4);
+	ASSERT_EQ(report.slots, 20);
+	ASSERT_EQ(report.levels[1].slots, 4);
+
+	for (std::size_t key: {0U, 16U, 32U, 48U})
+	{
+		ASSERT_EQ(map.get(key).value(), key + 1);
+	}
+	ASSERT_FALSE(map.get(64).has_value());
+	ASSERT_EQ(map.size(), 4);
+}
+
+TEST(WaitFreeHashMapCompactArraynode, Promotion)
+{
+	// A fifth datanode exceeds the capacity of the compact arraynode.
+	map_t full(wfc::fanout_schedule{4, 3});
+	full.enable_compact_arraynodes();
+	for (std::size_t key: {0U, 16U, 32U, 48U, 64U})
+	{
+		ASSERT_EQ(full.insert(key, key), wfc::operation_result::success);
+	}
+
+	wfc::structure_report report = full.structure_stats();
+	ASSERT_EQ(report.compact_arraynodes, 0);
+	ASSERT_EQ(report.levels[1].slots, 8);
+	ASSERT_EQ(report.levels[1].datanodes, 5);
+
+	// 128 needs the position of 0, which a compact arraynode can't expand.
+	map_t collision(wfc::fanout_schedule{4, 3});
+	collision.enable_compact_arraynodes();
+	for (std::size_t key: {0U, 16U, 128U})
+	{
+		ASSERT_EQ(collision.insert(key, key), wfc::operation_result::success);
+	}
+
+	report = collision.structure_stats();
+	ASSERT_EQ(report.levels[1].slots, 8);
+	ASSERT_EQ(report.levels[1].datanodes, 1);
+	ASSERT_EQ(report.levels[2].datanodes, 2);
+	ASSERT_EQ(report.levels[2].arraynodes, 1);
+	ASSERT_EQ(report.compact_arraynodes, 1);
+	for (std::size_t key: {0U, 16U, 128U})
+	{
+		ASSERT_EQ(collision.get(key).value(), key);
+	}
+}
+
+TEST(WaitFreeHashMapCompactArraynode, UpdateAndRemove)
+{
+	map_t map(wfc::fanout_schedule{4, 3});
+	map.enable_compact_arraynodes();
+	for (std::size_t key: {0U, 16U, 32U})
+	{
+		map.insert(key, key);
+	}
+
+	ASSERT_EQ(map.update(16, 160), wfc::operation_result::success);
+	ASSERT_EQ(map.update(16, 0, 1), wfc::operation_result::expected_value_mismatch);
+	ASSERT_EQ(map.update(48, 0), wfc::operation_result::element_not_found);
+	ASSERT_EQ(map.get(16).value(), 160);
+
+	ASSERT_EQ(map.remove(32, 1), wfc::operation_result::expected_value_mismatch);
+	ASSERT_EQ(map.remove(32), wfc::operation_result::success);
+	ASSERT_EQ(map.remove(32), wfc::operation_result::element_not_found);
+	ASSERT_FALSE(map.get(32).has_value());
+	ASSERT_EQ(map.size(), 2);
+
+	ASSERT_EQ(map.remove(0), wfc::operation_result::success);
+	ASSERT_EQ(map.remove(16), wfc::operation_result::success);
+	wfc::structure_report report = map.structure_stats();
+	ASSERT_EQ(report.compact_arraynodes, 1);
+	ASSERT_EQ(report.empty_arraynodes, 1);
+	ASSERT_EQ(report.datanodes, 0);
+
+	// The empty compact arraynode takes new datanodes.
+	ASSERT_EQ(map.insert(48, 48), wfc::operation_result::success);
+	ASSERT_EQ(map.get(48).value(), 48);
+}
+
+TEST(WaitFreeHashMapCompactArraynode, Visits)
+{
+	map_t map(wfc::fanout_schedule{4, 3});
+	map.enable_compact_arraynodes();
+	std::set<std::size_t> expected;
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		expected.insert(spread(i) & 0xFFFFU);
+		map.insert(spread(i) & 0xFFFFU, i);
+	}
+
+	std::set<std::size_t> visited;
+	map.visit([&visited](std::pair<std::size_t, std::size_t> p) { visited.insert(p.first); });
+	ASSERT_EQ(visited, expected);
+
+	visited.clear();
+	for (std::size_t bucket = 0; bucket < map.head_size(); ++bucket)
+	{
+		map.visit_bucket(bucket, [&visited](const std::size_t& key, const std::size_t&) { visited.insert(key); });
+	}
+	ASSERT_EQ(visited, expected);
+	ASSERT_GT(map.structure_stats().compact_arraynodes, 0);
+}
+
+TEST(WaitFreeHashMapCompactArraynode, OrderedVisits)
+{
+	map_t map(wfc::fanout_schedule({4, 3}, wfc::bit_order::msb_first));
+	map.enable_compact_arraynodes();
+
+	std::mt19937_64 rng(7);
+	std::set<std::size_t> expected;
+	for (std::size_t i = 0; i < 3000; ++i)
+	{
+		std::size_t key = rng();
+		expected.insert(key);
+		map.insert(key, key);
+	}
+	ASSERT_GT(map.structure_stats().compact_arraynodes, 0);
+
+	std::vector<std::size_t> visited;
+	map.visit_range(0, std::numeric_limits<std::size_t>::max(), [&visited](std::pair<std::size_t, std::size_t> p) {
+		visited.push_back(p.first);
+	});
+	ASSERT_EQ(visited, std::vector<std::size_t>(expected.begin(), expected.end()));
+
+	std::size_t lo = *std::next(expected.begin(), 100);
+	std::size_t hi = *std::next(expected.begin(), 200);
+	visited.clear();
+	map.visit_range(lo, hi, [&visited](std::pair<std::size_t, std::size_t> p) { visited.push_back(p.first); });
+	ASSERT_EQ(visited, std::vector<std::size_t>(expected.find(lo), std::next(expected.find(hi))));
+
+	visited.clear();
+	map_t::range_cursor cursor = map.lower_bound(lo);
+	while (auto p = cursor.next())
+	{
+		visited.push_back(p->first);
+	}
+	ASSERT_EQ(visited, std::vector<std::size_t>(expected.find(lo), expected.end()));
+}
+
+TEST(WaitFreeHashMapCompactArraynode, AtomicUpdate)
+{
+	map_t map(wfc::fanout_schedule{4, 3});
+	map.enable_compact_arraynodes();
+	for (std::size_t key: {0U, 16U, 32U, 1U})
+	{
+		map.insert(key, key);
+	}
+
+	ASSERT_EQ(map.atomic_update({0, 32, 1},
+	                            [](std::vector<std::size_t>& values) {
+		                            for (std::size_t& value: values)
+		                            {
+			                            value += 100;
+		                            }
+		                            return true;
+	                            }),
+	          wfc::operation_result::success);
+
+	ASSERT_EQ(map.get(0).value(), 100);
+	ASSERT_EQ(map.get(16).value(), 16);
+	ASSERT_EQ(map.get(32).value(), 132);
+	ASSERT_EQ(map.get(1).value(), 101);
+	ASSERT_EQ(map.structure_stats().compact_arraynodes, 0);
+}
+
+TEST(WaitFreeHashMapCompactArraynode, FrozenAndSnapshot)
+{
+	map_t map(wfc::fanout_schedule{4, 3});
+	map.enable_compact_arraynodes();
+	for (std::size_t i = 0; i < 2000; ++i)
+	{
+		map.insert(spread(i), i);
+	}
+	ASSERT_GT(map.structure_stats().compact_arraynodes, 0);
+
+	wfc::frozen_map<std::size_t, std::size_t> frozen(map);
+	for (std::size_t i = 0; i < 2000; ++i)
+	{
+		ASSERT_EQ(frozen.get(spread(i)).value(), i);
+	}
+	ASSERT_FALSE(frozen.contains(spread(2000)));
+
+	std::stringstream ss;
+	ASSERT_EQ(map.save(ss), 2000);
+
+	map_t loaded(wfc::fanout_schedule{4, 3});
+	loaded.enable_compact_arraynodes();
+	ASSERT_EQ(loaded.load(ss), 2000);
+	ASSERT_GT(loaded.structure_stats().compact_arraynodes, 0);
+	for (std::size_t i = 0; i < 2000; ++i)
+	{
+		ASSERT_EQ(loaded.get(spread(i)).value(), i);
+	}
+}
+
+TEST(WaitFreeHashMapCompactArraynode, SavesMemory)
+{
+	map_t full(wfc::fanout_schedule{8, 5});
+	map_t compact(wfc::fanout_schedule{8, 5});
+	compact.enable_compact_arraynodes();
+	for (std::size_t i = 0; i < 10000; ++i)
+	{
+		full.insert(spread(i), i);
+		compact.insert(spread(i), i);
+	}
+
+	wfc::structure_report full_report = full.structure_stats();
+	wfc::structure_report compact_report = compact.structure_stats();
+	ASSERT_EQ(compact_report.datanodes, full_report.datanodes);
+	ASSERT_GT(compact_report.compact_arraynodes, 0);
+	ASSERT_LT(compact_report.bytes, full_report.bytes);
+}
+
+TEST(WaitFreeHashMapCompactArraynode, Concurrent)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t keys_per_thread = 500;
+
+	// Keys of small range so that threads keep copying and promoting the same compact arraynodes.
+	// The calling thread walks the structure meanwhile.
+	map_t map(wfc::fanout_schedule{4, 3}, nbr_threads + 1, 65535);
+	map.enable_compact_arraynodes();
+
+	std::atomic<bool> start{false};
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, &start, t]() {
+			while (!start.load())
+			{
+			}
+
+			for (std::size_t i = 0; i < keys_per_thread; ++i)
+			{
+				std::size_t key = (i * nbr_threads + t) << 4U;
+				ASSERT_EQ(map.insert(key, i), wfc::operation_result::success);
+				ASSERT_EQ(map.update(key, i + 1, i), wfc::operation_result::success);
+				ASSERT_EQ(map.get(key).value(), i + 1);
+				if (i % 2 == 0)
+				{
+					ASSERT_EQ(map.remove(key), wfc::operation_result::success);
+				}
+				map.visit_bucket(0, [](const std::size_t&, const std::size_t&) {});
+			}
+		});
+	}
+	start.store(true);
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		ASSERT_LE(map.structure_stats().datanodes, nbr_threads * keys_per_thread);
+	}
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+
+	ASSERT_EQ(map.size(), nbr_threads * keys_per_thread / 2);
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		for (std::size_t i = 0; i < keys_per_thread; ++i)
+		{
+			std::size_t key = (i * nbr_threads + t) << 4U;
+			if (i % 2 == 0)
+			{
+				ASSERT_FALSE(map.get(key).has_value());
+			}
+			else
+			{
+				ASSERT_EQ(map.get(key).value(), i + 1);
+			}
+		}
+	}
+}
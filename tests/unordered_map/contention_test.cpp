@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+namespace
+{
+	constexpr std::size_t nbr_threads = 8;
+	constexpr std::size_t nbr_keys = 64;
+	constexpr std::size_t nbr_updates = 500;
+} // namespace
+
+class ContentionPolicyTest: public ::testing::TestWithParam<wfc::backoff_policy>
+{
+};
+
+TEST_P(ContentionPolicyTest, BackoffKeepsOperationsCorrect)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(2, 4, 65535);
+	map.set_contention_policy({GetParam(), 64, false});
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, t]() {
+			for (std::size_t i = 0; i < nbr_updates; ++i)
+			{
+				std::size_t key = (i + t) % nbr_keys;
+				map.insert(key, t);
+				map.update(key, t);
+				ASSERT_TRUE(map.get(key).has_value());
+			}
+		});
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+
+	ASSERT_EQ(map.size(), nbr_keys);
+	map.visit([](std::pair<std::size_t, std::size_t> p) { ASSERT_LT(p.second, nbr_threads); });
+}
+
+INSTANTIATE_TEST_SUITE_P(Policies,
+                         ContentionPolicyTest,
+                         ::testing::Values(wfc::backoff_policy::none,
+                                           wfc::backoff_policy::exponential,
+                                           wfc::backoff_policy::proportional));
+
+TEST(ContentionPolicy, CombiningKeepsOperationsCorrect)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4, 4, 65535);
+	map.set_contention_policy({wfc::backoff_policy::exponential, 64, true});
+	map.insert(0, 0);
+	map.insert(1, 0);
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, t]() {
+			for (std::size_t i = 0; i < nbr_updates; ++i)
+			{
+				map.update(0, t * nbr_updates + i);
+			}
+		});
+	}
+
+	// Conditional updates are never combined: each of them either finds its expected value or fails.
+	std::size_t conditional_successes = 0;
+	for (std::size_t i = 0; i < nbr_updates; ++i)
+	{
+		if (succeeded(map.update(1, i + 1, i)))
+		{
+			++conditional_successes;
+		}
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+
+	ASSERT_EQ(conditional_successes, nbr_updates);
+	ASSERT_EQ(map.get(1), nbr_updates);
+	ASSERT_LT(map.get(0), nbr_threads * nbr_updates);
+	ASSERT_EQ(map.size(), 2);
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+namespace
+{
+	using map_t = wfc::unordered_map<std::size_t, std::size_t>;
+
+	std::size_t spread(std::size_t i) noexcept
+	{
+		i = (i ^ (i >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+		i = (i ^ (i >> 27U)) * 0x94D049BB133111EBULL;
+		return i ^ (i >> 31U);
+	}
+} // namespace
+
+TEST(WaitFreeHashMapEraseIf, RemovesMatchingElements)
+{
+	map_t map(wfc::fanout_schedule{4, 2});
+	for (std::size_t i = 0; i < 5000; ++i)
+	{
+		map.insert(spread(i), i);
+	}
+
+	// More removed datanodes than a batch.
+	ASSERT_EQ(map.erase_if([](const std::size_t&, const std::size_t& value) { return value % 3 == 0; }), 1667);
+	ASSERT_EQ(map.size(), 3333);
+	for (std::size_t i = 0; i < 5000; ++i)
+	{
+		ASSERT_EQ(map.get(spread(i)).has_value(), i % 3 != 0);
+	}
+	ASSERT_EQ(map.structure_stats().datanodes, 3333);
+
+	ASSERT_EQ(map.erase_if([](const std::size_t&, const std::size_t& value) { return value % 3 == 0; }), 0);
+	ASSERT_EQ(map.erase_if([](const std::size_t&, const std::size_t&) { return true; }), 3333);
+	ASSERT_TRUE(map.is_empty());
+	ASSERT_EQ(map.erase_if([](const std::size_t&, const std::size_t&) { return true; }), 0);
+}
+
+TEST(WaitFreeHashMapEraseIf, RecordsChanges)
+{
+	map_t map(4);
+	map.enable_change_log(256);
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		map.insert(i, i);
+	}
+	map.drain_changes([](const auto&) {});
+
+	ASSERT_EQ(map.erase_if([](const std::size_t& key, const std::size_t&) { return key >= 90; }), 10);
+
+	std::set<std::size_t> removed;
+	ASSERT_EQ(map.drain_changes([&removed](const wfc::change_record<std::size_t, std::size_t>& record) {
+		ASSERT_EQ(record.type, wfc::change_type::remove);
+		removed.insert(record.key);
+	}),
+	          10);
+	ASSERT_EQ(removed.size(), 10);
+	ASSERT_EQ(*removed.begin(), 90);
+}
+
+TEST(WaitFreeHashMapEraseIf, CompactArraynodes)
+{
+	map_t map(wfc::fanout_schedule{4, 3});
+	map.enable_compact_arraynodes();
+	for (std::size_t i = 0; i < 3000; ++i)
+	{
+		map.insert(spread(i) & 0xFFFFFU, i);
+	}
+	std::size_t size = map.size();
+	std::size_t before = map.structure_stats().compact_arraynodes;
+	ASSERT_GT(before, 0);
+
+	// Only the compact arraynodes holding a removed element are promoted.
+	std::size_t erased = map.erase_if([](const std::size_t& key, const std::size_t&) { return key < 0x100U; });
+	ASSERT_GT(erased, 0);
+	ASSERT_EQ(map.size(), size - erased);
+	ASSERT_GT(map.structure_stats().compact_arraynodes, before / 2);
+	for (std::size_t i = 0; i < 3000; ++i)
+	{
+		std::size_t key = spread(i) & 0xFFFFFU;
+		ASSERT_EQ(map.get(key).has_value(), key >= 0x100U);
+	}
+}
+
+TEST(WaitFreeHashMapEraseIf, Combining)
+{
+	map_t map(4);
+	map.set_contention_policy({wfc::backoff_policy::none, 0, true});
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(i, i);
+		map.update(i, i + 1);
+	}
+
+	ASSERT_EQ(map.erase_if([](const std::size_t& key, const std::size_t&) { return key % 2 == 0; }), 500);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		ASSERT_EQ(map.get(i).has_value(), i % 2 == 1);
+		ASSERT_EQ(map.update(i, i), i % 2 == 1 ? wfc::operation_result::success
+		                                       : wfc::operation_result::element_not_found);
+	}
+}
+
+TEST(WaitFreeHashMapEraseIf, ParallelWithConcurrentWriters)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t nbr_keys = 2000;
+
+	map_t map(wfc::fanout_schedule{6, 3}, nbr_threads + 2);
+	for (std::size_t i = 0; i < nbr_keys; ++i)
+	{
+		map.insert(3 * i, i);
+	}
+
+	// Keys which aren't multiples of 3 are inserted, read and removed meanwhile, never matching the predicate.
+	std::atomic<bool> erased{false};
+	std::thread writer([&map, &erased]() {
+		for (std::size_t i = 0; !erased.load() || i < nbr_keys; ++i)
+		{
+			std::size_t key = 3 * (i % nbr_keys) + 1;
+			map.insert(key, 1);
+			map.insert(key + 1, 1);
+			map.get(key);
+			map.remove(key);
+		}
+	});
+
+	ASSERT_EQ(map.erase_if([](const std::size_t& key, const std::size_t&) { return key % 6 == 0; }, nbr_threads),
+	          nbr_keys / 2);
+	erased.store(true);
+	writer.join();
+
+	for (std::size_t i = 0; i < nbr_keys; ++i)
+	{
+		ASSERT_EQ(map.get(3 * i).has_value(), i % 2 == 1);
+		ASSERT_FALSE(map.get(3 * i + 1).has_value());
+		ASSERT_TRUE(map.get(3 * i + 2).has_value());
+	}
+	ASSERT_EQ(map.size(), nbr_keys / 2 + nbr_keys);
+}
+
+TEST(WaitFreeHashMapEraseIf, RepeatedParallelErasures)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t nbr_keys = 800;
+
+	// Each erasure runs on the calling thread and threads joined before returning, so the ids stay below 4.
+	map_t map(16, 4, nbr_threads);
+	for (std::size_t i = 0; i < nbr_keys; ++i)
+	{
+		map.insert(spread(i), i);
+	}
+
+	for (std::size_t round = 0; round < 8; ++round)
+	{
+		auto pred = [round](const std::size_t&, const std::size_t& value) { return value % 8 == round; };
+		ASSERT_EQ(map.erase_if(pred, nbr_threads), nbr_keys / 8);
+		ASSERT_EQ(map.size(), nbr_keys - (round + 1) * nbr_keys / 8);
+	}
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <wfc/expiring_map.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(ExpiringMap, ExpiredElementsAreAbsent)
+{
+	wfc::expiring_map<std::size_t, std::size_t> map(4);
+
+	ASSERT_EQ(map.insert(1, 10, 1h), wfc::operation_result::success);
+	ASSERT_EQ(map.insert(2, 20, 0s), wfc::operation_result::success);
+	ASSERT_EQ(map.get(1), 10);
+	ASSERT_FALSE(map.get(2).has_value());
+	ASSERT_EQ(map.size(), 2);
+
+	// Looking for the expired element reclaims it.
+	ASSERT_EQ(map.update(2, 21, 1h), wfc::operation_result::element_not_found);
+	ASSERT_EQ(map.size(), 1);
+	ASSERT_EQ(map.remove(2), wfc::operation_result::element_not_found);
+
+	ASSERT_EQ(map.update(1, 11, 0s), wfc::operation_result::success);
+	ASSERT_FALSE(map.get(1).has_value());
+	ASSERT_EQ(map.remove(1), wfc::operation_result::element_not_found);
+	ASSERT_TRUE(map.is_empty());
+}
+
+TEST(ExpiringMap, InsertReplacesExpiredElements)
+{
+	wfc::expiring_map<std::size_t, std::size_t> map(4);
+
+	ASSERT_EQ(map.insert(1, 10, 0s), wfc::operation_result::success);
+	ASSERT_EQ(map.insert(1, 11, 1h), wfc::operation_result::success);
+	ASSERT_EQ(map.get(1), 11);
+	ASSERT_EQ(map.insert(1, 12, 1h), wfc::operation_result::already_present);
+	ASSERT_EQ(map.size(), 1);
+
+	// 17 lands in the head slot of 1, which isn't expanded once 1 is expired.
+	ASSERT_EQ(map.update(1, 11, 0s), wfc::operation_result::success);
+	ASSERT_EQ(map.insert(17, 170, 1h), wfc::operation_result::success);
+	ASSERT_EQ(map.get(17), 170);
+	ASSERT_FALSE(map.get(1).has_value());
+	ASSERT_EQ(map.size(), 1);
+}
+
+TEST(ExpiringMap, Sweep)
+{
+	wfc::expiring_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(i, i, i % 2 == 0 ? 100ms : 1h);
+	}
+	ASSERT_EQ(map.size(), 1000);
+	std::this_thread::sleep_for(100ms);
+
+	ASSERT_EQ(map.sweep(), 500);
+	ASSERT_EQ(map.size(), 500);
+	ASSERT_EQ(map.sweep(), 0);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		ASSERT_EQ(map.get(i).has_value(), i % 2 == 1);
+	}
+}
+
+TEST(ExpiringMap, PlainMapsHaveNothingToPurge)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(1, 1);
+	ASSERT_EQ(map.purge_expired(1), 0);
+	ASSERT_EQ(map.size(), 1);
+}
+
+TEST(ExpiringMap, ConcurrentSweeper)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t keys = 4096;
+
+	wfc::expiring_map<std::size_t, std::size_t> map(4, nbr_threads + 1, 65535);
+	std::atomic<bool> done{false};
+
+	std::thread sweeper([&map, &done]() {
+		while (!done.load())
+		{
+			map.sweep_step();
+		}
+	});
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, t]() {
+			for (std::size_t i = 0; i < 5000; ++i)
+			{
+				std::size_t key = (i * 31 + t) % keys;
+				// Odd keys never expire, even ones expire right away.
+				map.insert(key, key, key % 2 == 0 ? 0s : 1h);
+				std::optional<std::size_t> value = map.get(key);
+				ASSERT_EQ(value.has_value(), key % 2 == 1);
+			}
+		});
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+	done = true;
+	sweeper.join();
+
+	map.sweep();
+	std::size_t present = 0;
+	for (std::size_t key = 0; key < keys; ++key)
+	{
+		present += map.get(key).has_value() ? 1U : 0U;
+	}
+	ASSERT_EQ(map.size(), present);
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+TEST(WaitFreeHashMapFanoutSchedule, InvalidSchedules)
+{
+	ASSERT_THROW(wfc::fanout_schedule({}), std::runtime_error);
+	ASSERT_THROW(wfc::fanout_schedule({8, 0}), std::runtime_error);
+	ASSERT_THROW(wfc::fanout_schedule({8, 33}), std::runtime_error);
+	using map_t = wfc::unordered_map<std::size_t, std::size_t>;
+	ASSERT_THROW(map_t(3), std::runtime_error);
+}
+
+TEST(WaitFreeHashMapFanoutSchedule, LastLevelRepeats)
+{
+	wfc::fanout_schedule schedule{16, 6, 3};
+
+	ASSERT_EQ(schedule.bits_at(0), 16);
+	ASSERT_EQ(schedule.bits_at(1), 6);
+	ASSERT_EQ(schedule.bits_at(2), 3);
+	ASSERT_EQ(schedule.bits_at(10), 3);
+}
+
+TEST(WaitFreeHashMapFanoutSchedule, WideHeadNarrowLeaves)
+{
+	// Keys sharing their 16 low bits collide in the head and go through the narrower levels.
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{16, 6, 6, 3});
+
+	for (std::size_t i = 1; i <= 1000; ++i)
+	{
+		ASSERT_EQ(map.insert(i << 16U, i), wfc::operation_result::success);
+		ASSERT_EQ(map.insert(i, i), wfc::operation_result::success);
+	}
+	ASSERT_EQ(map.size(), 2000);
+
+	for (std::size_t i = 1; i <= 1000; ++i)
+	{
+		ASSERT_EQ(map.get(i << 16U).value(), i);
+		ASSERT_EQ(map.update(i << 16U, i + 1), wfc::operation_result::success);
+	}
+
+	std::size_t sum = 0;
+	map.visit([&sum](std::pair<const std::size_t, std::size_t> p) { sum += p.second; });
+	ASSERT_EQ(sum, 1000 * 1001 / 2 + 1000 * 1003 / 2);
+
+	for (std::size_t i = 1; i <= 1000; ++i)
+	{
+		ASSERT_EQ(map.remove(i << 16U), wfc::operation_result::success);
+		ASSERT_FALSE(map.get(i << 16U).has_value());
+	}
+}
+
+TEST(WaitFreeHashMapFanoutSchedule, LevelsNotDividingHashSize)
+{
+	// 5 + 3 * 19 + 2 bits: the last level is truncated.
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{5, 3});
+
+	const std::size_t top = std::size_t{1} << 63U;
+	ASSERT_EQ(map.insert(0, 0), wfc::operation_result::success);
+	ASSERT_EQ(map.insert(top, 1), wfc::operation_result::success);
+	ASSERT_EQ(map.insert(top >> 1U, 2), wfc::operation_result::success);
+	ASSERT_EQ(map.insert(top, 3), wfc::operation_result::already_present);
+
+	ASSERT_EQ(map.get(0).value(), 0);
+	ASSERT_EQ(map.get(top).value(), 1);
+	ASSERT_EQ(map.get(top >> 1U).value(), 2);
+
+	ASSERT_EQ(map.remove(top), wfc::operation_result::success);
+	ASSERT_FALSE(map.get(top).has_value());
+	ASSERT_EQ(map.get(top >> 1U).value(), 2);
+}
+
+TEST(WaitFreeHashMapFanoutSchedule, ConcurrentInsertions)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t per_thread = 2000;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{2, 1}, 1, 65535);
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, t]() {
+			for (std::size_t i = 0; i < per_thread; ++i)
+			{
+				map.insert(i * nbr_threads + t, t);
+			}
+		});
+	}
+
+	for (auto& t: threads)
+	{
+		t.join();
+	}
+
+	ASSERT_EQ(map.size(), nbr_threads * per_thread);
+	for (std::size_t k = 0; k < nbr_threads * per_thread; ++k)
+	{
+		ASSERT_EQ(map.get(k).value(), k % nbr_threads);
+	}
+}
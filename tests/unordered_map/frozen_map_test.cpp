@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/frozen_map.hpp>
+
+TEST(FrozenMap, FindsEveryElement)
+{
+	wfc::unordered_map<std::size_t, std::string> map(wfc::fanout_schedule{4, 2});
+	for (std::size_t i = 0; i < 2000; ++i)
+	{
+		// Strided keys share their low bits and go deep into the trie.
+		map.insert(i % 2 == 0 ? i : i << 20U, std::to_string(i));
+	}
+
+	wfc::frozen_map<std::size_t, std::string> frozen(map);
+	ASSERT_EQ(frozen.size(), map.size());
+	ASSERT_GT(frozen.memory_bytes(), 0);
+
+	for (std::size_t i = 0; i < 2000; ++i)
+	{
+		std::size_t key = i % 2 == 0 ? i : i << 20U;
+		ASSERT_EQ(frozen.get(key), std::to_string(i));
+		ASSERT_TRUE(frozen.contains(key));
+		ASSERT_FALSE(frozen.contains(key + 1));
+	}
+	ASSERT_EQ(frozen.find(1), nullptr);
+
+	std::size_t visited = 0;
+	frozen.visit([&visited, &frozen](std::pair<std::size_t, std::string> p) {
+		ASSERT_EQ(*frozen.find(p.first), p.second);
+		++visited;
+	});
+	ASSERT_EQ(visited, frozen.size());
+}
+
+TEST(FrozenMap, EmptyMap)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	wfc::frozen_map<std::size_t, std::size_t> frozen(map);
+
+	ASSERT_TRUE(frozen.is_empty());
+	ASSERT_FALSE(frozen.get(0).has_value());
+}
+
+TEST(FrozenMap, ConcurrentReads)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t nbr_keys = 10000;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule({8, 4}, wfc::bit_order::msb_first));
+	for (std::size_t i = 0; i < nbr_keys; ++i)
+	{
+		map.insert(i * 0x9E3779B97F4A7C15ULL, i);
+	}
+	const wfc::frozen_map<std::size_t, std::size_t> frozen(map);
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&frozen]() {
+			for (std::size_t i = 0; i < nbr_keys; ++i)
+			{
+				ASSERT_EQ(frozen.get(i * 0x9E3779B97F4A7C15ULL), i);
+			}
+		});
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+}
+
+TEST(FrozenMap, ThawIntoAnotherLayout)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(i, 2 * i);
+	}
+	wfc::frozen_map<std::size_t, std::size_t> frozen(map);
+
+	wfc::unordered_map<std::size_t, std::size_t> thawed(wfc::fanout_schedule{8, 3});
+	thawed.insert(0, 42);
+	ASSERT_EQ(frozen.thaw(thawed), 999);
+	ASSERT_EQ(thawed.size(), 1000);
+	ASSERT_EQ(thawed.get(0), 42);
+	ASSERT_EQ(thawed.get(999), 1998);
+
+	ASSERT_EQ(thawed.update(1, 3), wfc::operation_result::success);
+	ASSERT_EQ(thawed.remove(2), wfc::operation_result::success);
+	ASSERT_EQ(frozen.get(1), 2);
+	ASSERT_EQ(frozen.get(2), 4);
+}
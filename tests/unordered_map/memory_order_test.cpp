@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+// Datanodes, arraynodes and descriptors are published with release operations and read with acquire ones.
+// Readers check that every value they get was fully written, which is mostly useful under ThreadSanitizer.
+namespace
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t nbr_keys = 32;
+	constexpr std::size_t nbr_rounds = 3000;
+
+	// Keys share their low bits, so that they collide in the head and arraynodes are expanded concurrently.
+	std::size_t key_of(std::size_t i) noexcept
+	{
+		return i << 8U;
+	}
+
+	std::string value_of(std::size_t key, std::size_t version)
+	{
+		return std::to_string(key) + ':' + std::to_string(version);
+	}
+
+	bool is_value_of(std::size_t key, const std::string& value)
+	{
+		std::string prefix = std::to_string(key) + ':';
+		return value.compare(0, prefix.size(), prefix) == 0;
+	}
+
+	void stress(wfc::unordered_map<std::size_t, std::string>& map, std::size_t t)
+	{
+		for (std::size_t round = 0; round < nbr_rounds; ++round)
+		{
+			std::size_t key = key_of((round * 7 + t) % nbr_keys);
+			switch ((round + t) % 4)
+			{
+				case 0:
+					map.insert(key, value_of(key, round));
+					break;
+				case 1:
+					map.update(key, value_of(key, round));
+					break;
+				case 2:
+					map.remove(key);
+					break;
+				default:
+				{
+					std::size_t other = key_of((round * 7 + t + 1) % nbr_keys);
+					map.atomic_update({key, other}, [key, other, round](std::vector<std::string>& values) {
+						EXPECT_TRUE(is_value_of(key, values[0]));
+						EXPECT_TRUE(is_value_of(other, values[1]));
+						values[0] = value_of(key, round);
+						values[1] = value_of(other, round);
+						return true;
+					});
+					break;
+				}
+			}
+
+			for (std::size_t i = 0; i < nbr_keys; i += 5)
+			{
+				map.visit_value(key_of(i), [i](const std::string& value) { ASSERT_TRUE(is_value_of(key_of(i), value)); });
+			}
+		}
+	}
+
+	void run_stress(wfc::unordered_map<std::size_t, std::string>& map)
+	{
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < nbr_threads; ++t)
+		{
+			threads.emplace_back([&map, t]() { stress(map, t); });
+		}
+
+		for (std::thread& thread: threads)
+		{
+			thread.join();
+		}
+
+		std::size_t visited = 0;
+		map.visit([&visited](std::pair<std::size_t, std::string> p) {
+			ASSERT_TRUE(is_value_of(p.first, p.second));
+			++visited;
+		});
+		ASSERT_EQ(visited, map.size());
+	}
+} // namespace
+
+class MemoryOrderStressTest: public ::testing::TestWithParam<bool>
+{
+};
+
+TEST_P(MemoryOrderStressTest, ValuesAreFullyPublished)
+{
+	wfc::unordered_map<std::size_t, std::string> map(2, 2, 65535);
+	map.set_contention_policy({wfc::backoff_policy::none, 64, GetParam()});
+
+	run_stress(map);
+}
+
+TEST_P(MemoryOrderStressTest, ValuesAreFullyPublishedWithAsymmetricFences)
+{
+	wfc::unordered_map<std::size_t, std::string> map(2, 2, 65535);
+	map.set_contention_policy({wfc::backoff_policy::none, 64, GetParam()});
+	if (!map.set_hazard_fence_mode(wfc::hazard_fence_mode::asymmetric))
+	{
+		GTEST_SKIP() << "membarrier isn't supported";
+	}
+
+	run_stress(map);
+}
+
+INSTANTIATE_TEST_SUITE_P(Combining, MemoryOrderStressTest, ::testing::Bool());
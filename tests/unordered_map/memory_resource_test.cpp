@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+#include <wfc/unordered_set.hpp>
+
+namespace
+{
+	class counting_resource : public wfc::memory_resource
+	{
+	public:
+		std::atomic<std::size_t> allocated_bytes{0};
+		std::atomic<std::size_t> deallocated_bytes{0};
+
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			allocated_bytes += bytes;
+			return wfc::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept override
+		{
+			deallocated_bytes += bytes;
+			wfc::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+	};
+
+	class locked_monotonic_resource : public std::pmr::memory_resource
+	{
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_upstream.allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_upstream.deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+		std::mutex m_mutex;
+		std::pmr::monotonic_buffer_resource m_upstream;
+	};
+} // namespace
+
+TEST(WaitFreeHashMapMemoryResource, NullResourceThrows)
+{
+	using map_t = wfc::unordered_map<std::size_t, std::size_t>;
+	wfc::memory_resource* null_resource = nullptr;
+	ASSERT_THROW(map_t(4, 8, 8, null_resource), std::runtime_error);
+}
+
+TEST(WaitFreeHashMapMemoryResource, EveryNodeGoesBackToTheResource)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t per_thread = 1000;
+
+	counting_resource resource;
+	{
+		wfc::unordered_map<std::size_t, std::string> map(2, nbr_threads, 65535, &resource);
+
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < nbr_threads; ++t)
+		{
+			threads.emplace_back([&map, t]() {
+				for (std::size_t i = t * per_thread, n = (t + 1) * per_thread; i < n; ++i)
+				{
+					ASSERT_EQ(map.insert(i, std::to_string(i)), wfc::operation_result::success);
+					ASSERT_EQ(map.update(i, std::to_string(2 * i)), wfc::operation_result::success);
+					if (i % 2 == 0)
+					{
+						ASSERT_EQ(map.remove(i), wfc::operation_result::success);
+					}
+				}
+			});
+		}
+
+		for (auto& t: threads)
+		{
+			t.join();
+		}
+
+		ASSERT_EQ(map.size(), nbr_threads * per_thread / 2);
+		ASSERT_EQ(map.get(1), std::to_string(2));
+		ASSERT_GT(resource.allocated_bytes.load(), resource.deallocated_bytes.load());
+	}
+	ASSERT_GT(resource.allocated_bytes.load(), 0);
+	ASSERT_EQ(resource.allocated_bytes.load(), resource.deallocated_bytes.load());
+}
+
+TEST(WaitFreeHashMapMemoryResource, PmrMonotonicBuffer)
+{
+	locked_monotonic_resource upstream;
+	wfc::pmr_resource resource(&upstream);
+
+	wfc::unordered_set<std::size_t> set(4, 8, 8, &resource);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		ASSERT_EQ(set.insert(i), wfc::operation_result::success);
+	}
+	for (std::size_t i = 0; i < 1000; i += 2)
+	{
+		ASSERT_EQ(set.erase(i), wfc::operation_result::success);
+	}
+
+	ASSERT_EQ(set.size(), 500);
+	ASSERT_FALSE(set.contains(0));
+	ASSERT_TRUE(set.contains(1));
+}
@@ -0,0 +1,239 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+namespace
+{
+	class counting_resource : public wfc::memory_resource
+	{
+	public:
+		std::atomic<std::size_t> allocated_bytes{0};
+		std::atomic<std::size_t> deallocated_bytes{0};
+
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			allocated_bytes += bytes;
+			return wfc::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept override
+		{
+			deallocated_bytes += bytes;
+			wfc::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+	};
+} // namespace
+
+TEST(WaitFreeHashMapMerge, DisjointSubtreesAreMovedWhole)
+{
+	counting_resource resource;
+	{
+		using map_t = wfc::unordered_map<std::size_t, std::string>;
+		map_t map(4, 8, 8, &resource);
+		map_t other(4, 8, 8, &resource);
+
+		// The head buckets of map and other don't overlap, whole subtrees of other are moved.
+		for (std::size_t i = 0; i < 1000; ++i)
+		{
+			map.insert(i * 16 + i % 8, std::to_string(i));
+			other.insert(i * 16 + 8 + i % 8, std::to_string(i));
+		}
+
+		std::size_t allocated = resource.allocated_bytes.load();
+		std::size_t deallocated = resource.deallocated_bytes.load();
+		ASSERT_EQ(map.merge(std::move(other)), 1000);
+		ASSERT_EQ(resource.allocated_bytes.load(), allocated);
+		ASSERT_EQ(resource.deallocated_bytes.load(), deallocated);
+
+		ASSERT_EQ(map.size(), 2000);
+		ASSERT_TRUE(other.is_empty());
+		for (std::size_t i = 0; i < 1000; ++i)
+		{
+			ASSERT_EQ(map.get(i * 16 + i % 8).value(), std::to_string(i));
+			ASSERT_EQ(map.get(i * 16 + 8 + i % 8).value(), std::to_string(i));
+			ASSERT_FALSE(other.get(i * 16 + 8 + i % 8).has_value());
+		}
+
+		// other stays usable.
+		ASSERT_EQ(other.insert(8, "8"), wfc::operation_result::success);
+		ASSERT_EQ(other.size(), 1);
+	}
+	ASSERT_EQ(resource.allocated_bytes.load(), resource.deallocated_bytes.load());
+}
+
+TEST(WaitFreeHashMapMerge, SharedKeysKeepTheirValue)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{4, 2});
+	wfc::unordered_map<std::size_t, std::size_t> other(wfc::fanout_schedule{4, 2});
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(i, i);
+		other.insert(i + 500, i + 500 + 10000);
+	}
+
+	ASSERT_EQ(map.merge(std::move(other)), 500);
+	ASSERT_EQ(map.size(), 1500);
+	ASSERT_EQ(other.size(), 0);
+	for (std::size_t i = 0; i < 1500; ++i)
+	{
+		ASSERT_EQ(map.get(i).value(), i < 1000 ? i : i + 10000);
+	}
+
+	wfc::structure_report report = map.structure_stats();
+	ASSERT_EQ(report.datanodes, 1500);
+	ASSERT_EQ(report.marked_slots, 0);
+}
+
+TEST(WaitFreeHashMapMerge, InterleavedSubtrees)
+{
+	// Keys of both maps share the head buckets and are only told apart a few levels below.
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{4, 2});
+	wfc::unordered_map<std::size_t, std::size_t> other(wfc::fanout_schedule{4, 2});
+	for (std::size_t i = 0; i < 4096; ++i)
+	{
+		(i % 3 == 0 ? map : other).insert(i << 2U, i);
+	}
+
+	ASSERT_EQ(map.merge(std::move(other)), 4096 - 1366);
+	ASSERT_EQ(map.size(), 4096);
+	for (std::size_t i = 0; i < 4096; ++i)
+	{
+		ASSERT_EQ(map.get(i << 2U).value(), i);
+	}
+	ASSERT_EQ(map.structure_stats().datanodes, 4096);
+}
+
+TEST(WaitFreeHashMapMerge, CopiesAcrossLayouts)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	wfc::unordered_map<std::size_t, std::size_t> other(wfc::fanout_schedule{6, 3});
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(2 * i, i);
+		other.insert(3 * i, i);
+	}
+
+	// Keys divisible by 6 are in both maps.
+	ASSERT_EQ(map.merge(std::move(other)), 1000 - 334);
+	ASSERT_EQ(map.size(), 1666);
+	ASSERT_TRUE(other.is_empty());
+	ASSERT_EQ(map.get(6).value(), 3);
+	ASSERT_EQ(map.get(9).value(), 3);
+}
+
+TEST(WaitFreeHashMapMerge, RecordsChanges)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{4, 2});
+	wfc::unordered_map<std::size_t, std::size_t> other(wfc::fanout_schedule{4, 2});
+	map.enable_change_log(256);
+	map.insert(1, 1);
+	map.drain_changes([](const auto&) {});
+
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		other.insert(i, i);
+	}
+
+	ASSERT_EQ(map.merge(std::move(other)), 99);
+
+	std::set<std::size_t> inserted;
+	ASSERT_EQ(map.drain_changes([&inserted](const wfc::change_record<std::size_t, std::size_t>& record) {
+		ASSERT_EQ(record.type, wfc::change_type::insert);
+		ASSERT_EQ(record.key, record.value);
+		inserted.insert(record.key);
+	}),
+	          99);
+	ASSERT_EQ(inserted.size(), 99);
+	ASSERT_EQ(inserted.count(1), 0);
+}
+
+TEST(WaitFreeHashMapMerge, CompactArraynodes)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{4, 3});
+	wfc::unordered_map<std::size_t, std::size_t> other(wfc::fanout_schedule{4, 3});
+	map.enable_compact_arraynodes();
+	other.enable_compact_arraynodes();
+
+	std::mt19937_64 rng(3);
+	std::set<std::size_t> expected;
+	for (std::size_t i = 0; i < 3000; ++i)
+	{
+		std::size_t key = rng() & 0xFFFFFU;
+		expected.insert(key);
+		(i % 2 == 0 ? map : other).insert(key, key);
+	}
+
+	map.merge(std::move(other));
+	ASSERT_EQ(map.size(), expected.size());
+	for (std::size_t key: expected)
+	{
+		ASSERT_EQ(map.get(key).value(), key);
+	}
+	ASSERT_EQ(map.structure_stats().datanodes, expected.size());
+}
+
+TEST(WaitFreeHashMapMerge, ParallelMergeWithConcurrentWriters)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t nbr_keys = 2000;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{6, 3}, nbr_threads + 2);
+	wfc::unordered_map<std::size_t, std::size_t> other(wfc::fanout_schedule{6, 3}, nbr_threads + 2);
+	for (std::size_t i = 0; i < nbr_keys; ++i)
+	{
+		other.insert(3 * i, i);
+	}
+
+	// Keys which aren't multiples of 3 are inserted and removed in map meanwhile.
+	std::atomic<bool> merged{false};
+	std::thread writer([&map, &merged]() {
+		for (std::size_t i = 0; !merged.load() || i < nbr_keys; ++i)
+		{
+			std::size_t key = 3 * (i % nbr_keys) + 1;
+			map.insert(key, i);
+			map.insert(key + 1, i);
+			map.remove(key);
+		}
+	});
+
+	ASSERT_EQ(map.merge(std::move(other), nbr_threads), nbr_keys);
+	merged.store(true);
+	writer.join();
+
+	for (std::size_t i = 0; i < nbr_keys; ++i)
+	{
+		ASSERT_EQ(map.get(3 * i).value(), i);
+		ASSERT_FALSE(map.get(3 * i + 1).has_value());
+		ASSERT_TRUE(map.get(3 * i + 2).has_value());
+	}
+	ASSERT_EQ(map.size(), 2 * nbr_keys);
+	ASSERT_EQ(map.structure_stats().datanodes, 2 * nbr_keys);
+}
+
+TEST(WaitFreeHashMapMerge, RepeatedParallelMerges)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t nbr_keys = 100;
+
+	// Each merge runs on the calling thread and threads joined before returning, so the ids stay below 4.
+	wfc::unordered_map<std::size_t, std::size_t> map(16, 8, nbr_threads);
+	for (std::size_t round = 0; round < 8; ++round)
+	{
+		wfc::unordered_map<std::size_t, std::size_t> other(16, 8, nbr_threads);
+		for (std::size_t i = 0; i < nbr_keys; ++i)
+		{
+			other.insert(round * nbr_keys + i, round);
+		}
+
+		ASSERT_EQ(map.merge(std::move(other), nbr_threads), nbr_keys);
+	}
+	ASSERT_EQ(map.size(), 8 * nbr_keys);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+namespace
+{
+	wfc::fanout_schedule ordered_schedule()
+	{
+		return wfc::fanout_schedule({8, 4}, wfc::bit_order::msb_first);
+	}
+} // namespace
+
+TEST(WaitFreeHashMapOrdered, RequiresOrderedMap)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+
+	ASSERT_THROW(map.visit_range(0, 10, [](auto) {}), std::runtime_error);
+	ASSERT_THROW(map.lower_bound(0), std::runtime_error);
+
+	using signed_map_t = wfc::unordered_map<int, int>;
+	ASSERT_THROW(signed_map_t{ordered_schedule()}, std::runtime_error);
+}
+
+TEST(WaitFreeHashMapOrdered, OperationsAndSortedVisit)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(ordered_schedule());
+
+	std::mt19937_64 rng(42);
+	std::set<std::size_t> expected;
+	for (std::size_t i = 0; i < 5000; ++i)
+	{
+		std::size_t key = i % 2 == 0 ? rng() : rng() % 1000;
+		expected.insert(key);
+		map.insert(key, key + 1);
+	}
+	ASSERT_EQ(map.size(), expected.size());
+
+	for (std::size_t key: expected)
+	{
+		ASSERT_EQ(map.get(key).value(), key + 1);
+	}
+
+	std::vector<std::size_t> visited;
+	map.visit_range(0, std::numeric_limits<std::size_t>::max(), [&visited](std::pair<std::size_t, std::size_t> p) {
+		visited.push_back(p.first);
+	});
+	ASSERT_EQ(visited, std::vector<std::size_t>(expected.begin(), expected.end()));
+
+	for (std::size_t key: expected)
+	{
+		ASSERT_EQ(map.remove(key), wfc::operation_result::success);
+	}
+	ASSERT_TRUE(map.is_empty());
+}
+
+TEST(WaitFreeHashMapOrdered, VisitRange)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(ordered_schedule());
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(i * 1000, i);
+	}
+
+	std::vector<std::size_t> visited;
+	map.visit_range(
+	    12500, 20000, [&visited](std::pair<std::size_t, std::size_t> p) { visited.push_back(p.first); });
+	ASSERT_EQ(visited, (std::vector<std::size_t>{13000, 14000, 15000, 16000, 17000, 18000, 19000, 20000}));
+
+	visited.clear();
+	map.visit_range(20001, 20999, [&visited](std::pair<std::size_t, std::size_t> p) { visited.push_back(p.first); });
+	ASSERT_TRUE(visited.empty());
+}
+
+TEST(WaitFreeHashMapOrdered, LowerBoundCursor)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(ordered_schedule());
+	const std::size_t max = std::numeric_limits<std::size_t>::max();
+	for (std::size_t key: {std::size_t{5}, std::size_t{10}, std::size_t{1} << 40U, max})
+	{
+		map.insert(key, key);
+	}
+
+	auto cursor = map.lower_bound(6);
+	ASSERT_EQ(cursor.next()->first, 10);
+	ASSERT_EQ(cursor.next()->first, std::size_t{1} << 40U);
+	ASSERT_EQ(cursor.next()->first, max);
+	ASSERT_FALSE(cursor.next().has_value());
+	ASSERT_FALSE(cursor.next().has_value());
+
+	ASSERT_EQ(map.lower_bound(0).next()->first, 5);
+	ASSERT_EQ(map.lower_bound(5).next()->first, 5);
+}
+
+TEST(WaitFreeHashMapOrdered, RangeScanDuringUpdates)
+{
+	constexpr std::size_t nbr_keys = 4000;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(ordered_schedule(), 4, 65535);
+	for (std::size_t i = 0; i < nbr_keys; i += 2)
+	{
+		map.insert(i, i);
+	}
+
+	std::thread writer([&map]() {
+		for (std::size_t i = 1; i < nbr_keys; i += 2)
+		{
+			map.insert(i, i);
+			map.update(i - 1, i);
+		}
+	});
+
+	for (std::size_t round = 0; round < 20; ++round)
+	{
+		std::size_t previous = 0;
+		std::size_t count = 0;
+		map.visit_range(0, nbr_keys, [&previous, &count](std::pair<std::size_t, std::size_t> p) {
+			ASSERT_TRUE(count == 0 || p.first > previous);
+			previous = p.first;
+			++count;
+		});
+		ASSERT_GE(count, nbr_keys / 2);
+	}
+
+	writer.join();
+	ASSERT_EQ(map.size(), nbr_keys);
+}
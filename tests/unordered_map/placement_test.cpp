@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+TEST(WaitFreeHashMapPlacement, HeapReportsNothing)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(1, 1);
+
+	wfc::placement_report report = map.memory_placement_report();
+	ASSERT_EQ(report.reserved_bytes, 0);
+	ASSERT_EQ(report.huge_page_bytes, 0);
+}
+
+TEST(WaitFreeHashMapPlacement, HugePages)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t per_thread = 2000;
+
+	wfc::unordered_map<std::size_t, std::string> map(8, nbr_threads, 65535, wfc::memory_placement::huge_pages);
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, t]() {
+			for (std::size_t i = t * per_thread, n = (t + 1) * per_thread; i < n; ++i)
+			{
+				ASSERT_EQ(map.insert(i, std::to_string(i)), wfc::operation_result::success);
+				ASSERT_EQ(map.update(i, std::to_string(2 * i)), wfc::operation_result::success);
+				if (i % 2 == 0)
+				{
+					ASSERT_EQ(map.remove(i), wfc::operation_result::success);
+				}
+			}
+		});
+	}
+
+	for (auto& t: threads)
+	{
+		t.join();
+	}
+
+	for (std::size_t i = 0; i < nbr_threads * per_thread; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			ASSERT_FALSE(map.get(i).has_value());
+		}
+		else
+		{
+			ASSERT_EQ(map.get(i).value(), std::to_string(2 * i));
+		}
+	}
+
+	wfc::placement_report report = map.memory_placement_report();
+	ASSERT_GT(report.reserved_bytes, 0);
+	ASSERT_LE(report.huge_page_bytes, report.reserved_bytes);
+}
+
+TEST(WaitFreeHashMapPlacement, Numa)
+{
+	constexpr std::size_t nbr_keys = 8000;
+	const std::size_t nbr_nodes = wfc::numa_node_count();
+
+	wfc::unordered_map<std::size_t, std::size_t> map(8, nbr_nodes, 65535, wfc::memory_placement::numa);
+
+	// One thread per node handles the keys owned by its node.
+	std::vector<std::thread> threads;
+	for (std::size_t node = 0; node < nbr_nodes; ++node)
+	{
+		threads.emplace_back([&map, node]() {
+			wfc::pin_current_thread_to_numa_node(node);
+
+			for (std::size_t i = 0; i < nbr_keys; ++i)
+			{
+				if (map.numa_node_of(i) == node)
+				{
+					ASSERT_EQ(map.insert(i, i), wfc::operation_result::success);
+					ASSERT_EQ(map.update(i, 2 * i), wfc::operation_result::success);
+				}
+			}
+		});
+	}
+
+	for (auto& t: threads)
+	{
+		t.join();
+	}
+
+	ASSERT_EQ(map.size(), nbr_keys);
+	for (std::size_t i = 0; i < nbr_keys; ++i)
+	{
+		ASSERT_LT(map.numa_node_of(i), nbr_nodes);
+		ASSERT_EQ(map.get(i).value(), 2 * i);
+	}
+
+	ASSERT_GT(map.memory_placement_report().reserved_bytes, 0);
+}
@@ -46,6 +46,36 @@ TEST(WaitFreeHashMap, Get)
 	ASSERT_EQ(*r, 1);
 }
 
+TEST(WaitFreeHashMap, VisitValue)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(0, 1);
+
+	std::size_t seen = 0;
+	ASSERT_TRUE(map.visit_value(0, [&seen](const std::size_t& value) { seen = value; }));
+	ASSERT_EQ(seen, 1);
+	ASSERT_FALSE(map.visit_value(16, [&seen](const std::size_t&) { seen = 0; }));
+	ASSERT_EQ(seen, 1);
+}
+
+TEST(WaitFreeHashMap, VisitBucket)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	ASSERT_EQ(map.head_size(), 16);
+	for (std::size_t i = 0; i < 64; ++i)
+	{
+		map.insert(i, i);
+	}
+
+	std::size_t count = 0;
+	map.visit_bucket(5, [&count](const std::size_t& key, const std::size_t& value) {
+		ASSERT_EQ(key % 16, 5);
+		ASSERT_EQ(key, value);
+		++count;
+	});
+	ASSERT_EQ(count, 4);
+}
+
 TEST(WaitFreeHashMap, Update)
 {
 	wfc::unordered_map<std::size_t, std::size_t> map(4);
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+namespace
+{
+	using node_t = wfc::details::node_t<std::size_t, std::size_t, std::size_t>;
+	using node_union = wfc::details::node_union<node_t>;
+	using arraynode_t = wfc::details::arraynode_t<node_t>;
+
+	// Tagged values which are never dereferenced: a datanode, a marked datanode and an arraynode.
+	node_union tagged(std::uintptr_t bits)
+	{
+		node_union node;
+		node.ptr_int = 0x1000 | bits;
+		return node;
+	}
+} // namespace
+
+TEST(WaitFreeHashMapSlotScan, MaskMatchesOccupiedSlots)
+{
+	arraynode_t array(131, wfc::new_delete_resource());
+	std::set<std::size_t> expected;
+	for (std::size_t i = 0; i < array.size(); ++i)
+	{
+		if (i % 3 == 0 || i % 7 == 1)
+		{
+			array[i].store(tagged(i % 3), std::memory_order_relaxed);
+			expected.insert(i);
+		}
+	}
+
+	// Unaligned starts and counts which aren't multiples of the vector width.
+	for (std::size_t first: {0U, 1U, 5U, 64U, 67U})
+	{
+		std::size_t count = std::min(wfc::details::slot_scan_block, array.size() - first);
+		std::uint64_t mask = wfc::details::occupied_slots(array, first, count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			ASSERT_EQ((mask >> i & 1U) != 0, expected.count(first + i) != 0) << first << ' ' << i;
+		}
+	}
+
+	std::vector<std::size_t> visited;
+	wfc::details::for_each_occupied_slot(array, 3, 130, [&visited](std::size_t i) { visited.push_back(i); });
+	ASSERT_EQ(visited, std::vector<std::size_t>(expected.lower_bound(3), expected.lower_bound(130)));
+
+	for (std::size_t i = 0; i < array.size(); ++i)
+	{
+		array[i].store(node_union{}, std::memory_order_relaxed);
+	}
+}
+
+TEST(WaitFreeHashMapSlotScan, SparseMapIsFullyVisited)
+{
+	// A wide head holding few keys, so that most blocks are empty.
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule({12, 6}));
+	std::set<std::size_t> expected;
+	for (std::size_t i = 0; i < 300; ++i)
+	{
+		std::size_t key = i * 4099 + (i % 5 == 0 ? 1U << 20U : 0U);
+		map.insert(key, key + 1);
+		expected.insert(key);
+	}
+
+	std::set<std::size_t> visited;
+	map.visit([&visited](std::pair<std::size_t, std::size_t> p) {
+		ASSERT_EQ(p.second, p.first + 1);
+		visited.insert(p.first);
+	});
+	ASSERT_EQ(visited, expected);
+
+	std::set<std::size_t> visited_by_bucket;
+	for (std::size_t bucket = 0; bucket < map.head_size(); ++bucket)
+	{
+		map.visit_bucket(bucket, [&visited_by_bucket](const std::size_t& key, const std::size_t&) {
+			visited_by_bucket.insert(key);
+		});
+	}
+	ASSERT_EQ(visited_by_bucket, expected);
+
+	wfc::structure_report report = map.structure_stats();
+	ASSERT_EQ(report.datanodes, expected.size());
+	// Every arraynode but the head occupies a slot.
+	ASSERT_EQ(report.slots - report.empty_slots, report.datanodes + report.arraynodes - 1);
+}
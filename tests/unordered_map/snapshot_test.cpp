@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_map.hpp>
+
+TEST(WaitFreeHashMapSnapshot, StreamRoundTrip)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(i * 7, i);
+	}
+
+	std::stringstream ss;
+	ASSERT_EQ(map.save(ss), 1000);
+
+	wfc::unordered_map<std::size_t, std::size_t> loaded(4);
+	ASSERT_EQ(loaded.load(ss), 1000);
+	ASSERT_EQ(loaded.size(), 1000);
+
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		ASSERT_EQ(loaded.get(i * 7).value(), i);
+	}
+}
+
+TEST(WaitFreeHashMapSnapshot, LoadSkipsPresentKeys)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(1, 1);
+	map.insert(2, 2);
+
+	std::stringstream ss;
+	map.save(ss);
+
+	wfc::unordered_map<std::size_t, std::size_t> loaded(4);
+	loaded.insert(1, 10);
+	ASSERT_EQ(loaded.load(ss), 1);
+	ASSERT_EQ(loaded.size(), 2);
+	ASSERT_EQ(loaded.get(1).value(), 10);
+	ASSERT_EQ(loaded.get(2).value(), 2);
+}
+
+TEST(WaitFreeHashMapSnapshot, ParallelFileLoad)
+{
+	const std::string path = "wfc_snapshot_test.bin";
+
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 10000; ++i)
+	{
+		map.insert(i, 2 * i);
+	}
+	ASSERT_EQ(map.save(path), 10000);
+
+	for (std::size_t nbr_threads: {1U, 3U, 8U})
+	{
+		wfc::unordered_map<std::size_t, std::size_t> loaded(4);
+		ASSERT_EQ(loaded.load(path, nbr_threads), 10000);
+		ASSERT_EQ(loaded.size(), 10000);
+
+		for (std::size_t i = 0; i < 10000; ++i)
+		{
+			ASSERT_EQ(loaded.get(i).value(), 2 * i);
+		}
+	}
+
+	// A different head size forces a sequential build.
+	wfc::unordered_map<std::size_t, std::size_t> other(8);
+	ASSERT_EQ(other.load(path, 4), 10000);
+	ASSERT_EQ(other.get(9999).value(), 2 * 9999);
+
+	std::remove(path.c_str());
+}
+
+TEST(WaitFreeHashMapSnapshot, ParallelLoadAcrossBitOrders)
+{
+	const std::string path = "wfc_bit_order_snapshot_test.bin";
+
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{4, 4});
+	for (std::size_t i = 0; i < 5000; ++i)
+	{
+		map.insert(i * 13, i);
+	}
+	map.save(path);
+
+	// The chunks don't match the head buckets of the ordered map, which is then built by the calling thread.
+	wfc::unordered_map<std::size_t, std::size_t> ordered(wfc::fanout_schedule({4, 4}, wfc::bit_order::msb_first));
+	ASSERT_EQ(ordered.load(path, 4), 5000);
+	ASSERT_EQ(ordered.size(), 5000);
+	for (std::size_t i = 0; i < 5000; ++i)
+	{
+		ASSERT_EQ(ordered.get(i * 13).value(), i);
+	}
+	ASSERT_EQ(ordered.structure_stats().datanodes, 5000);
+
+	std::remove(path.c_str());
+}
+
+TEST(WaitFreeHashMapSnapshot, MisplacedRecord)
+{
+	const std::string path = "wfc_misplaced_snapshot_test.bin";
+
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		map.insert(i, i);
+	}
+	std::stringstream ss;
+	map.save(ss);
+
+	// The key of the first record of the first chunk is moved to another head bucket.
+	std::string bytes = ss.str();
+	std::size_t offset = sizeof(wfc::details::snapshot::header) + sizeof(wfc::details::snapshot::chunk_header);
+	std::size_t key;
+	std::memcpy(&key, bytes.data() + offset, sizeof(key));
+	++key;
+	std::memcpy(&bytes[offset], &key, sizeof(key));
+	{
+		std::ofstream os(path, std::ios::binary);
+		os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	wfc::unordered_map<std::size_t, std::size_t> loaded(4);
+	ASSERT_THROW(loaded.load(path, 2), std::runtime_error);
+
+	std::remove(path.c_str());
+}
+
+TEST(WaitFreeHashMapSnapshot, RepeatedParallelLoads)
+{
+	const std::string path = "wfc_repeated_snapshot_test.bin";
+	constexpr std::size_t nbr_threads = 4;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		map.insert(i, i);
+	}
+	map.save(path);
+
+	// The building threads give their ids back, so that loads keep fitting maps made for as many threads.
+	for (std::size_t round = 0; round < 8; ++round)
+	{
+		wfc::unordered_map<std::size_t, std::size_t> loaded(
+		    4, nbr_threads, nbr_threads, wfc::memory_placement::huge_pages);
+		ASSERT_EQ(loaded.load(path, nbr_threads), 1000);
+		ASSERT_EQ(loaded.get(999).value(), 999);
+	}
+
+	wfc::unordered_map<std::size_t, std::size_t> small(4, 1, 1);
+	ASSERT_THROW(small.load(path, nbr_threads), std::runtime_error);
+
+	std::remove(path.c_str());
+}
+
+TEST(WaitFreeHashMapSnapshot, Mismatch)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	map.insert(1, 1);
+
+	std::stringstream ss;
+	map.save(ss);
+
+	wfc::unordered_map<std::size_t, unsigned char> other(4);
+	ASSERT_THROW(other.load(ss), std::runtime_error);
+
+	std::string truncated = ss.str();
+	truncated.pop_back();
+	std::stringstream ts(truncated);
+
+	wfc::unordered_map<std::size_t, std::size_t> loaded(4);
+	ASSERT_THROW(loaded.load(ts), std::runtime_error);
+}
+
+TEST(WaitFreeHashMapSnapshot, FuzzySnapshot)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t stable = 512;
+
+	wfc::unordered_map<std::size_t, std::size_t> map(4, nbr_threads + 1, 65535);
+	for (std::size_t i = 0; i < stable; ++i)
+	{
+		map.insert(i, i);
+	}
+
+	std::atomic_bool stop = false;
+	std::vector<std::thread> writers;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		writers.emplace_back([&map, &stop, t]() {
+			std::size_t i = 0;
+			while (!stop)
+			{
+				std::size_t key = stable + t * 1000 + i % 1000;
+				map.insert(key, key);
+				map.update(key, key + 1);
+				map.remove(key);
+				++i;
+			}
+		});
+	}
+
+	std::stringstream ss;
+	map.save(ss);
+
+	stop = true;
+	for (auto& t: writers)
+	{
+		t.join();
+	}
+
+	wfc::unordered_map<std::size_t, std::size_t> loaded(4);
+	loaded.load(ss);
+
+	for (std::size_t i = 0; i < stable; ++i)
+	{
+		ASSERT_EQ(loaded.get(i).value(), i);
+	}
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <wfc/unordered_map.hpp>
+
+TEST(WaitFreeHashMapStructureStats, EmptyMap)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	wfc::structure_report report = map.structure_stats();
+
+	ASSERT_EQ(report.arraynodes, 1);
+	ASSERT_EQ(report.datanodes, 0);
+	ASSERT_EQ(report.slots, 16);
+	ASSERT_EQ(report.empty_slots, 16);
+	ASSERT_EQ(report.max_depth, 0);
+}
+
+TEST(WaitFreeHashMapStructureStats, Expansion)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 16; ++i)
+	{
+		map.insert(i, i);
+	}
+
+	wfc::structure_report report = map.structure_stats();
+	ASSERT_EQ(report.datanodes, 16);
+	ASSERT_EQ(report.empty_slots, 0);
+	ASSERT_EQ(report.total_depth, 0);
+
+	// 16 collides with 0 in the head, both go into a new arraynode of 4 slots.
+	map.insert(16, 16);
+	report = map.structure_stats();
+
+	ASSERT_EQ(report.arraynodes, 2);
+	ASSERT_EQ(report.datanodes, 17);
+	ASSERT_EQ(report.slots, 20);
+	ASSERT_EQ(report.empty_slots, 2);
+	ASSERT_EQ(report.total_depth, 2);
+	ASSERT_EQ(report.max_depth, 1);
+	ASSERT_GT(report.bytes, 20 * sizeof(void*) + 17 * 3 * sizeof(std::size_t));
+}
+
+TEST(WaitFreeHashMapStructureStats, Levels)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(4);
+	for (std::size_t i = 0; i < 17; ++i)
+	{
+		map.insert(i, i);
+	}
+
+	wfc::structure_report report = map.structure_stats();
+	ASSERT_EQ(report.levels.size(), 2);
+	ASSERT_EQ(report.marked_slots, 0);
+	ASSERT_EQ(report.empty_arraynodes, 0);
+
+	ASSERT_EQ(report.levels[0].arraynodes, 1);
+	ASSERT_EQ(report.levels[0].slots, 16);
+	ASSERT_EQ(report.levels[0].datanodes, 15);
+	ASSERT_EQ(report.levels[0].occupancy[10], 1);
+
+	// The arraynode holding 0 and 16 has 2 of its 4 slots used.
+	ASSERT_EQ(report.levels[1].arraynodes, 1);
+	ASSERT_EQ(report.levels[1].slots, 4);
+	ASSERT_EQ(report.levels[1].empty_slots, 2);
+	ASSERT_EQ(report.levels[1].datanodes, 2);
+	ASSERT_EQ(report.levels[1].occupancy[5], 1);
+
+	ASSERT_EQ(map.remove(0), wfc::operation_result::success);
+	ASSERT_EQ(map.remove(16), wfc::operation_result::success);
+	report = map.structure_stats();
+	ASSERT_EQ(report.empty_arraynodes, 1);
+	ASSERT_EQ(report.levels[1].occupancy[0], 1);
+}
+
+TEST(WaitFreeHashMapStructureStats, ParallelWalkMatchesSequential)
+{
+	wfc::unordered_map<std::size_t, std::size_t> map(wfc::fanout_schedule{6, 2});
+	for (std::size_t i = 0; i < 5000; ++i)
+	{
+		map.insert(i * 37 + (i << 20U), i);
+	}
+
+	wfc::structure_report sequential = map.structure_stats();
+	for (std::size_t nbr_threads: {2U, 3U, 64U, 1000U})
+	{
+		wfc::structure_report parallel = map.structure_stats(nbr_threads);
+		ASSERT_EQ(parallel.arraynodes, sequential.arraynodes);
+		ASSERT_EQ(parallel.datanodes, 5000);
+		ASSERT_EQ(parallel.slots, sequential.slots);
+		ASSERT_EQ(parallel.empty_slots, sequential.empty_slots);
+		ASSERT_EQ(parallel.total_depth, sequential.total_depth);
+		ASSERT_EQ(parallel.max_depth, sequential.max_depth);
+		ASSERT_EQ(parallel.bytes, sequential.bytes);
+		ASSERT_EQ(parallel.levels.size(), sequential.levels.size());
+		for (std::size_t depth = 0; depth < sequential.levels.size(); ++depth)
+		{
+			ASSERT_EQ(parallel.levels[depth].datanodes, sequential.levels[depth].datanodes);
+			ASSERT_EQ(parallel.levels[depth].occupancy, sequential.levels[depth].occupancy);
+		}
+	}
+}
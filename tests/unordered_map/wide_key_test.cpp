@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <wfc/frozen_map.hpp>
+#include <wfc/unordered_map.hpp>
+
+namespace
+{
+	// Keys of 16 bytes which only differ by one word, so that half of the hash is shared.
+	wfc::uint128 high_key(std::uint64_t i) noexcept
+	{
+		return {i, 0x0123456789ABCDEFULL};
+	}
+
+	wfc::uint128 low_key(std::uint64_t i) noexcept
+	{
+		return {0xFEDCBA9876543210ULL, i};
+	}
+} // namespace
+
+TEST(WaitFreeHashMapWideKeys, KeysDifferingInEitherWord)
+{
+	wfc::unordered_map<wfc::uint128, std::uint64_t> map(4);
+
+	for (std::uint64_t i = 0; i < 2000; ++i)
+	{
+		ASSERT_EQ(map.insert(high_key(i), i), wfc::operation_result::success);
+		ASSERT_EQ(map.insert(low_key(i), i + 1), wfc::operation_result::success);
+	}
+	ASSERT_EQ(map.insert(high_key(7), 0), wfc::operation_result::already_present);
+	ASSERT_EQ(map.size(), 4000);
+
+	for (std::uint64_t i = 0; i < 2000; ++i)
+	{
+		ASSERT_EQ(map.get(high_key(i)), i);
+		ASSERT_EQ(map.get(low_key(i)), i + 1);
+	}
+
+	for (std::uint64_t i = 0; i < 2000; i += 2)
+	{
+		ASSERT_EQ(map.remove(high_key(i)), wfc::operation_result::success);
+	}
+	ASSERT_FALSE(map.get(high_key(0)).has_value());
+	ASSERT_EQ(map.get(high_key(1)), 1);
+	ASSERT_EQ(map.size(), 3000);
+}
+
+TEST(WaitFreeHashMapWideKeys, TrieExtendsToTheHighWord)
+{
+	wfc::unordered_map<wfc::uint128, int> map(wfc::fanout_schedule({8, 4}));
+
+	// Only the last bit differs, the datanodes are expanded down to the last of the 1 + 120 / 4 levels.
+	ASSERT_EQ(map.insert(wfc::uint128(0, 0), 0), wfc::operation_result::success);
+	ASSERT_EQ(map.insert(wfc::uint128(1ULL << 63U, 0), 1), wfc::operation_result::success);
+
+	wfc::structure_report report = map.structure_stats();
+	ASSERT_EQ(report.max_depth, 30);
+	ASSERT_EQ(map.get(wfc::uint128(1ULL << 63U, 0)), 1);
+	ASSERT_EQ(map.get(wfc::uint128(0, 0)), 0);
+}
+
+TEST(WaitFreeHashMapWideKeys, OrderedRangeAcrossWords)
+{
+	wfc::unordered_map<wfc::uint128, int> map(wfc::fanout_schedule({8, 4}, wfc::bit_order::msb_first));
+
+	for (int i = 0; i < 100; ++i)
+	{
+		map.insert(wfc::uint128(static_cast<std::uint64_t>(i % 10), static_cast<std::uint64_t>(i) << 56U), i);
+	}
+
+	std::vector<int> visited;
+	map.visit_range(wfc::uint128(2, 0), wfc::uint128(3, ~std::uint64_t{0}), [&visited](auto p) {
+		visited.push_back(p.second);
+	});
+	ASSERT_EQ(visited, (std::vector<int>{2, 12, 22, 32, 42, 52, 62, 72, 82, 92, 3, 13, 23, 33, 43, 53, 63, 73, 83, 93}));
+
+	auto cursor = map.lower_bound(wfc::uint128(9, 93ULL << 56U));
+	ASSERT_EQ(cursor.next()->second, 99);
+	ASSERT_FALSE(cursor.next().has_value());
+}
+
+TEST(WaitFreeHashMapWideKeys, ConcurrentInsertions)
+{
+	constexpr std::uint64_t nbr_threads = 4;
+	constexpr std::uint64_t keys_per_thread = 2000;
+	wfc::unordered_map<wfc::uint128, std::uint64_t> map(2, 4, 65535);
+
+	std::vector<std::thread> threads;
+	for (std::uint64_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&map, t]() {
+			for (std::uint64_t i = t; i < nbr_threads * keys_per_thread; i += nbr_threads)
+			{
+				map.insert(i % 2 == 0 ? high_key(i) : low_key(i), i);
+			}
+		});
+	}
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+
+	ASSERT_EQ(map.size(), nbr_threads * keys_per_thread);
+	for (std::uint64_t i = 0; i < nbr_threads * keys_per_thread; ++i)
+	{
+		ASSERT_EQ(map.get(i % 2 == 0 ? high_key(i) : low_key(i)), i);
+	}
+}
+
+TEST(WaitFreeHashMapWideKeys, FrozenMap)
+{
+	wfc::unordered_map<wfc::uint128, std::uint64_t> map(4);
+	for (std::uint64_t i = 0; i < 1000; ++i)
+	{
+		map.insert(high_key(i), i);
+	}
+
+	wfc::frozen_map<wfc::uint128, std::uint64_t> frozen(map);
+	ASSERT_EQ(frozen.size(), 1000);
+	ASSERT_EQ(frozen.get(high_key(999)), 999);
+	ASSERT_FALSE(frozen.contains(low_key(999)));
+}
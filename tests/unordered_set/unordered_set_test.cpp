@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <wfc/unordered_set.hpp>
+
+TEST(WaitFreeHashSet, NodesHoldNoValue)
+{
+	using node_t = wfc::details::node_t<std::size_t, std::size_t, wfc::details::no_value>;
+	ASSERT_EQ(sizeof(node_t), 2 * sizeof(std::size_t));
+}
+
+TEST(WaitFreeHashSet, InsertContainsErase)
+{
+	wfc::unordered_set<std::size_t> set(4);
+	ASSERT_TRUE(set.is_empty());
+	ASSERT_FALSE(set.contains(1));
+
+	ASSERT_EQ(set.insert(1), wfc::operation_result::success);
+	ASSERT_EQ(set.insert(1), wfc::operation_result::already_present);
+	ASSERT_EQ(set.insert(17), wfc::operation_result::success);
+	ASSERT_TRUE(set.contains(1));
+	ASSERT_TRUE(set.contains(17));
+	ASSERT_EQ(set.size(), 2);
+
+	ASSERT_EQ(set.erase(1), wfc::operation_result::success);
+	ASSERT_EQ(set.erase(1), wfc::operation_result::element_not_found);
+	ASSERT_FALSE(set.contains(1));
+	ASSERT_TRUE(set.contains(17));
+	ASSERT_EQ(set.size(), 1);
+}
+
+TEST(WaitFreeHashSet, BulkOperations)
+{
+	std::vector<std::size_t> evens;
+	std::vector<std::size_t> small;
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		evens.push_back(2 * i);
+		small.push_back(i);
+	}
+
+	wfc::unordered_set<std::size_t> a(4);
+	wfc::unordered_set<std::size_t> b(4);
+	ASSERT_EQ(a.insert(evens.begin(), evens.end()), 100);
+	ASSERT_EQ(b.insert(small.begin(), small.end()), 100);
+
+	wfc::unordered_set<std::size_t> u(4);
+	ASSERT_EQ(u.insert_all(a), 100);
+	ASSERT_EQ(u.insert_all(b), 50);
+	ASSERT_EQ(u.size(), 150);
+	ASSERT_TRUE(a.is_subset_of(u));
+	ASSERT_FALSE(u.is_subset_of(a));
+
+	ASSERT_EQ(u.erase_all(b), 100);
+	ASSERT_EQ(u.size(), 50);
+	u.visit([](std::size_t key) { ASSERT_TRUE(key >= 100 && key % 2 == 0); });
+
+	ASSERT_EQ(a.retain_all(b), 50);
+	ASSERT_EQ(a.size(), 50);
+	a.visit([](std::size_t key) { ASSERT_TRUE(key < 100 && key % 2 == 0); });
+}
+
+TEST(WaitFreeHashSet, ConcurrentInsertErase)
+{
+	constexpr std::size_t nbr_threads = 4;
+	constexpr std::size_t per_thread = 2000;
+
+	wfc::unordered_set<std::size_t> set(4, nbr_threads, 65535);
+
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&set, t]() {
+			for (std::size_t i = 0; i < per_thread; ++i)
+			{
+				std::size_t key = i * nbr_threads + t;
+				set.insert(key);
+				if (key % 3 == 0)
+				{
+					set.erase(key);
+				}
+			}
+		});
+	}
+
+	for (auto& t: threads)
+	{
+		t.join();
+	}
+
+	for (std::size_t k = 0; k < nbr_threads * per_thread; ++k)
+	{
+		ASSERT_EQ(set.contains(k), k % 3 != 0);
+	}
+}
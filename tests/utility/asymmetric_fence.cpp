@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include <wfc/utility/asymmetric_fence.hpp>
+
+TEST(AsymmetricFence, SupportIsStable)
+{
+	bool supported = wfc::asymmetric_fence_supported();
+
+	ASSERT_EQ(wfc::asymmetric_fence_supported(), supported);
+}
+
+// Store buffering: with a light fence on one side and a heavy one on the other, both threads can't miss each other.
+TEST(AsymmetricFence, OrdersStoreBuffering)
+{
+	if (!wfc::asymmetric_fence_supported())
+	{
+		GTEST_SKIP() << "membarrier isn't supported";
+	}
+
+	for (int round = 0; round < 2000; ++round)
+	{
+		std::atomic<int> x{0};
+		std::atomic<int> y{0};
+		int seen_by_light = -1;
+		int seen_by_heavy = -1;
+
+		std::thread light([&]() {
+			x.store(1, std::memory_order_relaxed);
+			wfc::details::light_fence();
+			seen_by_light = y.load(std::memory_order_relaxed);
+		});
+		y.store(1, std::memory_order_relaxed);
+		wfc::details::heavy_fence();
+		seen_by_heavy = x.load(std::memory_order_relaxed);
+		light.join();
+
+		ASSERT_TRUE(seen_by_light == 1 || seen_by_heavy == 1);
+	}
+}
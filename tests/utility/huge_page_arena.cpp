@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <thread>
+
+#include <wfc/utility/huge_page_arena.hpp>
+
+TEST(HugePageArena, AllocationsAreAlignedAndDistinct)
+{
+	wfc::huge_page_arena arena(1);
+	std::set<void*> blocks;
+
+	for (std::size_t i = 1; i < 2000; ++i)
+	{
+		std::size_t alignment = (i % 3 == 0) ? 64 : 8;
+		void* p = arena.allocate(i % 300 + 1, alignment);
+
+		ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % alignment, 0);
+		ASSERT_TRUE(blocks.insert(p).second);
+		std::memset(p, 0xff, i % 300 + 1);
+	}
+
+	ASSERT_GE(arena.reserved_bytes(), wfc::huge_page_arena::huge_page_size);
+	ASSERT_LE(arena.huge_page_bytes(), arena.reserved_bytes());
+}
+
+TEST(HugePageArena, OverAlignedBlocksAreReused)
+{
+	wfc::huge_page_arena arena(1);
+
+	void* p = arena.allocate(24, 64);
+	ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % 64, 0);
+	arena.deallocate(p, 24, 64);
+
+	ASSERT_EQ(arena.allocate(24, 64), p);
+	ASSERT_NE(arena.allocate(24, 64), p);
+}
+
+TEST(HugePageArena, SmallBlocksAreReused)
+{
+	wfc::huge_page_arena arena(1);
+
+	void* p = arena.allocate(24, 8);
+	arena.deallocate(p, 24, 8);
+
+	ASSERT_EQ(arena.allocate(20, 8), p);
+	ASSERT_NE(arena.allocate(24, 8), p);
+}
+
+TEST(HugePageArena, MediumBlocksAreReused)
+{
+	wfc::huge_page_arena arena(1);
+
+	void* p = arena.allocate(600, 8);
+	arena.deallocate(p, 600, 8);
+
+	ASSERT_EQ(arena.allocate(1000, 8), p);
+	ASSERT_NE(arena.allocate(600, 8), p);
+}
+
+TEST(HugePageArena, ThreadsBeyondTheMaximumShareFreeLists)
+{
+	wfc::huge_page_arena arena(1);
+
+	// The calling thread holds an id, the other one gets a higher id than the arena expects.
+	wfc::details::get_thread_id();
+	void* shared = nullptr;
+	std::thread thread([&arena, &shared]() {
+		ASSERT_GE(wfc::details::get_thread_id(), 1);
+
+		shared = arena.allocate(24, 8);
+		arena.deallocate(shared, 24, 8);
+		ASSERT_EQ(arena.allocate(24, 8), shared);
+		arena.deallocate(shared, 24, 8);
+	});
+	thread.join();
+
+	void* p = arena.allocate(24, 8);
+	ASSERT_NE(p, shared);
+	arena.deallocate(p, 24, 8);
+	ASSERT_EQ(arena.allocate(24, 8), p);
+}
+
+TEST(HugePageArena, LargeBlocks)
+{
+	wfc::huge_page_arena arena(1);
+
+	std::size_t size = 3 * wfc::huge_page_arena::huge_page_size;
+	char* p = static_cast<char*>(arena.allocate(size, 8));
+	std::memset(p, 0, size);
+	ASSERT_GE(arena.reserved_bytes(), size);
+
+	// Large blocks are released as soon as they are deallocated, the last one with the arena.
+	std::size_t reserved = arena.reserved_bytes();
+	arena.deallocate(p, size, 8);
+	ASSERT_LE(arena.reserved_bytes(), reserved - size);
+	ASSERT_NE(arena.allocate(size, 8), nullptr);
+}
@@ -15,6 +15,13 @@ TEST(Utilty, Log2OfPowerOfTwo)
 	ASSERT_EQ(wfc::log2_of_power_of_two(8U), 3U);
 }
 
+TEST(Utility, Popcount)
+{
+	ASSERT_EQ(wfc::details::popcount(0ULL), 0ULL);
+	ASSERT_EQ(wfc::details::popcount(0b1011ULL), 3ULL);
+	ASSERT_EQ(wfc::details::popcount(~0ULL), 64ULL);
+}
+
 #ifndef NDEBUG
 #	define Log2OfPowerOfTwoDeath Log2OfPowerOfTwoDeath
 #else
@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+
+#include <wfc/utility/numa.hpp>
+
+TEST(Numa, ParseIdList)
+{
+	ASSERT_EQ(wfc::details::parse_id_list("0"), (std::vector<std::size_t>{0}));
+	ASSERT_EQ(wfc::details::parse_id_list("0-2,5,7-8\n"), (std::vector<std::size_t>{0, 1, 2, 5, 7, 8}));
+	ASSERT_TRUE(wfc::details::parse_id_list("").empty());
+}
+
+TEST(Numa, Topology)
+{
+	ASSERT_GE(wfc::numa_node_count(), 1);
+	ASSERT_FALSE(wfc::pin_current_thread_to_numa_node(wfc::numa_node_count() + 1000));
+}
@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+
+#include <wfc/utility/uint128.hpp>
+
+TEST(Uint128, Arithmetic)
+{
+	wfc::uint128 one = 1;
+
+	ASSERT_EQ(one << 64U, wfc::uint128(1, 0));
+	ASSERT_EQ(wfc::uint128(1, 0) >> 64U, one);
+	ASSERT_EQ(wfc::uint128(0x3, 0x8000000000000000ULL) >> 63U, wfc::uint128(0x7));
+	ASSERT_EQ((one << 127U) >> 127U, one);
+	ASSERT_EQ(wfc::uint128(0, ~std::uint64_t{0}) + 1, wfc::uint128(1, 0));
+	ASSERT_EQ(wfc::uint128(1, 0) - 1, wfc::uint128(0, ~std::uint64_t{0}));
+	ASSERT_LT(wfc::uint128(0, ~std::uint64_t{0}), wfc::uint128(1, 0));
+	ASSERT_EQ(static_cast<std::size_t>(wfc::uint128(5, 7)), 7);
+	ASSERT_EQ(wfc::uint128(5, 0xFF) & std::size_t{0xF}, 0xF);
+	ASSERT_EQ(std::numeric_limits<wfc::uint128>::max() + 1, wfc::uint128{});
+
+	unsigned char bytes[16];
+	for (unsigned char i = 0; i < 16; ++i)
+	{
+		bytes[i] = i;
+	}
+	ASSERT_EQ(wfc::uint128::from_bytes(bytes), wfc::uint128(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL));
+}
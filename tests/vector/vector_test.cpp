@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wfc/vector.hpp>
+
+TEST(WaitFreeVector, InvalidFirstBucketSize)
+{
+	ASSERT_THROW(wfc::vector<int>(0), std::runtime_error);
+	ASSERT_THROW(wfc::vector<int>(6), std::runtime_error);
+}
+
+TEST(WaitFreeVector, PushBackAndIndex)
+{
+	wfc::vector<std::string> vector(2);
+	ASSERT_TRUE(vector.is_empty());
+	ASSERT_FALSE(vector.get(0).has_value());
+
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		ASSERT_EQ(vector.push_back(std::to_string(i)), i);
+	}
+
+	ASSERT_EQ(vector.size(), 1000);
+	ASSERT_GE(vector.capacity(), 1000);
+	ASSERT_LT(vector.capacity(), 2000 + 2);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		ASSERT_EQ(vector[i], std::to_string(i));
+		ASSERT_EQ(vector.get(i), std::to_string(i));
+	}
+	ASSERT_FALSE(vector.get(1000).has_value());
+}
+
+TEST(WaitFreeVector, GrowthKeepsReferences)
+{
+	wfc::vector<std::size_t> vector(1);
+	vector.push_back(42);
+	const std::size_t* first = &vector[0];
+
+	for (std::size_t i = 1; i < 10000; ++i)
+	{
+		vector.push_back(i);
+	}
+
+	ASSERT_EQ(first, &vector[0]);
+	ASSERT_EQ(*first, 42);
+}
+
+TEST(WaitFreeVector, ElementsAreDestroyed)
+{
+	auto counter = std::make_shared<int>(0);
+	{
+		wfc::vector<std::shared_ptr<int>> vector(4);
+		for (std::size_t i = 0; i < 100; ++i)
+		{
+			vector.push_back(counter);
+		}
+		ASSERT_EQ(counter.use_count(), 101);
+	}
+	ASSERT_EQ(counter.use_count(), 1);
+}
+
+TEST(WaitFreeVector, ConcurrentPushBack)
+{
+	constexpr std::size_t nbr_threads = 8;
+	constexpr std::size_t per_thread = 20000;
+
+	wfc::vector<std::size_t> vector(4);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < nbr_threads; ++t)
+	{
+		threads.emplace_back([&vector, t]() {
+			for (std::size_t i = 0; i < per_thread; ++i)
+			{
+				std::size_t value = t * per_thread + i;
+				std::size_t index = vector.push_back(value);
+				ASSERT_EQ(vector[index], value);
+			}
+		});
+	}
+
+	for (std::thread& thread: threads)
+	{
+		thread.join();
+	}
+
+	ASSERT_EQ(vector.size(), nbr_threads * per_thread);
+	std::vector<int> seen(nbr_threads * per_thread, 0);
+	for (std::size_t i = 0; i < vector.size(); ++i)
+	{
+		++seen[vector[i]];
+	}
+	for (int count: seen)
+	{
+		ASSERT_EQ(count, 1);
+	}
+}